@@ -0,0 +1,147 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+#ifndef biorob_ik_analytic_ik_h__
+#define biorob_ik_analytic_ik_h__
+
+#include "kinematic_chain.h"
+
+#include <string>
+#include <vector>
+
+namespace biorob_ik{
+
+/**
+ * Fixed size result of one IK query, so batches can be written into preallocated storage.
+ */
+struct IKSolutions
+{
+  enum { MAX_SOLUTIONS = 8, MAX_JOINTS = 8 };
+
+  int num_solutions;
+  double q[MAX_SOLUTIONS][MAX_JOINTS];
+};
+
+/**
+ * Closed form / semi-analytic inverse kinematics for the BioRob arm family.
+ *
+ * All BioRob variants share a yaw joint followed by two parallel shoulder/elbow joints. The solver
+ * analyses the chain once in setChain() and derives the geometry it needs from it:
+ * - the wrist center, i.e. the point all remaining joint axes pass through,
+ * - whether the wrist is "planar" (x4/x5_hg: pitch joints parallel to the shoulder plus an
+ *   optional roll around the approach direction) or a roll/pitch(/roll) wrist (x5_ug, x6).
+ *
+ * Planar and spherical wrists are solved in closed form. If the wrist axes do not intersect exactly
+ * (biorob_v3_x6 has a small offset), the closed form result for the nearest intersection point is
+ * used as seed and refined with a few Gauss-Newton steps on the full pose.
+ *
+ * Underactuated variants (fewer than six joints) return the solutions closest to the requested
+ * orientation: the approach direction is projected into the reachable set, roll is fitted in the
+ * least squares sense, and branches with a larger orientation error (e.g. the arm flipped over
+ * the yaw axis) are dropped. Six joint arms only return solutions that reach the full pose.
+ */
+class AnalyticIK
+{
+public:
+  enum WristType { WRIST_UNSUPPORTED, WRIST_PLANAR, WRIST_APPROACH, WRIST_SPHERICAL, WRIST_OFFSET };
+
+  AnalyticIK();
+
+  /// Analyses the chain geometry. Returns false if it does not match the supported arm layouts.
+  bool setChain(const KinematicChain& chain);
+
+  const KinematicChain& getChain() const { return chain_; }
+  WristType getWristType() const { return wrist_type_; }
+
+  /// Solves for the effector pose given relative to the chain base. Returns the number of solutions.
+  int solve(const Eigen::Isometry3d& pose, IKSolutions& solutions) const;
+
+  /**
+   * Solves a batch of candidate poses. Poses are read from a contiguous array, results are written
+   * into preallocated storage; no memory is allocated per query.
+   * Returns the number of poses with at least one solution.
+   */
+  size_t solveBatch(const Eigen::Isometry3d* poses, size_t count, IKSolutions* solutions) const;
+
+  /// Batch interface that only reports reachability, e.g. for pruning grasp candidates
+  size_t checkReachable(const Eigen::Isometry3d* poses, size_t count, unsigned char* reachable) const;
+
+  void setTolerance(double position_tolerance) { position_tolerance_ = position_tolerance; }
+  void setOrientationTolerance(double orientation_tolerance) { orientation_tolerance_ = orientation_tolerance; }
+  void setMaxRefinementIterations(int iterations) { max_refinement_iterations_ = iterations; }
+
+  static std::string getWristTypeString(WristType type);
+
+protected:
+  int solveYaw(const Eigen::Vector3d& point, double lateral_offset, double* q1) const;
+  int solveShoulderElbow(const Eigen::Vector3d& wrist_center, double q1, double q2[2], double q3[2]) const;
+  int solveWrist(const Eigen::Isometry3d& pose, double* q, double wrist_solutions[2][IKSolutions::MAX_JOINTS]) const;
+
+  bool refine(const Eigen::Isometry3d& pose, double* q) const;
+  /// Checks the position of a closed form solution and returns its orientation error (rad)
+  bool checkSolution(const Eigen::Isometry3d& pose, const double* q, double& orientation_error) const;
+
+  KinematicChain chain_;
+  WristType wrist_type_;
+
+  size_t num_joints_;
+  size_t num_wrist_joints_;
+
+  // geometry at zero configuration, relative to the chain base
+  Eigen::Vector3d yaw_axis_;
+  Eigen::Vector3d yaw_origin_;
+  Eigen::Vector3d plane_normal_;     // shoulder/elbow axis
+  Eigen::Vector3d plane_forward_;    // plane_normal_ x yaw_axis_
+
+  Eigen::Vector2d shoulder_;         // shoulder position in plane coordinates (forward, up)
+  Eigen::Vector2d upper_arm_;        // shoulder to elbow in plane coordinates
+  Eigen::Vector2d forearm_;          // elbow to wrist center in plane coordinates
+  double upper_arm_length_;
+  double forearm_length_;
+  double elbow_sign_;                // +1 if the elbow axis points along the shoulder axis, -1 otherwise
+  double wrist_lateral_offset_;
+  double wrist_residual_;            // distance of the wrist center from the wrist axes, 0 for intersecting axes
+  double tip_lateral_offset_;
+
+  Eigen::Vector3d wrist_center_tip_; // wrist center expressed in the effector frame
+  Eigen::Vector3d approach_tip_;     // unit vector from wrist center to effector, effector frame
+  double approach_length_;
+
+  // wrist axes in the frame of the third joint with all wrist joints at zero
+  std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > wrist_axes_;
+  Eigen::Matrix3d wrist_zero_rotation_; // effector orientation relative to joint 3 frame at wrist zero
+  bool wrist_roll_;                     // last wrist joint rotates around the approach direction
+
+  double position_tolerance_;
+  double orientation_tolerance_;
+  int max_refinement_iterations_;
+};
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+#ifndef biorob_ik_kinematic_chain_h__
+#define biorob_ik_kinematic_chain_h__
+
+#include <hector_batch_kinematics/kinematic_model.h>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <string>
+#include <vector>
+
+namespace biorob_ik{
+
+/**
+ * A single revolute joint of a serial chain. The joint frame is reached from the previous
+ * joint frame via the fixed transform "origin", then rotated by q around "axis".
+ */
+struct RevoluteJoint
+{
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  std::string name;
+  Eigen::Isometry3d origin;
+  Eigen::Vector3d axis;
+  double lower;
+  double upper;
+};
+
+/**
+ * Serial chain of revolute joints from the manipulator base to the effector frame.
+ * Fixed joints are folded into the origin of the following revolute joint or into the tip transform.
+ * Forward kinematics are evaluated by a hector_batch_kinematics::KinematicModel of the chain.
+ */
+class KinematicChain
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  enum { MAX_JOINTS = 16 };
+
+  KinematicChain();
+
+  /// Returns false if the chain already has MAX_JOINTS joints
+  bool addJoint(const std::string& name, const Eigen::Isometry3d& origin, const Eigen::Vector3d& axis, double lower, double upper);
+
+  /// Appends a fixed transform; it is merged into the next joint origin or the tip transform
+  void addFixed(const Eigen::Isometry3d& transform);
+
+  size_t getNumJoints() const { return joints_.size(); }
+  const RevoluteJoint& getJoint(size_t i) const { return joints_[i]; }
+  const Eigen::Isometry3d& getTip() const { return tip_; }
+
+  /// Model with the chain base as link 0 and joint i moving link i + 1, the tip transform is not included
+  const hector_batch_kinematics::KinematicModel& getModel() const { return model_; }
+
+  /// Effector pose relative to the chain base
+  Eigen::Isometry3d getForwardKinematics(const double* q) const;
+
+  /**
+   * Joint frames relative to the chain base (after applying the joint rotation). frames must
+   * hold getNumJoints() elements. Returns the effector pose.
+   */
+  Eigen::Isometry3d getJointFrames(const double* q, Eigen::Isometry3d* frames) const;
+
+  /// Moves angles into the joint limits by multiples of 2 pi where possible
+  bool wrapIntoLimits(double* q) const;
+
+protected:
+  std::vector<RevoluteJoint, Eigen::aligned_allocator<RevoluteJoint> > joints_;
+  Eigen::Isometry3d tip_;
+  hector_batch_kinematics::KinematicModel model_;
+};
+
+}
+
+#endif
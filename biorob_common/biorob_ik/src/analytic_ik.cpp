@@ -0,0 +1,548 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+#include <biorob_ik/analytic_ik.h>
+
+#include <Eigen/LU>
+#include <Eigen/SVD>
+
+#include <cmath>
+
+namespace biorob_ik{
+
+namespace{
+
+const double kParallelEpsilon = 1e-6;
+const double kIntersectionEpsilon = 1e-6;
+
+inline double normalizeAngle(double angle)
+{
+  return atan2(sin(angle), cos(angle));
+}
+
+inline bool isParallel(const Eigen::Vector3d& a, const Eigen::Vector3d& b)
+{
+  return a.cross(b).norm() < kParallelEpsilon;
+}
+
+inline Eigen::Vector2d rotate2d(const Eigen::Vector2d& v, double angle)
+{
+  double c = cos(angle);
+  double s = sin(angle);
+  return Eigen::Vector2d(c * v.x() - s * v.y(), s * v.x() + c * v.y());
+}
+
+// Paden-Kahan subproblem 1: angle around w that rotates p onto q
+inline double rotationToAlign(const Eigen::Vector3d& w, const Eigen::Vector3d& p, const Eigen::Vector3d& q)
+{
+  Eigen::Vector3d pp (p - w * w.dot(p));
+  Eigen::Vector3d qp (q - w * w.dot(q));
+  return atan2(w.dot(pp.cross(qp)), pp.dot(qp));
+}
+
+// angle around w that brings exp(w theta) closest to m (Frobenius norm)
+inline double closestRotation(const Eigen::Vector3d& w, const Eigen::Matrix3d& m)
+{
+  Eigen::Matrix3d k;
+  k <<     0.0, -w.z(),  w.y(),
+         w.z(),    0.0, -w.x(),
+        -w.y(),  w.x(),    0.0;
+
+  double b = (k.transpose() * m).trace();
+  double c = (k * k * m).trace();
+  return atan2(b, -c);
+}
+
+// Paden-Kahan subproblem 2: exp(w1 theta1) exp(w2 theta2) p = q, both axes through the origin
+int rotationsToAlign(const Eigen::Vector3d& w1, const Eigen::Vector3d& w2, const Eigen::Vector3d& p, const Eigen::Vector3d& q,
+                     double theta1[2], double theta2[2])
+{
+  double c = w1.dot(w2);
+  double denom = c * c - 1.0;
+
+  if (std::abs(denom) < kParallelEpsilon){
+    return 0;
+  }
+
+  double alpha = (c * w2.dot(p) - w1.dot(q)) / denom;
+  double beta  = (c * w1.dot(q) - w2.dot(p)) / denom;
+
+  Eigen::Vector3d cross (w1.cross(w2));
+
+  // A negative value means the direction is not reachable, the closest direction (gamma = 0) is used instead
+  double gamma_sq = (p.squaredNorm() - alpha * alpha - beta * beta - 2.0 * alpha * beta * c) / cross.squaredNorm();
+  double gamma = gamma_sq > 0.0 ? sqrt(gamma_sq) : 0.0;
+
+  int num = gamma > 0.0 ? 2 : 1;
+
+  for (int i = 0; i < num; ++i){
+    Eigen::Vector3d z (alpha * w1 + beta * w2 + (i == 0 ? gamma : -gamma) * cross);
+    theta2[i] = rotationToAlign(w2, p, z);
+    theta1[i] = rotationToAlign(w1, z, q);
+  }
+
+  return num;
+}
+
+}
+
+AnalyticIK::AnalyticIK()
+  : wrist_type_(WRIST_UNSUPPORTED)
+  , num_joints_(0)
+  , num_wrist_joints_(0)
+  , position_tolerance_(1e-5)
+  , orientation_tolerance_(1e-5)
+  , max_refinement_iterations_(10)
+{
+}
+
+bool AnalyticIK::setChain(const KinematicChain& chain)
+{
+  chain_ = chain;
+  wrist_type_ = WRIST_UNSUPPORTED;
+
+  num_joints_ = chain_.getNumJoints();
+
+  if (num_joints_ < 4 || num_joints_ > IKSolutions::MAX_JOINTS){
+    return false;
+  }
+
+  num_wrist_joints_ = num_joints_ - 3;
+
+  std::vector<Eigen::Isometry3d, Eigen::aligned_allocator<Eigen::Isometry3d> > frames(num_joints_);
+  std::vector<double> zero(num_joints_, 0.0);
+
+  Eigen::Isometry3d tip_zero (chain_.getJointFrames(&zero[0], &frames[0]));
+
+  std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > axes(num_joints_);
+  for (size_t i = 0; i < num_joints_; ++i){
+    axes[i] = frames[i].linear() * chain_.getJoint(i).axis;
+  }
+
+  yaw_axis_ = axes[0];
+  yaw_origin_ = frames[0].translation();
+  plane_normal_ = axes[1];
+
+  // shoulder must be perpendicular to the yaw joint, elbow parallel to the shoulder
+  if (std::abs(yaw_axis_.dot(plane_normal_)) > kParallelEpsilon || !isParallel(plane_normal_, axes[2])){
+    return false;
+  }
+
+  plane_forward_ = plane_normal_.cross(yaw_axis_);
+  elbow_sign_ = plane_normal_.dot(axes[2]) > 0.0 ? 1.0 : -1.0;
+
+  // wrist center: point closest to all wrist axes
+  Eigen::Vector3d wrist_center (frames[3].translation());
+
+  if (num_wrist_joints_ > 1){
+    Eigen::Matrix3d a (Eigen::Matrix3d::Zero());
+    Eigen::Vector3d b (Eigen::Vector3d::Zero());
+
+    for (size_t i = 3; i < num_joints_; ++i){
+      Eigen::Matrix3d projection (Eigen::Matrix3d::Identity() - axes[i] * axes[i].transpose());
+      a += projection;
+      b += projection * (frames[i].translation() - wrist_center);
+    }
+
+    wrist_center += a.jacobiSvd(Eigen::ComputeFullU | Eigen::ComputeFullV).solve(b);
+  }
+
+  wrist_residual_ = 0.0;
+  for (size_t i = 3; i < num_joints_; ++i){
+    Eigen::Vector3d diff (wrist_center - frames[i].translation());
+    wrist_residual_ = std::max(wrist_residual_, (diff - axes[i] * axes[i].dot(diff)).norm());
+  }
+
+  Eigen::Vector3d shoulder (frames[1].translation() - yaw_origin_);
+  Eigen::Vector3d elbow (frames[2].translation() - yaw_origin_);
+  Eigen::Vector3d wrist (wrist_center - yaw_origin_);
+
+  shoulder_ = Eigen::Vector2d(shoulder.dot(plane_forward_), shoulder.dot(yaw_axis_));
+  upper_arm_ = Eigen::Vector2d(elbow.dot(plane_forward_), elbow.dot(yaw_axis_)) - shoulder_;
+  forearm_ = Eigen::Vector2d(wrist.dot(plane_forward_), wrist.dot(yaw_axis_)) - shoulder_ - upper_arm_;
+
+  upper_arm_length_ = upper_arm_.norm();
+  forearm_length_ = forearm_.norm();
+
+  if (upper_arm_length_ < kIntersectionEpsilon || forearm_length_ < kIntersectionEpsilon){
+    return false;
+  }
+
+  wrist_lateral_offset_ = wrist.dot(plane_normal_);
+  tip_lateral_offset_ = (tip_zero.translation() - yaw_origin_).dot(plane_normal_);
+
+  wrist_center_tip_ = tip_zero.inverse() * wrist_center;
+  approach_length_ = wrist_center_tip_.norm();
+
+  if (approach_length_ > kIntersectionEpsilon){
+    approach_tip_ = -wrist_center_tip_ / approach_length_;
+  }else{
+    approach_tip_ = tip_zero.linear().transpose() * axes[num_joints_ - 1];
+  }
+
+  const Eigen::Matrix3d& elbow_rotation (frames[2].linear());
+
+  wrist_axes_.resize(num_wrist_joints_);
+  for (size_t i = 0; i < num_wrist_joints_; ++i){
+    wrist_axes_[i] = elbow_rotation.transpose() * axes[i + 3];
+  }
+
+  wrist_zero_rotation_ = elbow_rotation.transpose() * tip_zero.linear();
+
+  Eigen::Vector3d approach (wrist_zero_rotation_ * approach_tip_);
+  Eigen::Vector3d normal (elbow_rotation.transpose() * plane_normal_);
+
+  wrist_roll_ = isParallel(wrist_axes_.back(), approach);
+
+  // classify wrist
+  if (isParallel(wrist_axes_[0], normal) && std::abs(approach.dot(normal)) < kParallelEpsilon && wrist_residual_ < kIntersectionEpsilon &&
+      (num_wrist_joints_ == 1 || (num_wrist_joints_ == 2 && wrist_roll_))){
+    wrist_type_ = WRIST_PLANAR;
+  }else if (num_wrist_joints_ == 3 && !isParallel(wrist_axes_[1], wrist_axes_[2])){
+    wrist_type_ = wrist_residual_ < kIntersectionEpsilon ? WRIST_SPHERICAL : WRIST_OFFSET;
+  }else if (num_wrist_joints_ == 2 && !wrist_roll_ && approach_length_ > kIntersectionEpsilon && wrist_residual_ < kIntersectionEpsilon){
+    wrist_type_ = WRIST_APPROACH;
+  }
+
+  return wrist_type_ != WRIST_UNSUPPORTED;
+}
+
+int AnalyticIK::solveYaw(const Eigen::Vector3d& point, double lateral_offset, double* q1) const
+{
+  Eigen::Vector3d diff (point - yaw_origin_);
+
+  double x = diff.dot(plane_forward_);
+  double y = diff.dot(plane_normal_);
+
+  double radius_sq = x * x + y * y - lateral_offset * lateral_offset;
+
+  if (radius_sq < 0.0){
+    return 0;
+  }
+
+  double radius = sqrt(radius_sq);
+  double heading = atan2(y, x);
+
+  q1[0] = normalizeAngle(heading - atan2(lateral_offset, radius));
+  q1[1] = normalizeAngle(heading - atan2(lateral_offset, -radius));
+
+  return 2;
+}
+
+int AnalyticIK::solveShoulderElbow(const Eigen::Vector3d& wrist_center, double q1, double q2[2], double q3[2]) const
+{
+  Eigen::Vector3d diff (wrist_center - yaw_origin_);
+  Eigen::Vector3d forward (Eigen::AngleAxisd(q1, yaw_axis_) * plane_forward_);
+
+  Eigen::Vector2d target (Eigen::Vector2d(diff.dot(forward), diff.dot(yaw_axis_)) - shoulder_);
+
+  double cos_elbow = (target.squaredNorm() - upper_arm_length_ * upper_arm_length_ - forearm_length_ * forearm_length_) /
+                     (2.0 * upper_arm_length_ * forearm_length_);
+
+  // with an offset wrist the center is only approximate, so accept seeds slightly outside the workspace
+  double slack = 1e-9 + wrist_residual_ * (upper_arm_length_ + forearm_length_) / (upper_arm_length_ * forearm_length_);
+
+  if (std::abs(cos_elbow) > 1.0 + slack){
+    return 0;
+  }
+
+  cos_elbow = std::max(-1.0, std::min(1.0, cos_elbow));
+
+  double upper_angle = atan2(upper_arm_.y(), upper_arm_.x());
+  double fore_angle = atan2(forearm_.y(), forearm_.x());
+
+  int num = (cos_elbow > -1.0 && cos_elbow < 1.0) ? 2 : 1;
+
+  for (int i = 0; i < num; ++i){
+    double delta = (i == 0) ? acos(cos_elbow) : -acos(cos_elbow);
+
+    // planar rotation of the forearm relative to the upper arm
+    double beta = delta - fore_angle + upper_angle;
+    Eigen::Vector2d reach (upper_arm_ + rotate2d(forearm_, beta));
+    double alpha = atan2(target.y(), target.x()) - atan2(reach.y(), reach.x());
+
+    // a rotation by q around the plane normal is a planar rotation by -q in (forward, up) coordinates
+    q2[i] = normalizeAngle(-alpha);
+    q3[i] = normalizeAngle(-beta * elbow_sign_);
+  }
+
+  return num;
+}
+
+int AnalyticIK::solveWrist(const Eigen::Isometry3d& pose, double* q, double wrist_solutions[2][IKSolutions::MAX_JOINTS]) const
+{
+  Eigen::Matrix3d elbow_rotation (Eigen::Matrix3d::Identity());
+
+  for (size_t i = 0; i < 3; ++i){
+    const RevoluteJoint& joint = chain_.getJoint(i);
+    elbow_rotation = elbow_rotation * joint.origin.linear() * Eigen::AngleAxisd(q[i], joint.axis).toRotationMatrix();
+  }
+
+  // rotation the wrist joints have to produce, expressed in the elbow frame
+  Eigen::Matrix3d wrist_rotation (elbow_rotation.transpose() * pose.linear() * wrist_zero_rotation_.transpose());
+
+  Eigen::Vector3d approach_zero (wrist_zero_rotation_ * approach_tip_);
+  Eigen::Vector3d approach_desired (elbow_rotation.transpose() * pose.linear() * approach_tip_);
+
+  switch (wrist_type_){
+    case WRIST_PLANAR:{
+      const Eigen::Vector3d& pitch_axis (wrist_axes_[0]);
+
+      wrist_solutions[0][0] = rotationToAlign(pitch_axis, approach_zero, approach_desired);
+
+      if (num_wrist_joints_ == 2){
+        Eigen::Matrix3d remaining (Eigen::AngleAxisd(wrist_solutions[0][0], pitch_axis).toRotationMatrix().transpose() * wrist_rotation);
+        wrist_solutions[0][1] = closestRotation(wrist_axes_[1], remaining);
+      }
+      return 1;
+    }
+
+    case WRIST_APPROACH:{
+      double theta1[2], theta2[2];
+      int num = rotationsToAlign(wrist_axes_[0], wrist_axes_[1], approach_zero, approach_desired, theta1, theta2);
+
+      for (int i = 0; i < num; ++i){
+        wrist_solutions[i][0] = theta1[i];
+        wrist_solutions[i][1] = theta2[i];
+      }
+      return num;
+    }
+
+    case WRIST_SPHERICAL:
+    case WRIST_OFFSET:{
+      const Eigen::Vector3d& last_axis (wrist_axes_[2]);
+
+      double theta1[2], theta2[2];
+      int num = rotationsToAlign(wrist_axes_[0], wrist_axes_[1], last_axis, wrist_rotation * last_axis, theta1, theta2);
+
+      for (int i = 0; i < num; ++i){
+        Eigen::Matrix3d first_two (Eigen::AngleAxisd(theta1[i], wrist_axes_[0]) * Eigen::AngleAxisd(theta2[i], wrist_axes_[1]));
+
+        wrist_solutions[i][0] = theta1[i];
+        wrist_solutions[i][1] = theta2[i];
+        wrist_solutions[i][2] = closestRotation(last_axis, first_two.transpose() * wrist_rotation);
+      }
+      return num;
+    }
+
+    default:
+      return 0;
+  }
+}
+
+bool AnalyticIK::refine(const Eigen::Isometry3d& pose, double* q) const
+{
+  Eigen::Isometry3d frames[IKSolutions::MAX_JOINTS];
+  Eigen::Matrix<double, 6, Eigen::Dynamic> jacobian(6, num_joints_);
+  Eigen::Matrix<double, 6, 1> error;
+
+  for (int iteration = 0; iteration <= max_refinement_iterations_; ++iteration){
+    Eigen::Isometry3d current (chain_.getJointFrames(q, frames));
+
+    Eigen::AngleAxisd rotation_error (pose.linear() * current.linear().transpose());
+    error.head<3>() = pose.translation() - current.translation();
+    error.tail<3>() = rotation_error.axis() * rotation_error.angle();
+
+    if (error.head<3>().norm() < position_tolerance_ && error.tail<3>().norm() < orientation_tolerance_){
+      return true;
+    }
+
+    if (iteration == max_refinement_iterations_){
+      break;
+    }
+
+    for (size_t i = 0; i < num_joints_; ++i){
+      Eigen::Vector3d axis (frames[i].linear() * chain_.getJoint(i).axis);
+      jacobian.block<3,1>(0,i) = axis.cross(current.translation() - frames[i].translation());
+      jacobian.block<3,1>(3,i) = axis;
+    }
+
+    Eigen::Matrix<double, 6, 6> jjt (jacobian * jacobian.transpose());
+    jjt.diagonal().array() += 1e-9;
+
+    Eigen::VectorXd step (jacobian.transpose() * jjt.lu().solve(error));
+
+    for (size_t i = 0; i < num_joints_; ++i){
+      q[i] += step[i];
+    }
+  }
+
+  return false;
+}
+
+bool AnalyticIK::checkSolution(const Eigen::Isometry3d& pose, const double* q, double& orientation_error) const
+{
+  Eigen::Isometry3d current (chain_.getForwardKinematics(q));
+
+  if ((current.translation() - pose.translation()).norm() > position_tolerance_){
+    return false;
+  }
+
+  orientation_error = std::abs(Eigen::AngleAxisd(pose.linear() * current.linear().transpose()).angle());
+
+  // a spherical wrist reaches any orientation, so every valid branch has to match it
+  return wrist_type_ != WRIST_SPHERICAL || orientation_error <= orientation_tolerance_;
+}
+
+int AnalyticIK::solve(const Eigen::Isometry3d& pose, IKSolutions& solutions) const
+{
+  solutions.num_solutions = 0;
+
+  if (wrist_type_ == WRIST_UNSUPPORTED){
+    return 0;
+  }
+
+  const Eigen::Vector3d& position (pose.translation());
+
+  double q1[2];
+  int num_yaw;
+
+  // planar arms stay in the shoulder plane, so the yaw follows from the effector position directly
+  if (wrist_type_ == WRIST_PLANAR){
+    num_yaw = solveYaw(position, tip_lateral_offset_, q1);
+  }else{
+    num_yaw = solveYaw(pose * wrist_center_tip_, wrist_lateral_offset_, q1);
+  }
+
+  double q[IKSolutions::MAX_JOINTS];
+  double wrist_solutions[2][IKSolutions::MAX_JOINTS];
+  double orientation_errors[IKSolutions::MAX_SOLUTIONS];
+  double min_orientation_error = 0.0;
+
+  for (int i = 0; i < num_yaw && solutions.num_solutions < IKSolutions::MAX_SOLUTIONS; ++i){
+    Eigen::Vector3d wrist_center;
+
+    if (wrist_type_ == WRIST_PLANAR){
+      // project the requested approach direction into the plane reachable with this yaw
+      Eigen::Vector3d normal (Eigen::AngleAxisd(q1[i], yaw_axis_) * plane_normal_);
+      Eigen::Vector3d approach (pose.linear() * approach_tip_);
+      approach -= normal * normal.dot(approach);
+
+      if (approach.norm() < kParallelEpsilon){
+        continue;
+      }
+
+      wrist_center = position - approach.normalized() * approach_length_;
+    }else{
+      wrist_center = pose * wrist_center_tip_;
+    }
+
+    double q2[2], q3[2];
+    int num_elbow = solveShoulderElbow(wrist_center, q1[i], q2, q3);
+
+    for (int j = 0; j < num_elbow && solutions.num_solutions < IKSolutions::MAX_SOLUTIONS; ++j){
+      q[0] = q1[i];
+      q[1] = q2[j];
+      q[2] = q3[j];
+
+      int num_wrist = solveWrist(pose, q, wrist_solutions);
+
+      for (int k = 0; k < num_wrist && solutions.num_solutions < IKSolutions::MAX_SOLUTIONS; ++k){
+        for (size_t l = 0; l < num_wrist_joints_; ++l){
+          q[l + 3] = normalizeAngle(wrist_solutions[k][l]);
+        }
+
+        double orientation_error = 0.0;
+
+        if (wrist_type_ == WRIST_OFFSET){
+          if (!refine(pose, q)){
+            continue;
+          }
+        }else if (!checkSolution(pose, q, orientation_error)){
+          continue;
+        }
+
+        if (!chain_.wrapIntoLimits(q)){
+          continue;
+        }
+
+        if (solutions.num_solutions == 0 || orientation_error < min_orientation_error){
+          min_orientation_error = orientation_error;
+        }
+
+        orientation_errors[solutions.num_solutions] = orientation_error;
+        double* solution = solutions.q[solutions.num_solutions++];
+        std::copy(q, q + num_joints_, solution);
+      }
+    }
+  }
+
+  // drop branches that reach the position with a worse orientation than the best one
+  int num_closest = 0;
+
+  for (int i = 0; i < solutions.num_solutions; ++i){
+    if (orientation_errors[i] <= min_orientation_error + orientation_tolerance_){
+      if (num_closest != i){
+        std::copy(solutions.q[i], solutions.q[i] + num_joints_, solutions.q[num_closest]);
+      }
+      ++num_closest;
+    }
+  }
+
+  solutions.num_solutions = num_closest;
+  return solutions.num_solutions;
+}
+
+size_t AnalyticIK::solveBatch(const Eigen::Isometry3d* poses, size_t count, IKSolutions* solutions) const
+{
+  size_t num_reachable = 0;
+
+  for (size_t i = 0; i < count; ++i){
+    if (solve(poses[i], solutions[i]) > 0){
+      ++num_reachable;
+    }
+  }
+
+  return num_reachable;
+}
+
+size_t AnalyticIK::checkReachable(const Eigen::Isometry3d* poses, size_t count, unsigned char* reachable) const
+{
+  size_t num_reachable = 0;
+  IKSolutions solutions;
+
+  for (size_t i = 0; i < count; ++i){
+    reachable[i] = solve(poses[i], solutions) > 0;
+    num_reachable += reachable[i];
+  }
+
+  return num_reachable;
+}
+
+std::string AnalyticIK::getWristTypeString(WristType type)
+{
+  switch (type){
+    case WRIST_PLANAR:    return "planar";
+    case WRIST_APPROACH:  return "approach";
+    case WRIST_SPHERICAL: return "spherical";
+    case WRIST_OFFSET:    return "offset (semi-analytic)";
+    default:              return "unsupported";
+  }
+}
+
+}
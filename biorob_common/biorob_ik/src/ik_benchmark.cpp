@@ -0,0 +1,177 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <ros/ros.h>
+
+#include <biorob_ik/analytic_ik.h>
+#include <biorob_ik/urdf_chain.h>
+
+#include <kdl_parser/kdl_parser.hpp>
+#include <kdl/chainfksolverpos_recursive.hpp>
+#include <kdl/chainiksolvervel_pinv.hpp>
+#include <kdl/chainiksolverpos_nr_jl.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Compares the analytic solver against the numeric KDL solver on random reachable poses.
+ */
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "biorob_ik_benchmark");
+
+  ros::NodeHandle nh;
+  ros::NodeHandle pnh("~");
+
+  std::string openrave_file;
+  std::string base_link;
+  std::string tip_link;
+  int num_poses;
+
+  pnh.param("openrave_file", openrave_file, std::string(""));
+  pnh.param("base_link", base_link, std::string("biorob_base_link"));
+  pnh.param("tip_link", tip_link, std::string("biorob_toolframe"));
+  pnh.param("num_queries", num_poses, 10000);
+
+  if (!openrave_file.empty() && !biorob_ik::getManipulatorLinks(openrave_file, base_link, tip_link)){
+    return 1;
+  }
+
+  urdf::Model model;
+
+  if (!model.initParam("robot_description")){
+    ROS_ERROR("Could not read robot_description from parameter server");
+    return 1;
+  }
+
+  biorob_ik::KinematicChain chain;
+
+  if (!biorob_ik::getChainFromUrdf(model, base_link, tip_link, chain)){
+    return 1;
+  }
+
+  biorob_ik::AnalyticIK analytic_ik;
+
+  if (!analytic_ik.setChain(chain)){
+    ROS_ERROR("Chain %s -> %s has no analytic solution", base_link.c_str(), tip_link.c_str());
+    return 1;
+  }
+
+  ROS_INFO("Chain %s -> %s: %d joints, wrist type %s", base_link.c_str(), tip_link.c_str(), static_cast<int>(chain.getNumJoints()),
+           biorob_ik::AnalyticIK::getWristTypeString(analytic_ik.getWristType()).c_str());
+
+  size_t num_joints = chain.getNumJoints();
+  size_t num_queries = static_cast<size_t>(num_poses);
+
+  // random reachable poses
+  std::vector<Eigen::Isometry3d, Eigen::aligned_allocator<Eigen::Isometry3d> > poses (num_queries);
+  std::vector<double> q (num_joints);
+
+  srand(0);
+
+  for (size_t i = 0; i < num_queries; ++i){
+    for (size_t j = 0; j < num_joints; ++j){
+      const biorob_ik::RevoluteJoint& joint = chain.getJoint(j);
+      q[j] = joint.lower + (joint.upper - joint.lower) * (static_cast<double>(rand()) / RAND_MAX);
+    }
+    poses[i] = chain.getForwardKinematics(&q[0]);
+  }
+
+  // analytic
+  std::vector<biorob_ik::IKSolutions> solutions (num_queries);
+
+  ros::WallTime start = ros::WallTime::now();
+  size_t analytic_found = analytic_ik.solveBatch(&poses[0], num_queries, &solutions[0]);
+  double analytic_time = (ros::WallTime::now() - start).toSec();
+
+  // every returned solution has to reproduce the queried pose
+  size_t analytic_solutions = 0;
+  size_t analytic_mismatches = 0;
+
+  for (size_t i = 0; i < num_queries; ++i){
+    for (int k = 0; k < solutions[i].num_solutions; ++k){
+      Eigen::Isometry3d reached (chain.getForwardKinematics(solutions[i].q[k]));
+      Eigen::AngleAxisd rotation_error (poses[i].linear() * reached.linear().transpose());
+
+      if ((reached.translation() - poses[i].translation()).norm() > 1e-4 || std::abs(rotation_error.angle()) > 1e-4){
+        ++analytic_mismatches;
+      }
+      ++analytic_solutions;
+    }
+  }
+
+  // numeric
+  KDL::Tree tree;
+  KDL::Chain kdl_chain;
+
+  if (!kdl_parser::treeFromUrdfModel(model, tree) || !tree.getChain(base_link, tip_link, kdl_chain)){
+    ROS_ERROR("Could not build KDL chain");
+    return 1;
+  }
+
+  KDL::JntArray q_min (num_joints);
+  KDL::JntArray q_max (num_joints);
+
+  for (size_t j = 0; j < num_joints; ++j){
+    q_min(j) = chain.getJoint(j).lower;
+    q_max(j) = chain.getJoint(j).upper;
+  }
+
+  KDL::ChainFkSolverPos_recursive fk_solver (kdl_chain);
+  KDL::ChainIkSolverVel_pinv ik_vel_solver (kdl_chain);
+  KDL::ChainIkSolverPos_NR_JL ik_solver (kdl_chain, q_min, q_max, fk_solver, ik_vel_solver, 100, 1e-5);
+
+  KDL::JntArray q_init (num_joints);
+  KDL::JntArray q_out (num_joints);
+  size_t numeric_found = 0;
+
+  start = ros::WallTime::now();
+
+  for (size_t i = 0; i < num_queries; ++i){
+    const Eigen::Isometry3d& pose = poses[i];
+    KDL::Frame frame (KDL::Rotation(pose(0,0), pose(0,1), pose(0,2),
+                                    pose(1,0), pose(1,1), pose(1,2),
+                                    pose(2,0), pose(2,1), pose(2,2)),
+                      KDL::Vector(pose(0,3), pose(1,3), pose(2,3)));
+
+    if (ik_solver.CartToJnt(q_init, frame, q_out) >= 0){
+      ++numeric_found;
+    }
+  }
+
+  double numeric_time = (ros::WallTime::now() - start).toSec();
+
+  ROS_INFO("analytic: %.0f queries/s, %d/%d solved, %d of %d solutions do not reach the pose", num_queries / analytic_time,
+           static_cast<int>(analytic_found), static_cast<int>(num_queries), static_cast<int>(analytic_mismatches), static_cast<int>(analytic_solutions));
+  ROS_INFO("numeric:  %.0f queries/s, %d/%d solved", num_queries / numeric_time, static_cast<int>(numeric_found), static_cast<int>(num_queries));
+
+  return 0;
+}
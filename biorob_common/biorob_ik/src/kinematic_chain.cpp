@@ -0,0 +1,112 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+#include <biorob_ik/kinematic_chain.h>
+
+#include <cmath>
+
+namespace biorob_ik{
+
+KinematicChain::KinematicChain()
+  : tip_(Eigen::Isometry3d::Identity())
+{
+  model_.addLink("base", -1, Eigen::Isometry3d::Identity());
+}
+
+bool KinematicChain::addJoint(const std::string& name, const Eigen::Isometry3d& origin, const Eigen::Vector3d& axis, double lower, double upper)
+{
+  if (joints_.size() >= MAX_JOINTS){
+    return false;
+  }
+
+  RevoluteJoint joint;
+  joint.name = name;
+  joint.origin = tip_ * origin;
+  joint.axis = axis.normalized();
+  joint.lower = lower;
+  joint.upper = upper;
+
+  // link i + 1 is moved by joint i
+  model_.addLink(name, static_cast<int>(joints_.size()), joint.origin, hector_batch_kinematics::KinematicModel::REVOLUTE, name, joint.axis, lower, upper);
+  joints_.push_back(joint);
+
+  tip_.setIdentity();
+  return true;
+}
+
+void KinematicChain::addFixed(const Eigen::Isometry3d& transform)
+{
+  tip_ = tip_ * transform;
+}
+
+Eigen::Isometry3d KinematicChain::getForwardKinematics(const double* q) const
+{
+  hector_batch_kinematics::Transform pose;
+  model_.computeLinkPose(q, joints_.size(), pose);
+
+  return pose.toEigen() * tip_;
+}
+
+Eigen::Isometry3d KinematicChain::getJointFrames(const double* q, Eigen::Isometry3d* frames) const
+{
+  hector_batch_kinematics::Transform poses[MAX_JOINTS + 1];
+  model_.computeLinkPoses(q, poses);
+
+  size_t size = joints_.size();
+
+  for (size_t i = 0; i < size; ++i){
+    frames[i] = poses[i + 1].toEigen();
+  }
+
+  return poses[size].toEigen() * tip_;
+}
+
+bool KinematicChain::wrapIntoLimits(double* q) const
+{
+  size_t size = joints_.size();
+
+  for (size_t i = 0; i < size; ++i){
+    const RevoluteJoint& joint = joints_[i];
+
+    while (q[i] > joint.upper){
+      q[i] -= 2.0 * M_PI;
+    }
+
+    while (q[i] < joint.lower){
+      q[i] += 2.0 * M_PI;
+    }
+
+    if (q[i] > joint.upper){
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}
@@ -0,0 +1,132 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <biorob_ik/urdf_chain.h>
+
+#include <ros/console.h>
+#include <tinyxml.h>
+
+#include <cmath>
+#include <vector>
+
+namespace biorob_ik{
+
+static Eigen::Isometry3d toEigen(const urdf::Pose& pose)
+{
+  Eigen::Isometry3d transform (Eigen::Isometry3d::Identity());
+  transform.translation() = Eigen::Vector3d(pose.position.x, pose.position.y, pose.position.z);
+  transform.linear() = Eigen::Quaterniond(pose.rotation.w, pose.rotation.x, pose.rotation.y, pose.rotation.z).toRotationMatrix();
+  return transform;
+}
+
+bool getChainFromUrdf(const urdf::Model& model, const std::string& base_link, const std::string& tip_link, KinematicChain& chain)
+{
+  boost::shared_ptr<const urdf::Link> link = model.getLink(tip_link);
+
+  if (!link){
+    ROS_ERROR("Link %s not found in robot description", tip_link.c_str());
+    return false;
+  }
+
+  // walk up from the tip, the joints are collected in reverse order
+  std::vector<boost::shared_ptr<urdf::Joint> > joints;
+
+  while (link->name != base_link){
+    if (!link->parent_joint){
+      ROS_ERROR("Link %s is not a parent of %s", base_link.c_str(), tip_link.c_str());
+      return false;
+    }
+
+    joints.push_back(link->parent_joint);
+    link = link->getParent();
+  }
+
+  chain = KinematicChain();
+
+  for (std::vector<boost::shared_ptr<urdf::Joint> >::reverse_iterator it = joints.rbegin(); it != joints.rend(); ++it){
+    const urdf::Joint& joint = **it;
+    Eigen::Isometry3d origin (toEigen(joint.parent_to_joint_origin_transform));
+
+    switch (joint.type){
+      case urdf::Joint::FIXED:
+        chain.addFixed(origin);
+        break;
+
+      case urdf::Joint::REVOLUTE:
+      case urdf::Joint::CONTINUOUS:{
+        double lower = joint.type == urdf::Joint::CONTINUOUS ? -M_PI : joint.limits->lower;
+        double upper = joint.type == urdf::Joint::CONTINUOUS ?  M_PI : joint.limits->upper;
+
+        if (!chain.addJoint(joint.name, origin, Eigen::Vector3d(joint.axis.x, joint.axis.y, joint.axis.z), lower, upper)){
+          ROS_ERROR("Chain %s -> %s has more than %d joints", base_link.c_str(), tip_link.c_str(), static_cast<int>(KinematicChain::MAX_JOINTS));
+          return false;
+        }
+        break;
+      }
+
+      default:
+        ROS_ERROR("Joint %s is neither revolute nor fixed, chain is not supported", joint.name.c_str());
+        return false;
+    }
+  }
+
+  return true;
+}
+
+bool getManipulatorLinks(const std::string& openrave_file, std::string& base_link, std::string& tip_link)
+{
+  TiXmlDocument doc (openrave_file);
+
+  if (!doc.LoadFile()){
+    ROS_ERROR("Could not load OpenRAVE robot file %s", openrave_file.c_str());
+    return false;
+  }
+
+  TiXmlElement* robot = doc.FirstChildElement("Robot");
+  TiXmlElement* manipulator = robot ? robot->FirstChildElement("Manipulator") : 0;
+
+  if (!manipulator){
+    ROS_ERROR("No manipulator defined in %s", openrave_file.c_str());
+    return false;
+  }
+
+  TiXmlElement* base = manipulator->FirstChildElement("base");
+  TiXmlElement* effector = manipulator->FirstChildElement("effector");
+
+  if (!base || !effector || !base->GetText() || !effector->GetText()){
+    ROS_ERROR("Manipulator in %s lacks base or effector", openrave_file.c_str());
+    return false;
+  }
+
+  base_link = base->GetText();
+  tip_link = effector->GetText();
+  return true;
+}
+
+}
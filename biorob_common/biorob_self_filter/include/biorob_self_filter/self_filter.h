@@ -0,0 +1,121 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef biorob_self_filter_self_filter_h__
+#define biorob_self_filter_self_filter_h__
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <vector>
+
+namespace biorob_self_filter{
+
+/**
+ * Convex collision primitive attached to a link, already padded and scaled.
+ * Cylinders are aligned with the local z axis as in URDF.
+ */
+struct Shape
+{
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  enum Type { BOX, CYLINDER, SPHERE };
+
+  Type type;
+  int link;                   // index of the link the shape is attached to
+  Eigen::Isometry3f origin;   // shape frame relative to the link frame
+  Eigen::Vector3f half_size;  // box: half extents, cylinder: (radius, radius, half length), sphere: (radius, radius, radius)
+};
+
+/**
+ * Point containment test against a set of padded convex primitives.
+ *
+ * Usage per cloud: setLinkTransform() for every link whose pose changed (only needed when the joint
+ * states change), setSensorTransform() with the pose of the cloud frame, then computeMask().
+ * Points are tested four at a time in the local frame of each shape. A bounding sphere around all
+ * shapes rejects the bulk of a cloud before the exact tests.
+ */
+class SelfFilter
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  SelfFilter();
+
+  /// Adds a shape; dimensions are the unpadded URDF values (box: size, cylinder: radius/length, sphere: radius)
+  void addBox(int link, const Eigen::Isometry3f& origin, const Eigen::Vector3f& size);
+  void addCylinder(int link, const Eigen::Isometry3f& origin, float radius, float length);
+  void addSphere(int link, const Eigen::Isometry3f& origin, float radius);
+
+  /// Padding is added to all dimensions after scaling. Call before adding shapes.
+  void setPadding(float padding, float scale) { padding_ = padding; scale_ = scale; }
+
+  size_t getNumShapes() const { return shapes_.size(); }
+  const Shape& getShape(size_t i) const { return shapes_[i]; }
+
+  /// Link pose relative to the filter root frame
+  void setLinkTransform(int link, const Eigen::Isometry3f& transform);
+
+  /// Pose of the sensor (cloud) frame relative to the filter root frame; precomputes the per shape transforms
+  void setSensorTransform(const Eigen::Isometry3f& root_to_sensor);
+
+  /**
+   * Sets mask[i] to 1 for points inside any shape, 0 otherwise. Points are read from an interleaved
+   * buffer (e.g. PointCloud2 data) with the given stride and x/y/z byte offsets. NaN points are never inside.
+   * Returns the number of points inside.
+   */
+  size_t computeMask(const unsigned char* data, size_t point_step, size_t x_offset, size_t y_offset, size_t z_offset,
+                     size_t num_points, unsigned char* mask) const;
+
+protected:
+  void addShape(Shape::Type type, int link, const Eigen::Isometry3f& origin, const Eigen::Vector3f& half_size);
+
+  /// Sensor to shape transform and squared limits, laid out for broadcasting
+  struct CompiledShape
+  {
+    float rotation[9];
+    float translation[3];
+    float limits[3];  // box: half extents, cylinder: squared radius, half length, sphere: squared radius
+    Shape::Type type;
+  };
+
+  std::vector<Shape, Eigen::aligned_allocator<Shape> > shapes_;
+  std::vector<Eigen::Isometry3f, Eigen::aligned_allocator<Eigen::Isometry3f> > link_transforms_;
+  std::vector<CompiledShape> compiled_;
+
+  float bounding_center_[3];
+  float bounding_radius_squared_;
+
+  float padding_;
+  float scale_;
+};
+
+}
+
+#endif
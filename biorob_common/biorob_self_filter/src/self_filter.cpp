@@ -0,0 +1,338 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <biorob_self_filter/self_filter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace biorob_self_filter{
+
+SelfFilter::SelfFilter()
+  : bounding_radius_squared_(-1.0f)
+  , padding_(0.0f)
+  , scale_(1.0f)
+{
+  bounding_center_[0] = bounding_center_[1] = bounding_center_[2] = 0.0f;
+}
+
+void SelfFilter::addBox(int link, const Eigen::Isometry3f& origin, const Eigen::Vector3f& size)
+{
+  addShape(Shape::BOX, link, origin, size * (0.5f * scale_) + Eigen::Vector3f::Constant(padding_));
+}
+
+void SelfFilter::addCylinder(int link, const Eigen::Isometry3f& origin, float radius, float length)
+{
+  float padded_radius = radius * scale_ + padding_;
+  addShape(Shape::CYLINDER, link, origin, Eigen::Vector3f(padded_radius, padded_radius, length * 0.5f * scale_ + padding_));
+}
+
+void SelfFilter::addSphere(int link, const Eigen::Isometry3f& origin, float radius)
+{
+  addShape(Shape::SPHERE, link, origin, Eigen::Vector3f::Constant(radius * scale_ + padding_));
+}
+
+void SelfFilter::addShape(Shape::Type type, int link, const Eigen::Isometry3f& origin, const Eigen::Vector3f& half_size)
+{
+  Shape shape;
+  shape.type = type;
+  shape.link = link;
+  shape.origin = origin;
+  shape.half_size = half_size;
+  shapes_.push_back(shape);
+
+  if (static_cast<int>(link_transforms_.size()) <= link){
+    link_transforms_.resize(link + 1, Eigen::Isometry3f::Identity());
+  }
+
+  compiled_.resize(shapes_.size());
+}
+
+void SelfFilter::setLinkTransform(int link, const Eigen::Isometry3f& transform)
+{
+  if (link >= 0 && link < static_cast<int>(link_transforms_.size())){
+    link_transforms_[link] = transform;
+  }
+}
+
+void SelfFilter::setSensorTransform(const Eigen::Isometry3f& root_to_sensor)
+{
+  size_t num_shapes = shapes_.size();
+
+  if (num_shapes == 0){
+    bounding_radius_squared_ = -1.0f;
+    return;
+  }
+
+  // shape centers and enclosing radii in the sensor frame
+  std::vector<Eigen::Vector3f, Eigen::aligned_allocator<Eigen::Vector3f> > centers (num_shapes);
+  std::vector<float> radii (num_shapes);
+  Eigen::Vector3f mean (Eigen::Vector3f::Zero());
+
+  for (size_t i = 0; i < num_shapes; ++i){
+    const Shape& shape = shapes_[i];
+    CompiledShape& compiled = compiled_[i];
+
+    Eigen::Isometry3f sensor_to_shape ((root_to_sensor.inverse() * link_transforms_[shape.link] * shape.origin).inverse());
+
+    Eigen::Matrix3f rotation (sensor_to_shape.linear());
+    for (int r = 0; r < 3; ++r){
+      for (int c = 0; c < 3; ++c){
+        compiled.rotation[r * 3 + c] = rotation(r, c);
+      }
+      compiled.translation[r] = sensor_to_shape.translation()[r];
+    }
+
+    compiled.type = shape.type;
+    const Eigen::Vector3f& half = shape.half_size;
+
+    switch (shape.type){
+      case Shape::BOX:
+        compiled.limits[0] = half.x();
+        compiled.limits[1] = half.y();
+        compiled.limits[2] = half.z();
+        radii[i] = half.norm();
+        break;
+
+      case Shape::CYLINDER:
+        compiled.limits[0] = half.x() * half.x();
+        compiled.limits[1] = half.z();
+        compiled.limits[2] = 0.0f;
+        radii[i] = std::sqrt(half.x() * half.x() + half.z() * half.z());
+        break;
+
+      case Shape::SPHERE:
+        compiled.limits[0] = half.x() * half.x();
+        compiled.limits[1] = compiled.limits[2] = 0.0f;
+        radii[i] = half.x();
+        break;
+    }
+
+    centers[i] = sensor_to_shape.inverse().translation();
+    mean += centers[i];
+  }
+
+  mean /= static_cast<float>(num_shapes);
+
+  float radius = 0.0f;
+  for (size_t i = 0; i < num_shapes; ++i){
+    radius = std::max(radius, (centers[i] - mean).norm() + radii[i]);
+  }
+
+  bounding_center_[0] = mean.x();
+  bounding_center_[1] = mean.y();
+  bounding_center_[2] = mean.z();
+  bounding_radius_squared_ = radius * radius;
+}
+
+static inline float readFloat(const unsigned char* ptr)
+{
+  float value;
+  std::memcpy(&value, ptr, sizeof(float));
+  return value;
+}
+
+#ifdef __SSE2__
+
+static inline __m128 absPs(__m128 v)
+{
+  return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+size_t SelfFilter::computeMask(const unsigned char* data, size_t point_step, size_t x_offset, size_t y_offset, size_t z_offset,
+                               size_t num_points, unsigned char* mask) const
+{
+  std::memset(mask, 0, num_points);
+
+  if (bounding_radius_squared_ < 0.0f){
+    return 0;
+  }
+
+  const __m128 center_x = _mm_set1_ps(bounding_center_[0]);
+  const __m128 center_y = _mm_set1_ps(bounding_center_[1]);
+  const __m128 center_z = _mm_set1_ps(bounding_center_[2]);
+  const __m128 bounding_radius_squared = _mm_set1_ps(bounding_radius_squared_);
+
+  size_t num_shapes = compiled_.size();
+  size_t num_inside = 0;
+
+  for (size_t i = 0; i < num_points; i += 4){
+    size_t block_size = std::min(static_cast<size_t>(4), num_points - i);
+
+    float x[4] = { NAN, NAN, NAN, NAN };
+    float y[4] = { NAN, NAN, NAN, NAN };
+    float z[4] = { NAN, NAN, NAN, NAN };
+
+    const unsigned char* point = data + i * point_step;
+    for (size_t j = 0; j < block_size; ++j, point += point_step){
+      x[j] = readFloat(point + x_offset);
+      y[j] = readFloat(point + y_offset);
+      z[j] = readFloat(point + z_offset);
+    }
+
+    __m128 px = _mm_loadu_ps(x);
+    __m128 py = _mm_loadu_ps(y);
+    __m128 pz = _mm_loadu_ps(z);
+
+    // cull against the bounding sphere first, most points of a cloud are far away from the arm
+    __m128 dx = _mm_sub_ps(px, center_x);
+    __m128 dy = _mm_sub_ps(py, center_y);
+    __m128 dz = _mm_sub_ps(pz, center_z);
+    __m128 distance_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+    if (_mm_movemask_ps(_mm_cmple_ps(distance_squared, bounding_radius_squared)) == 0){
+      continue;
+    }
+
+    __m128 inside = _mm_setzero_ps();
+
+    for (size_t s = 0; s < num_shapes; ++s){
+      const CompiledShape& shape = compiled_[s];
+      const float* r = shape.rotation;
+      const float* t = shape.translation;
+
+      __m128 lx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r[0]), px), _mm_mul_ps(_mm_set1_ps(r[1]), py)),
+                             _mm_add_ps(_mm_mul_ps(_mm_set1_ps(r[2]), pz), _mm_set1_ps(t[0])));
+      __m128 ly = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r[3]), px), _mm_mul_ps(_mm_set1_ps(r[4]), py)),
+                             _mm_add_ps(_mm_mul_ps(_mm_set1_ps(r[5]), pz), _mm_set1_ps(t[1])));
+      __m128 lz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r[6]), px), _mm_mul_ps(_mm_set1_ps(r[7]), py)),
+                             _mm_add_ps(_mm_mul_ps(_mm_set1_ps(r[8]), pz), _mm_set1_ps(t[2])));
+
+      __m128 shape_inside;
+
+      switch (shape.type){
+        case Shape::BOX:
+          shape_inside = _mm_and_ps(_mm_and_ps(_mm_cmple_ps(absPs(lx), _mm_set1_ps(shape.limits[0])),
+                                               _mm_cmple_ps(absPs(ly), _mm_set1_ps(shape.limits[1]))),
+                                    _mm_cmple_ps(absPs(lz), _mm_set1_ps(shape.limits[2])));
+          break;
+
+        case Shape::CYLINDER:
+          shape_inside = _mm_and_ps(_mm_cmple_ps(_mm_add_ps(_mm_mul_ps(lx, lx), _mm_mul_ps(ly, ly)), _mm_set1_ps(shape.limits[0])),
+                                    _mm_cmple_ps(absPs(lz), _mm_set1_ps(shape.limits[1])));
+          break;
+
+        default:
+          shape_inside = _mm_cmple_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(lx, lx), _mm_mul_ps(ly, ly)), _mm_mul_ps(lz, lz)),
+                                      _mm_set1_ps(shape.limits[0]));
+          break;
+      }
+
+      inside = _mm_or_ps(inside, shape_inside);
+
+      if (_mm_movemask_ps(inside) == 0xf){
+        break;
+      }
+    }
+
+    int bits = _mm_movemask_ps(inside);
+
+    for (size_t j = 0; j < block_size; ++j){
+      if (bits & (1 << j)){
+        mask[i + j] = 1;
+        ++num_inside;
+      }
+    }
+  }
+
+  return num_inside;
+}
+
+#else
+
+size_t SelfFilter::computeMask(const unsigned char* data, size_t point_step, size_t x_offset, size_t y_offset, size_t z_offset,
+                               size_t num_points, unsigned char* mask) const
+{
+  std::memset(mask, 0, num_points);
+
+  if (bounding_radius_squared_ < 0.0f){
+    return 0;
+  }
+
+  size_t num_shapes = compiled_.size();
+  size_t num_inside = 0;
+
+  const unsigned char* point = data;
+  for (size_t i = 0; i < num_points; ++i, point += point_step){
+    float px = readFloat(point + x_offset);
+    float py = readFloat(point + y_offset);
+    float pz = readFloat(point + z_offset);
+
+    float dx = px - bounding_center_[0];
+    float dy = py - bounding_center_[1];
+    float dz = pz - bounding_center_[2];
+
+    if (!(dx * dx + dy * dy + dz * dz <= bounding_radius_squared_)){
+      continue;
+    }
+
+    for (size_t s = 0; s < num_shapes; ++s){
+      const CompiledShape& shape = compiled_[s];
+      const float* r = shape.rotation;
+      const float* t = shape.translation;
+
+      float lx = r[0] * px + r[1] * py + r[2] * pz + t[0];
+      float ly = r[3] * px + r[4] * py + r[5] * pz + t[1];
+      float lz = r[6] * px + r[7] * py + r[8] * pz + t[2];
+
+      bool shape_inside;
+
+      switch (shape.type){
+        case Shape::BOX:
+          shape_inside = std::abs(lx) <= shape.limits[0] && std::abs(ly) <= shape.limits[1] && std::abs(lz) <= shape.limits[2];
+          break;
+
+        case Shape::CYLINDER:
+          shape_inside = lx * lx + ly * ly <= shape.limits[0] && std::abs(lz) <= shape.limits[1];
+          break;
+
+        default:
+          shape_inside = lx * lx + ly * ly + lz * lz <= shape.limits[0];
+          break;
+      }
+
+      if (shape_inside){
+        mask[i] = 1;
+        ++num_inside;
+        break;
+      }
+    }
+  }
+
+  return num_inside;
+}
+
+#endif
+
+}
@@ -0,0 +1,333 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <sensor_msgs/JointState.h>
+#include <tf/transform_listener.h>
+#include <urdf/model.h>
+
+#include <biorob_self_filter/self_filter.h>
+#include <hector_batch_kinematics/urdf_loader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+
+/**
+ * Removes points on the arm from point clouds. The collision geometry of the robot description
+ * (use the *_self_filter models) is compiled into padded primitives once; link poses are only
+ * recomputed when the joint states change.
+ */
+class SelfFilterNode
+{
+public:
+
+  SelfFilterNode()
+    : joints_changed_(true)
+  {
+    ros::NodeHandle nh_;
+    ros::NodeHandle pnh_("~");
+
+    pnh_.param("padding", p_padding_, 0.02);
+    pnh_.param("scale", p_scale_, 1.0);
+    pnh_.param("transform_timeout", p_transform_timeout_, 0.1);
+    pnh_.param("description_param", p_description_param_, std::string("self_filter_description"));
+    pnh_.param("root_link", p_root_link_, std::string(""));
+
+    if (!model_.initParam(p_description_param_)){
+      ROS_ERROR("Could not read %s from parameter server", p_description_param_.c_str());
+      return;
+    }
+
+    boost::shared_ptr<const urdf::Link> root = p_root_link_.empty() ? model_.getRoot() : model_.getLink(p_root_link_);
+
+    if (!root){
+      ROS_ERROR("Root link %s not found in %s", p_root_link_.c_str(), p_description_param_.c_str());
+      return;
+    }
+
+    if (!hector_batch_kinematics::loadFromUrdf(model_, kinematics_, root->name)){
+      return;
+    }
+
+    joint_values_.resize(kinematics_.getNumVariables(), 0.0);
+    for (size_t i = 0; i < kinematics_.getNumVariables(); ++i){
+      variables_[kinematics_.getVariableName(i)] = static_cast<int>(i);
+    }
+
+    root_frame_ = root->name;
+    filter_.setPadding(static_cast<float>(p_padding_), static_cast<float>(p_scale_));
+    addLink(root);
+
+    ROS_INFO("Self filter for %s: %d primitives on %d links, root frame %s", model_.getName().c_str(),
+             static_cast<int>(filter_.getNumShapes()), static_cast<int>(kinematics_.getNumLinks()), root_frame_.c_str());
+
+    joint_state_sub_ = nh_.subscribe("joint_states", 10, &SelfFilterNode::jointStateCallback, this);
+    cloud_sub_ = nh_.subscribe("cloud_in", 1, &SelfFilterNode::cloudCallback, this);
+    cloud_pub_ = nh_.advertise<sensor_msgs::PointCloud2>("cloud_out", 1, false);
+  }
+
+  void jointStateCallback(const sensor_msgs::JointState::ConstPtr& joint_state)
+  {
+    size_t size = std::min(joint_state->name.size(), joint_state->position.size());
+
+    for (size_t i = 0; i < size; ++i){
+      std::map<std::string, int>::const_iterator it = variables_.find(joint_state->name[i]);
+
+      if (it != variables_.end() && std::abs(joint_values_[it->second] - joint_state->position[i]) > 1e-6){
+        joint_values_[it->second] = joint_state->position[i];
+        joints_changed_ = true;
+      }
+    }
+  }
+
+  void cloudCallback(const sensor_msgs::PointCloud2::ConstPtr& cloud_in)
+  {
+    size_t num_points = cloud_in->width * cloud_in->height;
+
+    // an empty cloud has nothing to filter (and no data to point into), forward it as is
+    if (num_points == 0){
+      cloud_pub_.publish(cloud_in);
+      return;
+    }
+
+    int x_offset = -1, y_offset = -1, z_offset = -1;
+
+    for (size_t i = 0; i < cloud_in->fields.size(); ++i){
+      const sensor_msgs::PointField& field = cloud_in->fields[i];
+
+      if (field.datatype != sensor_msgs::PointField::FLOAT32){
+        continue;
+      }
+
+      if (field.name == "x"){
+        x_offset = field.offset;
+      }else if (field.name == "y"){
+        y_offset = field.offset;
+      }else if (field.name == "z"){
+        z_offset = field.offset;
+      }
+    }
+
+    if (x_offset < 0 || y_offset < 0 || z_offset < 0){
+      ROS_ERROR_THROTTLE(1.0, "Cloud has no float32 x/y/z fields, cannot filter");
+      return;
+    }
+
+    if (std::max(x_offset, std::max(y_offset, z_offset)) + sizeof(float) > cloud_in->point_step ||
+        cloud_in->row_step < cloud_in->width * cloud_in->point_step || cloud_in->data.size() < cloud_in->height * cloud_in->row_step){
+      ROS_ERROR_THROTTLE(1.0, "Cloud data does not match its size (%u x %u, point step %u, row step %u, %u bytes), cannot filter",
+                         cloud_in->width, cloud_in->height, cloud_in->point_step, cloud_in->row_step, static_cast<unsigned int>(cloud_in->data.size()));
+      return;
+    }
+
+    tf::StampedTransform sensor_transform;
+
+    try{
+      tfl_.waitForTransform(root_frame_, cloud_in->header.frame_id, cloud_in->header.stamp, ros::Duration(p_transform_timeout_));
+      tfl_.lookupTransform(root_frame_, cloud_in->header.frame_id, cloud_in->header.stamp, sensor_transform);
+    }catch(tf::TransformException& e){
+      ROS_ERROR_THROTTLE(1.0, "Cannot transform from %s to %s: %s", cloud_in->header.frame_id.c_str(), root_frame_.c_str(), e.what());
+      return;
+    }
+
+    if (joints_changed_){
+      updateLinkTransforms();
+      joints_changed_ = false;
+    }
+
+    ros::WallTime start = ros::WallTime::now();
+
+    filter_.setSensorTransform(toEigen(sensor_transform));
+
+    mask_.resize(num_points);
+
+    // rows are masked separately, organized clouds may pad their rows beyond width * point_step
+    size_t num_inside = 0;
+    for (size_t row = 0; row < cloud_in->height; ++row){
+      num_inside += filter_.computeMask(&cloud_in->data[row * cloud_in->row_step], cloud_in->point_step, x_offset, y_offset, z_offset,
+                                        cloud_in->width, &mask_[row * cloud_in->width]);
+    }
+
+    cloud_out_.header = cloud_in->header;
+    cloud_out_.fields = cloud_in->fields;
+    cloud_out_.is_bigendian = cloud_in->is_bigendian;
+    cloud_out_.point_step = cloud_in->point_step;
+
+    if (cloud_in->height > 1){
+      // keep organized clouds organized, filtered points are set to NaN
+      cloud_out_.height = cloud_in->height;
+      cloud_out_.width = cloud_in->width;
+      cloud_out_.row_step = cloud_in->row_step;
+      cloud_out_.is_dense = false;
+      cloud_out_.data = cloud_in->data;
+
+      const float nan = std::numeric_limits<float>::quiet_NaN();
+
+      for (size_t i = 0; i < num_points; ++i){
+        if (mask_[i]){
+          unsigned char* point = &cloud_out_.data[(i / cloud_in->width) * cloud_in->row_step + (i % cloud_in->width) * cloud_in->point_step];
+          std::memcpy(point + x_offset, &nan, sizeof(float));
+          std::memcpy(point + y_offset, &nan, sizeof(float));
+          std::memcpy(point + z_offset, &nan, sizeof(float));
+        }
+      }
+    }else{
+      size_t num_outside = num_points - num_inside;
+      cloud_out_.height = 1;
+      cloud_out_.width = num_outside;
+      cloud_out_.row_step = num_outside * cloud_in->point_step;
+      cloud_out_.is_dense = cloud_in->is_dense;
+      cloud_out_.data.resize(cloud_out_.row_step);
+
+      unsigned char* out = cloud_out_.data.empty() ? 0 : &cloud_out_.data[0];
+      const unsigned char* in = &cloud_in->data[0];
+
+      for (size_t i = 0; i < num_points; ++i, in += cloud_in->point_step){
+        if (!mask_[i]){
+          std::memcpy(out, in, cloud_in->point_step);
+          out += cloud_in->point_step;
+        }
+      }
+    }
+
+    ROS_DEBUG("Filtered %d of %d points in %f ms", static_cast<int>(num_inside), static_cast<int>(num_points), (ros::WallTime::now() - start).toSec() * 1000.0);
+
+    cloud_pub_.publish(cloud_out_);
+  }
+
+protected:
+
+  void addLink(const boost::shared_ptr<const urdf::Link>& link)
+  {
+    // shapes are attached to the link index of the kinematic model
+    int index = kinematics_.getLinkIndex(link->name);
+
+    if (index < 0){
+      if (link->collision && link->collision->geometry){
+        ROS_WARN("Link %s is not part of the kinematic model, ignoring its collision geometry", link->name.c_str());
+      }
+    }else if (link->collision && link->collision->geometry){
+      const urdf::Geometry& geometry = *link->collision->geometry;
+      Eigen::Isometry3f origin (toEigen(link->collision->origin));
+
+      switch (geometry.type){
+        case urdf::Geometry::BOX:{
+          const urdf::Box& box = static_cast<const urdf::Box&>(geometry);
+          filter_.addBox(index, origin, Eigen::Vector3f(box.dim.x, box.dim.y, box.dim.z));
+          break;
+        }
+        case urdf::Geometry::CYLINDER:{
+          const urdf::Cylinder& cylinder = static_cast<const urdf::Cylinder&>(geometry);
+          filter_.addCylinder(index, origin, cylinder.radius, cylinder.length);
+          break;
+        }
+        case urdf::Geometry::SPHERE:{
+          const urdf::Sphere& sphere = static_cast<const urdf::Sphere&>(geometry);
+          filter_.addSphere(index, origin, sphere.radius);
+          break;
+        }
+        default:
+          ROS_WARN("Ignoring mesh collision geometry of link %s, use a self filter model with primitive shapes", link->name.c_str());
+          break;
+      }
+    }
+
+    for (size_t i = 0; i < link->child_links.size(); ++i){
+      addLink(link->child_links[i]);
+    }
+  }
+
+  void updateLinkTransforms()
+  {
+    link_poses_.resize(kinematics_.getNumLinks());
+    kinematics_.computeLinkPoses(joint_values_.empty() ? 0 : &joint_values_[0], &link_poses_[0]);
+
+    for (size_t i = 0; i < link_poses_.size(); ++i){
+      filter_.setLinkTransform(static_cast<int>(i), link_poses_[i].toEigen().cast<float>());
+    }
+  }
+
+  static Eigen::Isometry3f toEigen(const urdf::Pose& pose)
+  {
+    Eigen::Isometry3f transform (Eigen::Isometry3f::Identity());
+    transform.translation() = Eigen::Vector3f(pose.position.x, pose.position.y, pose.position.z);
+    transform.linear() = Eigen::Quaternionf(pose.rotation.w, pose.rotation.x, pose.rotation.y, pose.rotation.z).toRotationMatrix();
+    return transform;
+  }
+
+  static Eigen::Isometry3f toEigen(const tf::Transform& tf_transform)
+  {
+    const tf::Vector3& origin = tf_transform.getOrigin();
+    tf::Quaternion rotation = tf_transform.getRotation();
+
+    Eigen::Isometry3f transform (Eigen::Isometry3f::Identity());
+    transform.translation() = Eigen::Vector3f(origin.x(), origin.y(), origin.z());
+    transform.linear() = Eigen::Quaternionf(rotation.w(), rotation.x(), rotation.y(), rotation.z()).toRotationMatrix();
+    return transform;
+  }
+
+  ros::Subscriber joint_state_sub_;
+  ros::Subscriber cloud_sub_;
+  ros::Publisher cloud_pub_;
+
+  tf::TransformListener tfl_;
+
+  urdf::Model model_;
+  std::string root_frame_;
+
+  biorob_self_filter::SelfFilter filter_;
+
+  hector_batch_kinematics::KinematicModel kinematics_;
+  std::vector<hector_batch_kinematics::Transform> link_poses_;
+  std::vector<double> joint_values_;
+  std::map<std::string, int> variables_;
+  bool joints_changed_;
+
+  std::vector<unsigned char> mask_;
+  sensor_msgs::PointCloud2 cloud_out_;
+
+  double p_padding_;
+  double p_scale_;
+  double p_transform_timeout_;
+  std::string p_description_param_;
+  std::string p_root_link_;
+};
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "biorob_self_filter_node");
+
+  SelfFilterNode sf;
+
+  ros::spin();
+}
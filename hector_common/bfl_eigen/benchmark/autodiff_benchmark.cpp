@@ -0,0 +1,160 @@
+#include <autodiff_EIGEN.h>
+
+#include <Eigen/Geometry>
+
+#include <cstdio>
+#include <cstdlib>
+#include <sys/time.h>
+
+// Compares the automatic differentiation Jacobians of the Eigen wrapper against finite differences
+// for two typical filter models:
+//  - 6 states: planar vehicle (x, y, yaw, v, yaw rate, acceleration), constant turn rate model
+//  - 15 states: strapdown INS (position, velocity, roll/pitch/yaw, gyro and accelerometer biases)
+
+using MatrixWrapper::AutoDiff::jacobian;
+using MatrixWrapper::AutoDiff::numericJacobian;
+
+struct PlanarModel
+{
+  double dt;
+
+  template <typename T>
+  void operator()(const Eigen::Matrix<T,6,1>& x, Eigen::Matrix<T,6,1>& y) const
+  {
+    using std::cos; using std::sin;
+
+    T yaw = x(2) + 0.5 * dt * x(4);
+    y(0) = x(0) + dt * cos(yaw) * x(3);
+    y(1) = x(1) + dt * sin(yaw) * x(3);
+    y(2) = x(2) + dt * x(4);
+    y(3) = x(3) + dt * x(5);
+    y(4) = x(4);
+    y(5) = x(5);
+  }
+};
+
+struct InsModel
+{
+  double dt;
+  double gyro[3];
+  double acc[3];
+
+  template <typename T>
+  void operator()(const Eigen::Matrix<T,15,1>& x, Eigen::Matrix<T,15,1>& y) const
+  {
+    using std::cos; using std::sin; using std::tan;
+
+    T roll = x(6), pitch = x(7), yaw = x(8);
+    T cr = cos(roll), sr = sin(roll), cp = cos(pitch), sp = sin(pitch), cy = cos(yaw), sy = sin(yaw);
+
+    // body rates and accelerations corrected by the bias estimates
+    T wx = gyro[0] - x(9), wy = gyro[1] - x(10), wz = gyro[2] - x(11);
+    T ax = acc[0] - x(12), ay = acc[1] - x(13), az = acc[2] - x(14);
+
+    // rotation body -> nav (ZYX euler angles)
+    T r00 = cy*cp, r01 = cy*sp*sr - sy*cr, r02 = cy*sp*cr + sy*sr;
+    T r10 = sy*cp, r11 = sy*sp*sr + cy*cr, r12 = sy*sp*cr - cy*sr;
+    T r20 = -sp,   r21 = cp*sr,            r22 = cp*cr;
+
+    T an0 = r00*ax + r01*ay + r02*az;
+    T an1 = r10*ax + r11*ay + r12*az;
+    T an2 = r20*ax + r21*ay + r22*az - 9.81;
+
+    y(0) = x(0) + dt * x(3) + 0.5 * dt * dt * an0;
+    y(1) = x(1) + dt * x(4) + 0.5 * dt * dt * an1;
+    y(2) = x(2) + dt * x(5) + 0.5 * dt * dt * an2;
+    y(3) = x(3) + dt * an0;
+    y(4) = x(4) + dt * an1;
+    y(5) = x(5) + dt * an2;
+
+    // euler angle rates
+    y(6) = roll  + dt * (wx + (sr * wy + cr * wz) * tan(pitch));
+    y(7) = pitch + dt * (cr * wy - sr * wz);
+    y(8) = yaw   + dt * (sr * wy + cr * wz) / cp;
+
+    for (int i = 9; i < 15; i++) y(i) = x(i);
+  }
+};
+
+// finite differences the way a generic numeric fallback does it: fresh dynamic vectors per evaluation
+template <int N, class Functor>
+void allocatingNumericJacobian(const Functor& f, const Eigen::VectorXd& x, Eigen::MatrixXd& J)
+{
+  J.resize(N, N);
+  for (int k = 0; k < N; k++) {
+    Eigen::VectorXd x_plus(x), x_minus(x);
+    double h = 1e-6 * std::max(1.0, std::abs(x(k)));
+    x_plus(k) += h;
+    x_minus(k) -= h;
+
+    Eigen::Matrix<double,N,1> y_plus, y_minus;
+    f(Eigen::Matrix<double,N,1>(x_plus), y_plus);
+    f(Eigen::Matrix<double,N,1>(x_minus), y_minus);
+    J.col(k) = Eigen::VectorXd((y_plus - y_minus) / (2.0 * h));
+  }
+}
+
+static double now()
+{
+  timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+template <int N, class Functor>
+void benchmark(const char* name, const Functor& f, int iterations)
+{
+  Eigen::Matrix<double,N,1> x = Eigen::Matrix<double,N,1>::Random() * 0.5;
+  Eigen::Matrix<double,N,1> y;
+  Eigen::Matrix<double,N,N> J_ad, J_fd;
+  Eigen::MatrixXd J_alloc;
+  double checksum = 0.0;
+
+  double start = now();
+  for (int i = 0; i < iterations; i++) {
+    x(0) += 1e-9;
+    jacobian<N,N>(f, x, y, J_ad);
+    checksum += J_ad(0, 0);
+  }
+  double t_ad = now() - start;
+
+  start = now();
+  for (int i = 0; i < iterations; i++) {
+    x(0) += 1e-9;
+    numericJacobian<N,N>(f, x, J_fd);
+    checksum += J_fd(0, 0);
+  }
+  double t_fd = now() - start;
+
+  start = now();
+  for (int i = 0; i < iterations; i++) {
+    x(0) += 1e-9;
+    allocatingNumericJacobian<N>(f, Eigen::VectorXd(x), J_alloc);
+    checksum += J_alloc(0, 0);
+  }
+  double t_alloc = now() - start;
+
+  jacobian<N,N>(f, x, y, J_ad);
+  numericJacobian<N,N>(f, x, J_fd);
+
+  printf("%-8s %2d states: autodiff %7.3f us, finite differences %7.3f us, allocating finite differences %7.3f us, max difference %.2e (checksum %g)\n",
+         name, N, t_ad / iterations * 1e6, t_fd / iterations * 1e6, t_alloc / iterations * 1e6,
+         (J_ad - J_fd).cwiseAbs().maxCoeff(), checksum);
+}
+
+int main(int argc, char **argv)
+{
+  int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+
+  PlanarModel planar;
+  planar.dt = 0.01;
+  benchmark<6>("planar", planar, iterations);
+
+  InsModel ins;
+  ins.dt = 0.01;
+  ins.gyro[0] = 0.01; ins.gyro[1] = -0.02; ins.gyro[2] = 0.1;
+  ins.acc[0] = 0.2;   ins.acc[1] = 0.1;    ins.acc[2] = 9.7;
+  benchmark<15>("ins", ins, iterations);
+
+  return 0;
+}
@@ -0,0 +1,214 @@
+#ifndef __AUTODIFF_EIGEN__
+#define __AUTODIFF_EIGEN__
+
+#include <Eigen/Core>
+#include <algorithm>
+#include <cmath>
+
+// Forward mode automatic differentiation for nonlinear models on the Eigen backend.
+//
+// A model is written once as a functor templated on the scalar type:
+//
+//   struct Model {
+//     double dt;
+//     template <typename T>
+//     void operator()(const Eigen::Matrix<T,6,1>& x, Eigen::Matrix<T,6,1>& y) const {
+//       using std::cos; using std::sin;      // call math functions unqualified
+//       y = x;
+//       y(0) += dt * cos(x(2)) * x(3);
+//       ...
+//     }
+//   };
+//
+// Model()(x, y) with T = double evaluates the function; MatrixWrapper::AutoDiff::jacobian<6,6>(model, x, y, J)
+// evaluates it once with T = Dual<6> and returns the value and the exact Jacobian. Inputs that are
+// not differentiated (e.g. the control input of a system model) are stored as double members of
+// the functor. Typical use in a BFL pdf:
+//
+//   MatrixWrapper::Matrix dfGet(unsigned int i) const {
+//     Model model(ConditionalArgumentGet(1));            // bind the input
+//     Eigen::Matrix<double,6,1> y;
+//     Eigen::Matrix<double,6,6> J;
+//     MatrixWrapper::AutoDiff::jacobian<6,6>(model, ConditionalArgumentGet(0), y, J);
+//     return MatrixWrapper::Matrix(J);
+//   }
+//
+// Dual<N> keeps its N derivatives in a fixed size Eigen vector, so all derivative updates are
+// vectorized and nothing is allocated on the heap.
+
+namespace MatrixWrapper
+{
+namespace AutoDiff
+{
+
+template <int N>
+class Dual
+{
+ public:
+  typedef Eigen::Matrix<double, N, 1> Derivatives;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  Dual() : a(0.0), v(Derivatives::Zero()) {}
+  Dual(double value) : a(value), v(Derivatives::Zero()) {}
+  Dual(double value, int k) : a(value), v(Derivatives::Unit(k)) {}
+  Dual(double value, const Derivatives& derivatives) : a(value), v(derivatives) {}
+
+  Dual& operator+=(const Dual& b) { a += b.a; v += b.v; return *this; }
+  Dual& operator-=(const Dual& b) { a -= b.a; v -= b.v; return *this; }
+  Dual& operator*=(const Dual& b) { v = v * b.a + b.v * a; a *= b.a; return *this; }
+  Dual& operator/=(const Dual& b) { double inv = 1.0 / b.a; a *= inv; v = (v - a * b.v) * inv; return *this; }
+  Dual& operator+=(double b) { a += b; return *this; }
+  Dual& operator-=(double b) { a -= b; return *this; }
+  Dual& operator*=(double b) { a *= b; v *= b; return *this; }
+  Dual& operator/=(double b) { a /= b; v /= b; return *this; }
+
+  double a;         // value
+  Derivatives v;    // partial derivatives with respect to the N inputs
+};
+
+// arithmetic
+
+template <int N> inline Dual<N> operator+(const Dual<N>& x) { return x; }
+template <int N> inline Dual<N> operator-(const Dual<N>& x) { return Dual<N>(-x.a, -x.v); }
+
+template <int N> inline Dual<N> operator+(const Dual<N>& x, const Dual<N>& y) { return Dual<N>(x.a + y.a, x.v + y.v); }
+template <int N> inline Dual<N> operator+(const Dual<N>& x, double y) { return Dual<N>(x.a + y, x.v); }
+template <int N> inline Dual<N> operator+(double x, const Dual<N>& y) { return Dual<N>(x + y.a, y.v); }
+
+template <int N> inline Dual<N> operator-(const Dual<N>& x, const Dual<N>& y) { return Dual<N>(x.a - y.a, x.v - y.v); }
+template <int N> inline Dual<N> operator-(const Dual<N>& x, double y) { return Dual<N>(x.a - y, x.v); }
+template <int N> inline Dual<N> operator-(double x, const Dual<N>& y) { return Dual<N>(x - y.a, -y.v); }
+
+template <int N> inline Dual<N> operator*(const Dual<N>& x, const Dual<N>& y) { return Dual<N>(x.a * y.a, x.v * y.a + y.v * x.a); }
+template <int N> inline Dual<N> operator*(const Dual<N>& x, double y) { return Dual<N>(x.a * y, x.v * y); }
+template <int N> inline Dual<N> operator*(double x, const Dual<N>& y) { return Dual<N>(x * y.a, y.v * x); }
+
+template <int N> inline Dual<N> operator/(const Dual<N>& x, const Dual<N>& y)
+{
+  double inv = 1.0 / y.a;
+  double value = x.a * inv;
+  return Dual<N>(value, (x.v - value * y.v) * inv);
+}
+template <int N> inline Dual<N> operator/(const Dual<N>& x, double y) { double inv = 1.0 / y; return Dual<N>(x.a * inv, x.v * inv); }
+template <int N> inline Dual<N> operator/(double x, const Dual<N>& y)
+{
+  double inv = 1.0 / y.a;
+  double value = x * inv;
+  return Dual<N>(value, y.v * (-value * inv));
+}
+
+// comparisons use the value only
+
+#define AUTODIFF_COMPARISON(op) \
+  template <int N> inline bool operator op(const Dual<N>& x, const Dual<N>& y) { return x.a op y.a; } \
+  template <int N> inline bool operator op(const Dual<N>& x, double y) { return x.a op y; } \
+  template <int N> inline bool operator op(double x, const Dual<N>& y) { return x op y.a; }
+
+AUTODIFF_COMPARISON(<)
+AUTODIFF_COMPARISON(<=)
+AUTODIFF_COMPARISON(>)
+AUTODIFF_COMPARISON(>=)
+AUTODIFF_COMPARISON(==)
+AUTODIFF_COMPARISON(!=)
+
+#undef AUTODIFF_COMPARISON
+
+// math functions, found by argument dependent lookup
+
+template <int N> inline Dual<N> sqrt(const Dual<N>& x) { double s = std::sqrt(x.a); return Dual<N>(s, x.v * (0.5 / s)); }
+template <int N> inline Dual<N> exp(const Dual<N>& x) { double e = std::exp(x.a); return Dual<N>(e, x.v * e); }
+template <int N> inline Dual<N> log(const Dual<N>& x) { return Dual<N>(std::log(x.a), x.v * (1.0 / x.a)); }
+template <int N> inline Dual<N> sin(const Dual<N>& x) { return Dual<N>(std::sin(x.a), x.v * std::cos(x.a)); }
+template <int N> inline Dual<N> cos(const Dual<N>& x) { return Dual<N>(std::cos(x.a), x.v * -std::sin(x.a)); }
+template <int N> inline Dual<N> tan(const Dual<N>& x) { double t = std::tan(x.a); return Dual<N>(t, x.v * (1.0 + t * t)); }
+template <int N> inline Dual<N> asin(const Dual<N>& x) { return Dual<N>(std::asin(x.a), x.v * (1.0 / std::sqrt(1.0 - x.a * x.a))); }
+template <int N> inline Dual<N> acos(const Dual<N>& x) { return Dual<N>(std::acos(x.a), x.v * (-1.0 / std::sqrt(1.0 - x.a * x.a))); }
+template <int N> inline Dual<N> atan(const Dual<N>& x) { return Dual<N>(std::atan(x.a), x.v * (1.0 / (1.0 + x.a * x.a))); }
+template <int N> inline Dual<N> abs(const Dual<N>& x) { return x.a < 0.0 ? -x : x; }
+template <int N> inline Dual<N> fabs(const Dual<N>& x) { return x.a < 0.0 ? -x : x; }
+
+template <int N> inline Dual<N> atan2(const Dual<N>& y, const Dual<N>& x)
+{
+  double inv = 1.0 / (x.a * x.a + y.a * y.a);
+  return Dual<N>(std::atan2(y.a, x.a), (y.v * x.a - x.v * y.a) * inv);
+}
+
+template <int N> inline Dual<N> pow(const Dual<N>& x, double p)
+{
+  double t = std::pow(x.a, p - 1.0);
+  return Dual<N>(t * x.a, x.v * (p * t));
+}
+
+template <int N> inline Dual<N> pow(const Dual<N>& x, const Dual<N>& p) { return exp(p * log(x)); }
+
+// needed by Eigen for matrices of dual numbers
+template <int N> inline const Dual<N>& conj(const Dual<N>& x) { return x; }
+template <int N> inline const Dual<N>& real(const Dual<N>& x) { return x; }
+template <int N> inline Dual<N> imag(const Dual<N>&) { return Dual<N>(0.0); }
+template <int N> inline Dual<N> abs2(const Dual<N>& x) { return x * x; }
+
+/// Evaluates the M x N model at x and returns the value and the exact Jacobian
+template <int M, int N, class Functor, class Input, class Output, class Jacobian>
+inline void jacobian(const Functor& f, const Eigen::MatrixBase<Input>& x, Eigen::MatrixBase<Output>& value, Eigen::MatrixBase<Jacobian>& jacobian)
+{
+  Eigen::Matrix<Dual<N>, N, 1> x_dual;
+  Eigen::Matrix<Dual<N>, M, 1> y_dual;
+
+  for (int k = 0; k < N; k++)
+    x_dual(k) = Dual<N>(x(k), k);
+
+  f(x_dual, y_dual);
+
+  for (int i = 0; i < M; i++) {
+    value(i) = y_dual(i).a;
+    jacobian.row(i) = y_dual(i).v.transpose();
+  }
+}
+
+/// Central finite differences, 2N evaluations of the model (for comparison and testing)
+template <int M, int N, class Functor, class Input, class Jacobian>
+inline void numericJacobian(const Functor& f, const Eigen::MatrixBase<Input>& x, Eigen::MatrixBase<Jacobian>& jacobian, double step = 1e-6)
+{
+  Eigen::Matrix<double, N, 1> xk(x);
+  Eigen::Matrix<double, M, 1> y_plus, y_minus;
+
+  for (int k = 0; k < N; k++) {
+    double h = step * std::max(1.0, std::abs(x(k)));
+    xk(k) = x(k) + h;
+    f(xk, y_plus);
+    xk(k) = x(k) - h;
+    f(xk, y_minus);
+    xk(k) = x(k);
+    jacobian.col(k) = (y_plus - y_minus) / (2.0 * h);
+  }
+}
+
+} // namespace AutoDiff
+} // namespace MatrixWrapper
+
+namespace Eigen
+{
+
+template <int N>
+struct NumTraits< ::MatrixWrapper::AutoDiff::Dual<N> > : NumTraits<double>
+{
+  typedef ::MatrixWrapper::AutoDiff::Dual<N> Real;
+  typedef ::MatrixWrapper::AutoDiff::Dual<N> NonInteger;
+  typedef ::MatrixWrapper::AutoDiff::Dual<N> Nested;
+  typedef ::MatrixWrapper::AutoDiff::Dual<N> Literal;
+
+  enum {
+    IsComplex = 0,
+    IsInteger = 0,
+    IsSigned = 1,
+    RequireInitialization = 1,
+    ReadCost = 1 + N,
+    AddCost = 1 + N,
+    MulCost = 1 + 2 * N
+  };
+};
+
+}
+
+#endif // __AUTODIFF_EIGEN__
@@ -0,0 +1,283 @@
+#include "filterlog_EIGEN.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace MatrixWrapper;
+
+static const char FILTERLOG_MAGIC[8] = "BFLLOG1";
+static const uint32_t FILTERLOG_VERSION = 1;
+
+// SERIALIZATION
+
+double* Serialization::write(const Eigen::VectorXd& v, double* out)
+{
+  memcpy(out, v.data(), v.size() * sizeof(double));
+  return out + v.size();
+}
+
+double* Serialization::write(const Eigen::MatrixXd& m, double* out)
+{
+  memcpy(out, m.data(), m.size() * sizeof(double));
+  return out + m.size();
+}
+
+double* Serialization::writeUpper(const Eigen::MatrixXd& m, double* out)
+{
+  assert(m.rows() == m.cols());
+  const double* column = m.data();
+  for (int j = 0; j < m.cols(); j++, column += m.rows()) {
+    memcpy(out, column, (j + 1) * sizeof(double));
+    out += j + 1;
+  }
+  return out;
+}
+
+const double* Serialization::read(const double* in, Eigen::VectorXd& v)
+{
+  memcpy(v.data(), in, v.size() * sizeof(double));
+  return in + v.size();
+}
+
+const double* Serialization::read(const double* in, Eigen::MatrixXd& m)
+{
+  memcpy(m.data(), in, m.size() * sizeof(double));
+  return in + m.size();
+}
+
+const double* Serialization::readUpper(const double* in, Eigen::MatrixXd& m)
+{
+  assert(m.rows() == m.cols());
+  for (int j = 0; j < m.cols(); j++) {
+    memcpy(m.data() + j * m.rows(), in, (j + 1) * sizeof(double));
+    for (int i = 0; i < j; i++) m(j, i) = in[i];
+    in += j + 1;
+  }
+  return in;
+}
+
+// WRITER
+
+FilterLogWriter::FilterLogWriter()
+  : fd_(-1), data_(0), mapped_size_(0), growth_size_(0), end_(0)
+{
+}
+
+FilterLogWriter::~FilterLogWriter()
+{
+  close();
+}
+
+bool FilterLogWriter::open(const std::string& filename, size_t growth_size)
+{
+  close();
+
+  fd_ = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    std::cerr << "FilterLogWriter: could not open " << filename << ": " << strerror(errno) << std::endl;
+    return false;
+  }
+
+  growth_size_ = growth_size;
+  end_ = sizeof(FilterLogHeader);
+  if (!reserve(0)) {
+    close();
+    return false;
+  }
+
+  FilterLogHeader* header = reinterpret_cast<FilterLogHeader*>(data_);
+  memcpy(header->magic, FILTERLOG_MAGIC, sizeof(header->magic));
+  header->version = FILTERLOG_VERSION;
+  header->header_size = sizeof(FilterLogHeader);
+  header->end = end_;
+  return true;
+}
+
+void FilterLogWriter::close()
+{
+  if (data_) {
+    munmap(data_, mapped_size_);
+    data_ = 0;
+  }
+
+  if (fd_ >= 0) {
+    if (ftruncate(fd_, end_) != 0)
+      std::cerr << "FilterLogWriter: could not truncate log: " << strerror(errno) << std::endl;
+    ::close(fd_);
+    fd_ = -1;
+  }
+
+  mapped_size_ = 0;
+}
+
+bool FilterLogWriter::reserve(size_t bytes)
+{
+  if (end_ + bytes <= mapped_size_) return true;
+
+  size_t size = mapped_size_ + growth_size_;
+  while (size < end_ + bytes) size += growth_size_;
+
+  if (ftruncate(fd_, size) != 0) {
+    std::cerr << "FilterLogWriter: could not grow log: " << strerror(errno) << std::endl;
+    return false;
+  }
+
+  void* data = data_ ? mremap(data_, mapped_size_, size, MREMAP_MAYMOVE)
+                     : mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (data == MAP_FAILED) {
+    std::cerr << "FilterLogWriter: could not map log: " << strerror(errno) << std::endl;
+    return false;
+  }
+
+  data_ = static_cast<char*>(data);
+  mapped_size_ = size;
+  return true;
+}
+
+bool FilterLogWriter::append(double time, const Eigen::VectorXd& state, const Eigen::MatrixXd& covariance, uint16_t channel)
+{
+  if (!data_) return false;
+
+  size_t size = sizeof(FilterLogRecord) + (Serialization::vectorSize(state.size()) + Serialization::symmetricSize(covariance.rows())) * sizeof(double);
+  if (!reserve(size)) return false;
+
+  FilterLogRecord* record = reinterpret_cast<FilterLogRecord*>(data_ + end_);
+  record->size = size;
+  record->channel = channel;
+  record->flags = 0;
+  record->time = time;
+  record->state_dimension = state.size();
+  record->covariance_dimension = covariance.rows();
+
+  double* payload = reinterpret_cast<double*>(record + 1);
+  payload = Serialization::write(state, payload);
+  if (covariance.size() > 0) Serialization::writeUpper(covariance, payload);
+
+  end_ += size;
+  __sync_synchronize();
+  reinterpret_cast<FilterLogHeader*>(data_)->end = end_;
+  return true;
+}
+
+bool FilterLogWriter::append(double time, const Eigen::VectorXd& state, uint16_t channel)
+{
+  return append(time, state, Eigen::MatrixXd(), channel);
+}
+
+// READER
+
+FilterLogReader::FilterLogReader()
+  : fd_(-1), data_(0), mapped_size_(0), end_(0), position_(0)
+{
+}
+
+FilterLogReader::~FilterLogReader()
+{
+  close();
+}
+
+bool FilterLogReader::open(const std::string& filename)
+{
+  close();
+
+  fd_ = ::open(filename.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    std::cerr << "FilterLogReader: could not open " << filename << ": " << strerror(errno) << std::endl;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd_, &st) != 0 || st.st_size < (off_t) sizeof(FilterLogHeader)) {
+    std::cerr << "FilterLogReader: " << filename << " is not a filter log" << std::endl;
+    close();
+    return false;
+  }
+
+  void* data = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd_, 0);
+  if (data == MAP_FAILED) {
+    std::cerr << "FilterLogReader: could not map " << filename << ": " << strerror(errno) << std::endl;
+    close();
+    return false;
+  }
+  data_ = static_cast<const char*>(data);
+  mapped_size_ = st.st_size;
+
+  const FilterLogHeader* header = reinterpret_cast<const FilterLogHeader*>(data_);
+  if (memcmp(header->magic, FILTERLOG_MAGIC, sizeof(header->magic)) != 0 || header->version != FILTERLOG_VERSION) {
+    std::cerr << "FilterLogReader: " << filename << " is not a filter log or has an unsupported version" << std::endl;
+    close();
+    return false;
+  }
+
+  end_ = header->end < mapped_size_ ? header->end : mapped_size_;
+  position_ = header->header_size;
+  return true;
+}
+
+void FilterLogReader::close()
+{
+  if (data_) {
+    munmap(const_cast<char*>(data_), mapped_size_);
+    data_ = 0;
+  }
+
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+const FilterLogRecord* FilterLogReader::next()
+{
+  if (!data_ || position_ + sizeof(FilterLogRecord) > end_) return 0;
+
+  const FilterLogRecord* record = reinterpret_cast<const FilterLogRecord*>(data_ + position_);
+  if (record->size < sizeof(FilterLogRecord) || position_ + record->size > end_) return 0;
+
+  // the payload views trust the dimensions, so they have to fit into the record (in 64 bit, a corrupt
+  // dimension must not wrap around)
+  uint64_t covariance_dimension = record->covariance_dimension;
+  uint64_t payload = (record->state_dimension + covariance_dimension * (covariance_dimension + 1) / 2) * sizeof(double);
+  if (payload > record->size - sizeof(FilterLogRecord)) {
+    std::cerr << "FilterLogReader: record at offset " << position_ << " is corrupt (dimensions "
+              << record->state_dimension << "/" << record->covariance_dimension << " do not fit its size " << record->size << ")" << std::endl;
+    return 0;
+  }
+
+  position_ += record->size;
+  return record;
+}
+
+void FilterLogReader::rewind()
+{
+  if (data_) position_ = reinterpret_cast<const FilterLogHeader*>(data_)->header_size;
+}
+
+const double* FilterLogReader::getState(const FilterLogRecord* record)
+{
+  return reinterpret_cast<const double*>(record + 1);
+}
+
+const double* FilterLogReader::getCovariance(const FilterLogRecord* record)
+{
+  return getState(record) + record->state_dimension;
+}
+
+void FilterLogReader::getState(const FilterLogRecord* record, Eigen::VectorXd& state)
+{
+  state.resize(record->state_dimension);
+  Serialization::read(getState(record), state);
+}
+
+void FilterLogReader::getCovariance(const FilterLogRecord* record, Eigen::MatrixXd& covariance)
+{
+  covariance.resize(record->covariance_dimension, record->covariance_dimension);
+  Serialization::readUpper(getCovariance(record), covariance);
+}
@@ -0,0 +1,130 @@
+#ifndef __FILTERLOG_EIGEN__
+#define __FILTERLOG_EIGEN__
+
+#include <Eigen/Core>
+#include <string>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary serialization of the Eigen matrix wrapper types and an append-only, memory mapped log of
+// filter states.
+//
+// The wrapper classes (MatrixWrapper::ColumnVector, Matrix, SymmetricMatrix) derive from the Eigen
+// types, so they can be passed directly. Data is copied column by column with memcpy instead of
+// element-wise through the virtual 1-based operator(); symmetric matrices are stored as their upper
+// triangle only (n (n + 1) / 2 doubles, column-major).
+
+namespace MatrixWrapper
+{
+namespace Serialization
+{
+
+/// Number of doubles needed for a vector, a full matrix or a packed symmetric matrix
+inline size_t vectorSize(unsigned int rows) { return rows; }
+inline size_t matrixSize(unsigned int rows, unsigned int cols) { return rows * cols; }
+inline size_t symmetricSize(unsigned int n) { return n * (n + 1) / 2; }
+
+/// Writes the data and returns the position after it
+double* write(const Eigen::VectorXd& v, double* out);
+double* write(const Eigen::MatrixXd& m, double* out);
+double* writeUpper(const Eigen::MatrixXd& m, double* out);
+
+/// Reads data written by write()/writeUpper(); the destination must have the right size
+const double* read(const double* in, Eigen::VectorXd& v);
+const double* read(const double* in, Eigen::MatrixXd& m);
+const double* readUpper(const double* in, Eigen::MatrixXd& m);
+
+} // namespace Serialization
+
+/// On-disk layout of the filter log
+struct FilterLogHeader
+{
+  char magic[8];          // "BFLLOG1"
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t end;           // bytes in use, updated after each complete record
+};
+
+struct FilterLogRecord
+{
+  uint32_t size;          // record size in bytes including this header, multiple of 8
+  uint16_t channel;       // user defined, e.g. one channel per filter
+  uint16_t flags;
+  double time;
+  uint32_t state_dimension;
+  uint32_t covariance_dimension;
+  // followed by state_dimension doubles and symmetricSize(covariance_dimension) doubles
+};
+
+/// Append-only log of filter states backed by a memory mapped file
+/**
+ * The file grows in chunks of growth_size bytes, so appending a record is a memcpy into the mapping
+ * and does not involve a system call. The header's end offset is written after the record data,
+ * so a log of a crashed process is readable up to the last complete record.
+ */
+class FilterLogWriter
+{
+ public:
+  FilterLogWriter();
+  ~FilterLogWriter();
+
+  bool open(const std::string& filename, size_t growth_size = 16 * 1024 * 1024);
+
+  /// Truncates the file to the used size and unmaps it
+  void close();
+
+  bool isOpen() const { return data_ != 0; }
+
+  /// Appends a state and its (symmetric) covariance. Either may be empty.
+  bool append(double time, const Eigen::VectorXd& state, const Eigen::MatrixXd& covariance, uint16_t channel = 0);
+
+  /// Appends a state without covariance
+  bool append(double time, const Eigen::VectorXd& state, uint16_t channel = 0);
+
+  uint64_t getSize() const { return end_; }
+
+ private:
+  bool reserve(size_t bytes);
+
+  int fd_;
+  char* data_;
+  size_t mapped_size_;
+  size_t growth_size_;
+  uint64_t end_;
+};
+
+/// Sequential reader for logs written by FilterLogWriter
+class FilterLogReader
+{
+ public:
+  FilterLogReader();
+  ~FilterLogReader();
+
+  bool open(const std::string& filename);
+  void close();
+
+  /// Returns the next record or 0 at the end of the log or at a corrupt record. The pointer is valid until close().
+  const FilterLogRecord* next();
+
+  void rewind();
+
+  /// Zero-copy views of the record payload
+  static const double* getState(const FilterLogRecord* record);
+  static const double* getCovariance(const FilterLogRecord* record);
+
+  /// Copies of the record payload, the covariance is expanded to a full matrix
+  static void getState(const FilterLogRecord* record, Eigen::VectorXd& state);
+  static void getCovariance(const FilterLogRecord* record, Eigen::MatrixXd& covariance);
+
+ private:
+  int fd_;
+  const char* data_;
+  size_t mapped_size_;
+  uint64_t end_;
+  uint64_t position_;
+};
+
+} // namespace MatrixWrapper
+
+#endif // __FILTERLOG_EIGEN__
@@ -0,0 +1,114 @@
+#include "../config.h"
+#ifdef __MATRIXWRAPPER_EIGEN__
+
+#include "gating_EIGEN.h"
+
+#include <Eigen/Cholesky>
+#include <cmath>
+
+using namespace MatrixWrapper;
+
+GatingKernel::GatingKernel(unsigned int dimension)
+  : dimension_(dimension), num_tracks_(0), gated_cost_(1e6)
+{
+}
+
+void GatingKernel::setDimension(unsigned int dimension)
+{
+  if (dimension == dimension_) return;
+
+  dimension_ = dimension;
+  tracks_.clear();
+  num_tracks_ = 0;
+  measurements_.resize(0, dimension_);
+}
+
+void GatingKernel::clearTracks()
+{
+  num_tracks_ = 0;
+}
+
+bool GatingKernel::addTrack(const EigenColumnVector& predicted, const EigenMatrix& covariance)
+{
+  assert(predicted.rows() == dimension_);
+  assert(covariance.rows() == dimension_ && covariance.cols() == dimension_);
+
+  Eigen::LLT<EigenMatrix> llt(covariance);
+  if (llt.info() != Eigen::Success) return false;
+
+  // reuse the storage of tracks from previous cycles
+  if (num_tracks_ == tracks_.size()) tracks_.push_back(Track());
+  Track& track = tracks_[num_tracks_];
+
+  track.predicted = predicted;
+  track.inverse_factor.setIdentity(dimension_, dimension_);
+  llt.matrixL().solveInPlace(track.inverse_factor);
+
+  double log_determinant = 0.0;
+  for (unsigned int k = 0; k < dimension_; k++)
+    log_determinant += 2.0 * std::log(llt.matrixLLT()(k, k));
+  track.log_normalization = -0.5 * (dimension_ * std::log(2.0 * M_PI) + log_determinant);
+
+  num_tracks_++;
+  return true;
+}
+
+void GatingKernel::setMeasurements(const std::vector<MyColumnVector>& measurements)
+{
+  measurements_.resize(measurements.size(), dimension_);
+  for (unsigned int j = 0; j < measurements.size(); j++) {
+    assert(measurements[j].rows() == dimension_);
+    measurements_.row(j) = ((const EigenColumnVector &) measurements[j]).transpose();
+  }
+}
+
+void GatingKernel::setMeasurements(const EigenMatrix& measurements)
+{
+  assert(measurements.cols() == dimension_);
+  measurements_ = measurements;
+}
+
+unsigned int GatingKernel::compute(double gate, EigenMatrix& cost)
+{
+  const unsigned int m = measurements_.rows();
+
+  distances_.resize(num_tracks_, m);
+  log_likelihoods_.resize(num_tracks_, m);
+  cost.resize(num_tracks_, m);
+  whitened_.resize(m, dimension_);
+
+  unsigned int inside = 0;
+  if (m == 0) return inside;
+
+  for (unsigned int i = 0; i < num_tracks_; i++) {
+    const Track& track = tracks_[i];
+
+    // y_k = sum_{l <= k} L^-1(k,l) (z_l - h_l) for all measurements; every step is a column
+    // operation over the M measurements, which Eigen evaluates with SIMD
+    for (unsigned int k = 0; k < dimension_; k++) {
+      whitened_.col(k).setConstant(-track.inverse_factor.row(k).head(k + 1).dot(track.predicted.head(k + 1)));
+      for (unsigned int l = 0; l <= k; l++)
+        whitened_.col(k) += track.inverse_factor(k, l) * measurements_.col(l);
+    }
+
+    squared_.setZero(m);
+    for (unsigned int k = 0; k < dimension_; k++)
+      squared_.array() += whitened_.col(k).array().square();
+
+    distances_.row(i) = squared_.transpose();
+    log_likelihoods_.row(i) = (track.log_normalization - 0.5 * distances_.row(i).array()).matrix();
+
+    for (unsigned int j = 0; j < m; j++) {
+      if (distances_(i, j) <= gate) {
+        cost(i, j) = -log_likelihoods_(i, j);
+        inside++;
+      } else {
+        cost(i, j) = gated_cost_;
+      }
+    }
+  }
+
+  return inside;
+}
+
+#endif
@@ -0,0 +1,93 @@
+#include "../config.h"
+#ifdef __MATRIXWRAPPER_EIGEN__
+
+#ifndef __GATING_EIGEN__
+#define __GATING_EIGEN__
+
+#include "matrix_EIGEN.h"
+#include "vector_EIGEN.h"
+
+#include <Eigen/Core>
+#include <vector>
+
+namespace MatrixWrapper
+{
+
+/// Batched Mahalanobis gating and likelihood evaluation for data association (Eigen implementation)
+/**
+ * Evaluates N tracks against M measurements of the same dimension in one call. The innovation
+ * covariance of each track is factorized once when the track is added (S = L L^T, the inverse
+ * factor L^-1 and the normalization constant are cached), so a cycle costs one Cholesky per track
+ * instead of an inverse() and determinant() per track/measurement pair.
+ *
+ * Measurements are stored dimension-major (M x d, column-major), i.e. each dimension is contiguous
+ * over all measurements, and the whitening y = L^-1 (z - h) is evaluated for all measurements at
+ * once as a sequence of vectorized column operations.
+ *
+ * Usage per cycle:
+ *
+ *   gating.clearTracks();
+ *   for each track: gating.addTrack(predicted_measurement, innovation_covariance);
+ *   gating.setMeasurements(measurements);
+ *   gating.compute(chi2_gate, cost);     // cost(track, measurement) = -log likelihood, or gated_cost
+ */
+class GatingKernel
+{
+ public:
+  GatingKernel(unsigned int dimension = 0);
+
+  /// Measurement dimension; clears tracks and measurements if it changes
+  void setDimension(unsigned int dimension);
+  unsigned int getDimension() const { return dimension_; }
+
+  void clearTracks();
+
+  /// Adds a track (wrapper vectors/matrices can be passed directly). Returns false and does not add
+  /// the track if the covariance is not positive definite.
+  bool addTrack(const EigenColumnVector& predicted, const EigenMatrix& covariance);
+  unsigned int getNumTracks() const { return num_tracks_; }
+
+  /// Measurements as wrapper vectors or as an M x d matrix with one measurement per row
+  void setMeasurements(const std::vector<MyColumnVector>& measurements);
+  void setMeasurements(const EigenMatrix& measurements);
+  unsigned int getNumMeasurements() const { return measurements_.rows(); }
+
+  /// Cost assigned to pairs outside the gate, defaults to a large finite value usable by assignment solvers
+  void setGatedCost(double cost) { gated_cost_ = cost; }
+
+  /**
+   * Computes squared Mahalanobis distances and log-likelihoods for all pairs (N x M). cost is set to
+   * the negative log-likelihood for pairs with distance <= gate and to the gated cost otherwise.
+   * Returns the number of pairs inside the gate.
+   */
+  unsigned int compute(double gate, EigenMatrix& cost);
+
+  const EigenMatrix& getDistances() const { return distances_; }
+  const EigenMatrix& getLogLikelihoods() const { return log_likelihoods_; }
+
+ private:
+  struct Track
+  {
+    EigenColumnVector predicted;
+    EigenMatrix inverse_factor;   // L^-1, lower triangular
+    double log_normalization;     // -0.5 * (d log(2 pi) + log det S)
+  };
+
+  unsigned int dimension_;
+  std::vector<Track> tracks_;
+  unsigned int num_tracks_;       // tracks_ is not shrunk between cycles to keep its storage
+
+  EigenMatrix measurements_;      // M x d
+  EigenMatrix whitened_;          // M x d work buffer
+  EigenColumnVector squared_;     // M work buffer
+
+  EigenMatrix distances_;
+  EigenMatrix log_likelihoods_;
+  double gated_cost_;
+};
+
+} // namespace
+
+#endif // __GATING_EIGEN__
+
+#endif // __MATRIXWRAPPER_EIGEN__
@@ -3,6 +3,7 @@
 
 #include "matrix_EIGEN.h"
 #include "vector_EIGEN.h"
+#include "wrapper_profile.h"
 
 #include <Eigen/LU>
 
@@ -44,6 +45,7 @@ unsigned int MyMatrix::columns() const { return ((const EigenMatrix *)this)->col
 // MATRIX - SCALAR operators
 MyMatrix& MyMatrix::operator+= (double a)
 {
+  MATRIX_PROFILE(MATRIX_SCALAR_ASSIGN, 0, 0, rows() * columns());
   EigenMatrix & op1 = *this;
   op1 += EigenMatrix::Constant(op1.rows(), op1.cols(), a);
   return (MyMatrix&)op1;
@@ -51,6 +53,7 @@ MyMatrix& MyMatrix::operator+= (double a)
 
 MyMatrix& MyMatrix::operator-= (double a)
 {
+  MATRIX_PROFILE(MATRIX_SCALAR_ASSIGN, 0, 0, rows() * columns());
   EigenMatrix & op1 = (*this);
   op1 -= EigenMatrix::Constant(op1.rows(), op1.cols(), a);
   return (MyMatrix&) op1;
@@ -58,6 +61,7 @@ MyMatrix& MyMatrix::operator-= (double a)
 
 MyMatrix& MyMatrix::operator*= (double a)
 {
+  MATRIX_PROFILE(MATRIX_SCALAR_ASSIGN, 0, 0, rows() * columns());
   EigenMatrix & op1 = (*this);
   op1 *= a;
   return *this;
@@ -65,6 +69,7 @@ MyMatrix& MyMatrix::operator*= (double a)
 
 MyMatrix& MyMatrix::operator/= (double a)
 {
+  MATRIX_PROFILE(MATRIX_SCALAR_ASSIGN, 0, 0, rows() * columns());
   EigenMatrix & op1 = (*this);
   op1 /= a;
   return (MyMatrix&) op1;
@@ -72,22 +77,26 @@ MyMatrix& MyMatrix::operator/= (double a)
 
 MyMatrix MyMatrix::operator+ (double a) const
 {
+  MATRIX_PROFILE(MATRIX_SCALAR, 3, 3 * rows() * columns(), rows() * columns());
   return (MyMatrix)(((EigenMatrix)(*this)) + EigenMatrix::Constant(rows(), cols(), a));
 }
 
 MyMatrix MyMatrix::operator- (double a) const
 {
+  MATRIX_PROFILE(MATRIX_SCALAR, 3, 3 * rows() * columns(), rows() * columns());
   return (MyMatrix)(((EigenMatrix)(*this)) - EigenMatrix::Constant(rows(), cols(), a));
 }
 
 MyMatrix MyMatrix::operator* (double a) const
 {
+  MATRIX_PROFILE(MATRIX_SCALAR, 2, 2 * rows() * columns(), rows() * columns());
   const EigenMatrix& op1 = (*this);
   return (MyMatrix) (op1 *  a);
 }
 
 MyMatrix MyMatrix::operator/ (double a) const
 {
+  MATRIX_PROFILE(MATRIX_SCALAR, 2, 2 * rows() * columns(), rows() * columns());
   const EigenMatrix& op1 = (*this);
   return (MyMatrix) (op1 /  a);
 }
@@ -95,6 +104,7 @@ MyMatrix MyMatrix::operator/ (double a) const
 MyMatrix&
 MyMatrix::operator =(const MySymmetricMatrix& a)
 {
+  MATRIX_PROFILE(MATRIX_ASSIGN, 1, a.rows() * a.columns(), 0);
   *this =(MyMatrix) a;
 
   return *this;
@@ -103,6 +113,7 @@ MyMatrix::operator =(const MySymmetricMatrix& a)
 // MATRIX - MATRIX Operators
 MyMatrix MyMatrix::operator- (const MyMatrix& a) const
 {
+  MATRIX_PROFILE(MATRIX_ADD, 2, 2 * rows() * columns(), rows() * columns());
   const EigenMatrix& op1 = *this;
   const EigenMatrix& op2 = a;
 
@@ -111,6 +122,7 @@ MyMatrix MyMatrix::operator- (const MyMatrix& a) const
 
 MyMatrix MyMatrix::operator+ (const MyMatrix& a) const
 {
+  MATRIX_PROFILE(MATRIX_ADD, 2, 2 * rows() * columns(), rows() * columns());
   const EigenMatrix& op1 = *this;
   const EigenMatrix& op2 = a;
 
@@ -119,6 +131,7 @@ MyMatrix MyMatrix::operator+ (const MyMatrix& a) const
 
 MyMatrix MyMatrix::operator* (const MyMatrix& a) const
 {
+  MATRIX_PROFILE(MATRIX_MULTIPLY, 2, 2 * rows() * a.columns(), 2ULL * rows() * columns() * a.columns());
   const EigenMatrix& op1 = *this;
   const EigenMatrix& op2 = a;
 
@@ -127,6 +140,7 @@ MyMatrix MyMatrix::operator* (const MyMatrix& a) const
 
 MyMatrix & MyMatrix::operator+= (const MyMatrix& a)
 {
+  MATRIX_PROFILE(MATRIX_ADD_ASSIGN, 0, 0, rows() * columns());
   EigenMatrix & op1 = (*this);
   const EigenMatrix & op2 = a;
   op1 += op2;
@@ -135,6 +149,7 @@ MyMatrix & MyMatrix::operator+= (const MyMatrix& a)
 
 MyMatrix & MyMatrix::operator-= (const MyMatrix& a)
 {
+  MATRIX_PROFILE(MATRIX_ADD_ASSIGN, 0, 0, rows() * columns());
   EigenMatrix & op1 = (*this);
   const EigenMatrix & op2 = a;
   op1 -= op2;
@@ -145,6 +160,7 @@ MyMatrix & MyMatrix::operator-= (const MyMatrix& a)
 // MATRIX - VECTOR Operators
 MyColumnVector MyMatrix::operator* (const MyColumnVector &b) const
 {
+  MATRIX_PROFILE(MATRIX_MULTIPLY_VECTOR, 2, 2 * rows(), 2ULL * rows() * columns());
   const EigenMatrix& op1 = (*this);
   return (MyColumnVector) (op1 * ((const EigenColumnVector&)b));
 }
@@ -165,6 +181,7 @@ double MyMatrix::operator()(unsigned int a, unsigned int b) const
 
 bool MyMatrix::operator==(const MyMatrix& a) const
 {
+  MATRIX_PROFILE(MATRIX_COMPARE, 2, 2 * rows() * columns(), rows() * columns());
   if (this->rows() != a.rows()) return false;
   if (this->columns() != a.columns()) return false;
   return(((EigenMatrix)(*this)-(EigenMatrix)a).isApproxToConstant(0.0));
@@ -182,11 +199,13 @@ MyMatrix&
 
 MyRowVector MyMatrix::rowCopy(unsigned int r) const
 {
+  MATRIX_PROFILE(MATRIX_ROW_COPY, 2, 2 * columns(), 0);
   return (MyRowVector) (*this).row(r);
 }
 
 MyColumnVector MyMatrix::columnCopy(unsigned int c) const
 {
+  MATRIX_PROFILE(MATRIX_COLUMN_COPY, 2, 2 * rows(), 0);
   return (MyColumnVector) (*this).col(c);
 }
 
@@ -195,12 +214,14 @@ MyColumnVector MyMatrix::columnCopy(unsigned int c) const
 
 MyMatrix MyMatrix::transpose() const
 {
+  MATRIX_PROFILE(MATRIX_TRANSPOSE, 2, 2 * rows() * columns(), 0);
   const EigenMatrix &op1 = (*this);
   return (MyMatrix) op1.transpose();
 }
 
 double MyMatrix::determinant() const
 {
+  MATRIX_PROFILE(MATRIX_DETERMINANT, 1, rows() * columns(), 2ULL * rows() * rows() * rows() / 3);
   unsigned int r = this->rows();
   assert(r == this->columns());
   const EigenMatrix& A = (*this);
@@ -210,6 +231,7 @@ double MyMatrix::determinant() const
 
 MyMatrix MyMatrix::inverse() const
 {
+  MATRIX_PROFILE(MATRIX_INVERSE, 3, 3 * rows() * columns(), 8ULL * rows() * rows() * rows() / 3);
   unsigned int r = this->rows();
   assert(r == this->columns());
   const EigenMatrix& A = (*this);
@@ -220,6 +242,7 @@ MyMatrix MyMatrix::inverse() const
 int
 MyMatrix::convertToSymmetricMatrix(MySymmetricMatrix& sym)
 {
+  MATRIX_PROFILE(MATRIX_CONVERT_SYMMETRIC, 1, rows() * columns(), 0);
   // test if matrix is square matrix
   assert(this->rows() == this->columns());
 
@@ -231,6 +254,7 @@ MyMatrix::convertToSymmetricMatrix(MySymmetricMatrix& sym)
 void
 MyMatrix::resize(unsigned int i, unsigned int j, bool copy, bool initialize)
 {
+  MATRIX_PROFILE(MATRIX_RESIZE, (i * j != rows() * columns()) ? 1 : 0, (i * j != rows() * columns()) ? i * j : 0, 0);
   EigenMatrix & temp = (EigenMatrix &) (*this);
   temp.resize(i,j);
 }
@@ -238,6 +262,7 @@ MyMatrix::resize(unsigned int i, unsigned int j, bool copy, bool initialize)
 // get sub matrix
 MyMatrix MyMatrix::sub(int i_start, int i_end, int j_start , int j_end) const
 {
+  MATRIX_PROFILE(MATRIX_SUB, 2, 2 * (i_end - i_start + 1) * (j_end - j_start + 1), 0);
   const EigenMatrix & A = (EigenMatrix &) (*this);
   MyMatrix submatrix(A.block(i_start-1,j_start-1,i_end-i_start+1,j_end-j_start+1));
   return submatrix;
@@ -281,6 +306,7 @@ unsigned int MySymmetricMatrix::columns() const { return ((const EigenSymmetricM
 
 MyRowVector MySymmetricMatrix::rowCopy(unsigned int r) const
 {
+  MATRIX_PROFILE(SYMMETRIC_ROW_COPY, 2, 2 * columns(), 0);
   
   unsigned int cols = columns();
   EigenRowVector temp(cols);
@@ -289,10 +315,15 @@ MyRowVector MySymmetricMatrix::rowCopy(unsigned int r) const
   return (MyRowVector) temp;
 }
 
-MySymmetricMatrix MySymmetricMatrix::transpose() const {return (*this);}
+MySymmetricMatrix MySymmetricMatrix::transpose() const
+{
+  MATRIX_PROFILE(SYMMETRIC_TRANSPOSE, 1, rows() * columns(), 0);
+  return (*this);
+}
 
 MySymmetricMatrix MySymmetricMatrix::inverse() const
 {
+  MATRIX_PROFILE(SYMMETRIC_INVERSE, 3, 3 * rows() * columns(), 8ULL * rows() * rows() * rows() / 3);
   unsigned int r = this->rows();
   assert(r == this->columns());
   const EigenSymmetricMatrix& A = (*this);
@@ -302,6 +333,7 @@ MySymmetricMatrix MySymmetricMatrix::inverse() const
 
 double MySymmetricMatrix::determinant() const
 {
+  MATRIX_PROFILE(SYMMETRIC_DETERMINANT, 1, rows() * columns(), 2ULL * rows() * rows() * rows() / 3);
   unsigned int r = this->rows();
   assert(r == this->columns());
   const EigenSymmetricMatrix& A = (*this);
@@ -313,6 +345,7 @@ double MySymmetricMatrix::determinant() const
 // Set all elements equal to a
 MySymmetricMatrix& MySymmetricMatrix::operator=(const double a)
 {
+  MATRIX_PROFILE(SYMMETRIC_ASSIGN, 0, 0, 0);
   ((EigenSymmetricMatrix&)(*this)).setConstant(a);
   return *this;
 }
@@ -321,6 +354,7 @@ MySymmetricMatrix& MySymmetricMatrix::operator=(const double a)
 // SYMMETRICMATRIX - SCALAR operators
 MySymmetricMatrix& MySymmetricMatrix::operator +=(double a)
 {
+  MATRIX_PROFILE(SYMMETRIC_SCALAR_ASSIGN, 0, 0, rows() * columns());
   EigenSymmetricMatrix & op1 = *this;
   op1 += EigenSymmetricMatrix::Constant(op1.rows(), op1.cols(), a);
   return (MySymmetricMatrix&)op1;
@@ -328,6 +362,7 @@ MySymmetricMatrix& MySymmetricMatrix::operator +=(double a)
 
 MySymmetricMatrix& MySymmetricMatrix::operator -=(double a)
 {
+  MATRIX_PROFILE(SYMMETRIC_SCALAR_ASSIGN, 0, 0, rows() * columns());
   EigenSymmetricMatrix & op1 = *this;
   op1 -= EigenSymmetricMatrix::Constant(op1.rows(), op1.cols(), a);
   return (MySymmetricMatrix&)op1;
@@ -335,6 +370,7 @@ MySymmetricMatrix& MySymmetricMatrix::operator -=(double a)
 
 MySymmetricMatrix& MySymmetricMatrix::operator *=(double b)
 {
+  MATRIX_PROFILE(SYMMETRIC_SCALAR_ASSIGN, 0, 0, rows() * columns());
   EigenSymmetricMatrix & op1 = (*this);
   op1 *= b;
   return (MySymmetricMatrix&) op1;
@@ -342,6 +378,7 @@ MySymmetricMatrix& MySymmetricMatrix::operator *=(double b)
 
 MySymmetricMatrix& MySymmetricMatrix::operator /=(double b)
 {
+  MATRIX_PROFILE(SYMMETRIC_SCALAR_ASSIGN, 0, 0, rows() * columns());
   EigenSymmetricMatrix & op1 = (*this);
   op1 /= b;
   return (MySymmetricMatrix&) op1;
@@ -349,22 +386,26 @@ MySymmetricMatrix& MySymmetricMatrix::operator /=(double b)
 
 MySymmetricMatrix MySymmetricMatrix::operator +(double a) const
 {
+  MATRIX_PROFILE(SYMMETRIC_SCALAR, 3, 3 * rows() * columns(), rows() * columns());
   return (MySymmetricMatrix)(((EigenSymmetricMatrix)(*this)) + EigenSymmetricMatrix::Constant(rows(), cols(), a));
 }
 
 MySymmetricMatrix MySymmetricMatrix::operator -(double a) const
 {
+  MATRIX_PROFILE(SYMMETRIC_SCALAR, 3, 3 * rows() * columns(), rows() * columns());
   return (MySymmetricMatrix)(((EigenSymmetricMatrix)(*this)) - EigenSymmetricMatrix::Constant(rows(), cols(), a));
 }
 
 MySymmetricMatrix MySymmetricMatrix::operator *(double b) const
 {
+  MATRIX_PROFILE(SYMMETRIC_SCALAR, 2, 2 * rows() * columns(), rows() * columns());
  const EigenSymmetricMatrix& op1 = (*this);
   return (MySymmetricMatrix) (op1 *  b);
 }
 
 MySymmetricMatrix MySymmetricMatrix::operator /(double b) const
 {
+  MATRIX_PROFILE(SYMMETRIC_SCALAR, 2, 2 * rows() * columns(), rows() * columns());
   const EigenSymmetricMatrix& op1 = (*this);
   return (MySymmetricMatrix) (op1 /  b);
 }
@@ -375,6 +416,7 @@ MySymmetricMatrix MySymmetricMatrix::operator /(double b) const
 // SYMMETRICMATRIX - MATRIX operators
 MyMatrix& MySymmetricMatrix::operator +=(const MyMatrix& a)
 {
+  MATRIX_PROFILE(SYMMETRIC_ADD_ASSIGN, 0, 0, rows() * columns());
   EigenSymmetricMatrix & op1 = (*this);
   op1 += a;
   return (MyMatrix &) op1;
@@ -382,6 +424,7 @@ MyMatrix& MySymmetricMatrix::operator +=(const MyMatrix& a)
 
 MyMatrix& MySymmetricMatrix::operator -=(const MyMatrix& a)
 {
+  MATRIX_PROFILE(SYMMETRIC_ADD_ASSIGN, 0, 0, rows() * columns());
   EigenSymmetricMatrix & op1 = (*this);
   op1 -= a;
   return (MyMatrix &) op1;
@@ -390,6 +433,7 @@ MyMatrix& MySymmetricMatrix::operator -=(const MyMatrix& a)
 
 MyMatrix MySymmetricMatrix::operator+ (const MyMatrix &a) const
 {
+  MATRIX_PROFILE(SYMMETRIC_ADD, 2, 2 * rows() * columns(), rows() * columns());
   const EigenSymmetricMatrix& op1 = *this;
   const EigenMatrix& op2 = a;
 
@@ -398,6 +442,7 @@ MyMatrix MySymmetricMatrix::operator+ (const MyMatrix &a) const
 
 MyMatrix MySymmetricMatrix::operator- (const MyMatrix &a) const
 {
+  MATRIX_PROFILE(SYMMETRIC_ADD, 2, 2 * rows() * columns(), rows() * columns());
   const EigenSymmetricMatrix& op1 = *this;
   const EigenMatrix& op2 = a;
 
@@ -406,6 +451,7 @@ MyMatrix MySymmetricMatrix::operator- (const MyMatrix &a) const
 
 MyMatrix MySymmetricMatrix::operator* (const MyMatrix &a) const
 {
+  MATRIX_PROFILE(SYMMETRIC_MULTIPLY, 2, 2 * rows() * a.columns(), 2ULL * rows() * columns() * a.columns());
   const EigenSymmetricMatrix& op1 = *this;
   const EigenMatrix& op2 = a;
 
@@ -417,6 +463,7 @@ MyMatrix MySymmetricMatrix::operator* (const MyMatrix &a) const
 // SYMMETRICMATRIX - SYMMETRICMATRIX operators
 MySymmetricMatrix& MySymmetricMatrix::operator +=(const MySymmetricMatrix& a)
 {
+  MATRIX_PROFILE(SYMMETRIC_ADD_ASSIGN, 0, 0, rows() * columns());
   EigenSymmetricMatrix & op1 = (*this);
   const EigenSymmetricMatrix & op2 = a;
   op1 += op2;
@@ -425,6 +472,7 @@ MySymmetricMatrix& MySymmetricMatrix::operator +=(const MySymmetricMatrix& a)
 
 MySymmetricMatrix& MySymmetricMatrix::operator -=(const MySymmetricMatrix& a)
 {
+  MATRIX_PROFILE(SYMMETRIC_ADD_ASSIGN, 0, 0, rows() * columns());
   EigenSymmetricMatrix & op1 = (*this);
   const EigenSymmetricMatrix & op2 = a;
   op1 -= op2;
@@ -433,6 +481,7 @@ MySymmetricMatrix& MySymmetricMatrix::operator -=(const MySymmetricMatrix& a)
 
 MySymmetricMatrix MySymmetricMatrix::operator+ (const MySymmetricMatrix &a) const
 {
+  MATRIX_PROFILE(SYMMETRIC_ADD, 2, 2 * rows() * columns(), rows() * columns());
   const EigenSymmetricMatrix& op1 = *this;
   const EigenSymmetricMatrix& op2 = a;
 
@@ -441,6 +490,7 @@ MySymmetricMatrix MySymmetricMatrix::operator+ (const MySymmetricMatrix &a) cons
 
 MySymmetricMatrix MySymmetricMatrix::operator- (const MySymmetricMatrix &a) const
 {
+  MATRIX_PROFILE(SYMMETRIC_ADD, 2, 2 * rows() * columns(), rows() * columns());
   const EigenSymmetricMatrix& op1 = *this;
   const EigenSymmetricMatrix& op2 = a;
 
@@ -449,6 +499,7 @@ MySymmetricMatrix MySymmetricMatrix::operator- (const MySymmetricMatrix &a) cons
 
 MyMatrix MySymmetricMatrix::operator* (const MySymmetricMatrix &a) const
 {
+  MATRIX_PROFILE(SYMMETRIC_MULTIPLY, 2, 2 * rows() * a.columns(), 2ULL * rows() * columns() * a.columns());
   const EigenSymmetricMatrix& op1 = *this;
   const EigenSymmetricMatrix& op2 = a;
 
@@ -460,18 +511,21 @@ MyMatrix MySymmetricMatrix::operator* (const MySymmetricMatrix &a) const
 
 MyColumnVector MySymmetricMatrix::operator* (const MyColumnVector &b) const
 {
+  MATRIX_PROFILE(SYMMETRIC_MULTIPLY_VECTOR, 3, rows() * columns() + 2 * rows(), 2ULL * rows() * columns());
   const EigenSymmetricMatrix& op1 = (EigenSymmetricMatrix) *this;
   return (MyColumnVector) (op1 * ((const EigenColumnVector&)b));
 }
 
 void MySymmetricMatrix::multiply (const MyColumnVector &b, MyColumnVector &result) const
 {
+  MATRIX_PROFILE(SYMMETRIC_MULTIPLY_VECTOR, 3, rows() * columns() + 2 * rows(), 2ULL * rows() * columns());
   const EigenSymmetricMatrix& op1 = (EigenSymmetricMatrix) *this;
   result = (MyColumnVector) (op1 * ((const EigenColumnVector&)b));
 }
 
 MyMatrix MySymmetricMatrix::sub(int i_start, int i_end, int j_start , int j_end) const
 {
+  MATRIX_PROFILE(SYMMETRIC_SUB, 1, (i_end - i_start + 1) * (j_end - j_start + 1), 0);
   MyMatrix submatrix(i_end-i_start+1, j_end-j_start+1);
   for (int i=i_start; i<=i_end; i++)
     for (int j=j_start; j<=j_end; j++)
@@ -496,6 +550,7 @@ double MySymmetricMatrix::operator()(unsigned int a, unsigned int b) const
 
 bool MySymmetricMatrix::operator==(const MySymmetricMatrix& a) const
 {
+  MATRIX_PROFILE(SYMMETRIC_COMPARE, 2, 2 * rows() * columns(), rows() * columns());
   if (this->rows() != a.rows()) return false;
   if (this->columns() != a.columns()) return false;
   return(((EigenSymmetricMatrix)(*this)-(EigenSymmetricMatrix)a).isApproxToConstant(0.0));
@@ -504,6 +559,7 @@ bool MySymmetricMatrix::operator==(const MySymmetricMatrix& a) const
 void
 MySymmetricMatrix::resize(unsigned int i, bool copy, bool initialize)
 {
+  MATRIX_PROFILE(SYMMETRIC_RESIZE, (i * i != rows() * columns()) ? 1 : 0, (i * i != rows() * columns()) ? i * i : 0, 0);
   EigenSymmetricMatrix & temp = (EigenSymmetricMatrix &) (*this);
   temp.resize(i,i);
 }
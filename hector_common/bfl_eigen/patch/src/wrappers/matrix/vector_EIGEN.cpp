@@ -2,6 +2,7 @@
 #ifdef __MATRIXWRAPPER_EIGEN__
 
 #include "vector_EIGEN.h"
+#include "wrapper_profile.h"
 #include <iostream>
 
 
@@ -30,6 +31,7 @@ MyColumnVector::ColumnVector(const EigenColumnVector & a) :
 // Resizing
 void MyColumnVector::resize(int num_rows)
 {
+  MATRIX_PROFILE(COLUMN_RESIZE, (unsigned int) num_rows != rows() ? 1 : 0, (unsigned int) num_rows != rows() ? num_rows : 0, 0);
   EigenColumnVector & op1 = (*this);
   op1.resize(num_rows);
 }
@@ -37,6 +39,7 @@ void MyColumnVector::resize(int num_rows)
 // Assign
 void MyColumnVector::assign(int num_rows, double value)
 {
+  MATRIX_PROFILE(COLUMN_RESIZE, (unsigned int) num_rows != rows() ? 1 : 0, (unsigned int) num_rows != rows() ? num_rows : 0, 0);
   EigenColumnVector & op1 = (*this);
   op1.resize(num_rows);
   op1.setConstant(value);
@@ -50,6 +53,7 @@ unsigned int MyColumnVector::capacity() const { return ((const EigenColumnVector
 MyColumnVector
 MyColumnVector::vectorAdd(const MyColumnVector& v2) const
 {
+  MATRIX_PROFILE(COLUMN_CONCAT, 1, rows() + v2.rows(), 0);
   const MyColumnVector& v1 = *this;
   MyColumnVector res(v1.rows() + v2.rows());
   EigenColumnVector& opl = res;
@@ -68,6 +72,7 @@ double& MyColumnVector::operator()(unsigned int i)
 
 double MyColumnVector::operator()(unsigned int i) const
 {
+  MATRIX_PROFILE(COLUMN_ELEMENT, 1, rows(), 0);
   //std::cout << "(BOOSTVECTOR) operator() called" << std::endl;
   const EigenColumnVector op1 = (*this);
   return op1(i-1);
@@ -76,6 +81,7 @@ double MyColumnVector::operator()(unsigned int i) const
 
 bool MyColumnVector::operator==(const MyColumnVector& a) const
 {
+  MATRIX_PROFILE(COLUMN_COMPARE, 2, 2 * rows(), rows());
   if (this->rows() != a.rows()) return false;
   return(((EigenColumnVector)(*this)-(EigenColumnVector)a).isApproxToConstant(0.0));
 }
@@ -83,6 +89,7 @@ bool MyColumnVector::operator==(const MyColumnVector& a) const
 // Operators
 MyColumnVector & MyColumnVector::operator+= (const MyColumnVector& a)
 {
+  MATRIX_PROFILE(COLUMN_ADD_ASSIGN, 0, 0, rows());
   EigenColumnVector & op1 = (*this);
   const EigenColumnVector & op2 = a;
   op1 += op2;
@@ -91,6 +98,7 @@ MyColumnVector & MyColumnVector::operator+= (const MyColumnVector& a)
 
 MyColumnVector & MyColumnVector::operator-= (const MyColumnVector& a)
 {
+  MATRIX_PROFILE(COLUMN_ADD_ASSIGN, 0, 0, rows());
   EigenColumnVector & op1 = (*this);
   const EigenColumnVector & op2 = a;
   op1 -= op2;
@@ -99,11 +107,13 @@ MyColumnVector & MyColumnVector::operator-= (const MyColumnVector& a)
 
 MyColumnVector MyColumnVector::operator+ (const MyColumnVector &a) const
 {
+  MATRIX_PROFILE(COLUMN_ADD, 4, 4 * rows(), rows());
   return (MyColumnVector) ((EigenColumnVector)(*this) + (EigenColumnVector)a);
 }
 
 MyColumnVector MyColumnVector::operator- (const MyColumnVector &a) const
 {
+  MATRIX_PROFILE(COLUMN_ADD, 4, 4 * rows(), rows());
   return (MyColumnVector) ((EigenColumnVector)(*this) - (EigenColumnVector)a);
 }
 
@@ -111,6 +121,7 @@ MyColumnVector MyColumnVector::operator- (const MyColumnVector &a) const
 
 MyColumnVector& MyColumnVector::operator+= (double a)
 {
+  MATRIX_PROFILE(COLUMN_SCALAR_ASSIGN, 0, 0, rows());
   EigenColumnVector & op1 = *this;
   op1 += EigenColumnVector::Constant(rows(), a);
   return (MyColumnVector&)op1;
@@ -118,6 +129,7 @@ MyColumnVector& MyColumnVector::operator+= (double a)
 
 MyColumnVector& MyColumnVector::operator-= (double a)
 {
+  MATRIX_PROFILE(COLUMN_SCALAR_ASSIGN, 0, 0, rows());
   EigenColumnVector & op1 = *this;
   op1 -= EigenColumnVector::Constant(rows(), a);
   return (MyColumnVector&)op1;
@@ -125,6 +137,7 @@ MyColumnVector& MyColumnVector::operator-= (double a)
 
 MyColumnVector& MyColumnVector::operator*= (double a)
 {
+  MATRIX_PROFILE(COLUMN_SCALAR_ASSIGN, 0, 0, rows());
   EigenColumnVector& op1 = *this;
   op1 *= a;
   return (MyColumnVector&) op1;
@@ -132,6 +145,7 @@ MyColumnVector& MyColumnVector::operator*= (double a)
 
 MyColumnVector& MyColumnVector::operator/= (double a)
 {
+  MATRIX_PROFILE(COLUMN_SCALAR_ASSIGN, 0, 0, rows());
   EigenColumnVector& op1 = *this;
   op1 /= a;
   return (MyColumnVector&) op1;
@@ -140,22 +154,26 @@ MyColumnVector& MyColumnVector::operator/= (double a)
 
 MyColumnVector MyColumnVector::operator+ (double a) const
 {
+  MATRIX_PROFILE(COLUMN_SCALAR, 3, 3 * rows(), rows());
   return (MyColumnVector)(((EigenColumnVector)(*this)) + EigenColumnVector::Constant(rows(), a));
 }
 
 MyColumnVector MyColumnVector::operator- (double a) const
 {
+  MATRIX_PROFILE(COLUMN_SCALAR, 3, 3 * rows(), rows());
   return (MyColumnVector)(((EigenColumnVector)(*this)) - EigenColumnVector::Constant(rows(), a));
 }
 
 MyColumnVector MyColumnVector::operator* (double a) const
 {
+  MATRIX_PROFILE(COLUMN_SCALAR, 2, 2 * rows(), rows());
   const EigenColumnVector & op1 = (*this);
   return (MyColumnVector) (op1 * a);
 }
 
 MyColumnVector MyColumnVector::operator/ (double a) const
 {
+  MATRIX_PROFILE(COLUMN_SCALAR, 2, 2 * rows(), rows());
   const EigenColumnVector & op1 = (*this);
   return (MyColumnVector) (op1 / a);
 }
@@ -164,12 +182,14 @@ MyColumnVector MyColumnVector::operator/ (double a) const
 
 MyRowVector MyColumnVector::transpose() const
 {
+  MATRIX_PROFILE(COLUMN_TRANSPOSE, 2, 2 * rows(), 0);
   const EigenColumnVector & op1 = (*this);
   return MyRowVector(op1.transpose());
 }
 
 MyMatrix MyColumnVector::operator* (const MyRowVector &a) const
 {
+  MATRIX_PROFILE(COLUMN_OUTER_PRODUCT, 2, 2 * rows() * a.columns(), rows() * a.columns());
   const EigenColumnVector & op1 = (*this);
   const EigenRowVector & op2 = a;
 
@@ -179,6 +199,7 @@ MyMatrix MyColumnVector::operator* (const MyRowVector &a) const
 MyColumnVector&
 MyColumnVector::operator=(const MyColumnVector &a)
 {
+  MATRIX_PROFILE(COLUMN_ASSIGN, 1, a.rows(), 0);
   EigenColumnVector& op1 = *this;
   op1 = (EigenColumnVector)a;
   return *this;
@@ -194,6 +215,7 @@ MyColumnVector::operator=(double a)
 
 MyColumnVector MyColumnVector::sub(int j_start , int j_end) const
 {
+  MATRIX_PROFILE(COLUMN_SUB, 2, 2 * (j_end - j_start + 1), 0);
   const EigenColumnVector& op1 = *this;
   return MyColumnVector(op1.segment(j_start-1,j_end-j_start+1));
 }
@@ -223,6 +245,7 @@ MyRowVector::RowVector(const EigenRowVector & a) :
 // Resizing
 void MyRowVector::resize(int num_columns)
 {
+  MATRIX_PROFILE(ROW_RESIZE, (unsigned int) num_columns != columns() ? 1 : 0, (unsigned int) num_columns != columns() ? num_columns : 0, 0);
   EigenRowVector & op1 = (*this);
   op1.resize(num_columns);
 }
@@ -230,6 +253,7 @@ void MyRowVector::resize(int num_columns)
 // Assign
 void MyRowVector::assign(int num_columns, double value)
 {
+  MATRIX_PROFILE(ROW_RESIZE, (unsigned int) num_columns != columns() ? 1 : 0, (unsigned int) num_columns != columns() ? num_columns : 0, 0);
   EigenRowVector & op1 = (*this);
   op1.resize(num_columns);
   op1.setConstant(value);
@@ -243,6 +267,7 @@ unsigned int MyRowVector::capacity() const { return ((const EigenRowVector *)thi
 MyRowVector
 MyRowVector::vectorAdd(const MyRowVector& v2) const
 {
+  MATRIX_PROFILE(ROW_CONCAT, 1, columns() + v2.columns(), 0);
   const MyRowVector& v1 = *this;
   MyRowVector res(v1.rows() + v2.rows());
   EigenRowVector& opl = res;
@@ -265,6 +290,7 @@ double MyRowVector::operator()(unsigned int i) const
 
 bool MyRowVector::operator==(const MyRowVector& a) const
 {
+  MATRIX_PROFILE(ROW_COMPARE, 2, 2 * columns(), columns());
   if (this->columns() != a.columns()) return false;
   return(((EigenRowVector)(*this)-(EigenRowVector)a).isApproxToConstant(0.0));
 }
@@ -272,6 +298,7 @@ bool MyRowVector::operator==(const MyRowVector& a) const
 // Operators
 MyRowVector & MyRowVector::operator+= (const MyRowVector& a)
 {
+  MATRIX_PROFILE(ROW_ADD_ASSIGN, 0, 0, columns());
   EigenRowVector & op1 = (*this);
   const EigenRowVector & op2 = a;
   op1 += op2;
@@ -280,6 +307,7 @@ MyRowVector & MyRowVector::operator+= (const MyRowVector& a)
 
 MyRowVector & MyRowVector::operator-= (const MyRowVector& a)
 {
+  MATRIX_PROFILE(ROW_ADD_ASSIGN, 0, 0, columns());
   EigenRowVector & op1 = (*this);
   const EigenRowVector & op2 = a;
   op1 -= op2;
@@ -288,11 +316,13 @@ MyRowVector & MyRowVector::operator-= (const MyRowVector& a)
 
 MyRowVector MyRowVector::operator+ (const MyRowVector &a) const
 {
+  MATRIX_PROFILE(ROW_ADD, 4, 4 * columns(), columns());
   return (MyRowVector) ((EigenRowVector)(*this) + (EigenRowVector)a);
 }
 
 MyRowVector MyRowVector::operator- (const MyRowVector &a) const
 {
+  MATRIX_PROFILE(ROW_ADD, 4, 4 * columns(), columns());
   return (MyRowVector) ((EigenRowVector)(*this) - (EigenRowVector)a);
 }
 
@@ -300,6 +330,7 @@ MyRowVector MyRowVector::operator- (const MyRowVector &a) const
 
 MyRowVector& MyRowVector::operator+= (double a)
 {
+  MATRIX_PROFILE(ROW_SCALAR_ASSIGN, 0, 0, columns());
   EigenRowVector & op1 = *this;
   op1 += EigenRowVector::Constant(columns(),a);
   return (MyRowVector&)op1;
@@ -307,6 +338,7 @@ MyRowVector& MyRowVector::operator+= (double a)
 
 MyRowVector& MyRowVector::operator-= (double a)
 {
+  MATRIX_PROFILE(ROW_SCALAR_ASSIGN, 0, 0, columns());
   EigenRowVector & op1 = *this;
   op1 -= EigenRowVector::Constant(columns(),a);
   return (MyRowVector&)op1;
@@ -314,6 +346,7 @@ MyRowVector& MyRowVector::operator-= (double a)
 
 MyRowVector& MyRowVector::operator*= (double a)
 {
+  MATRIX_PROFILE(ROW_SCALAR_ASSIGN, 0, 0, columns());
   EigenRowVector& op1 = *this;
   op1 *= a;
   return (MyRowVector&) op1;
@@ -321,6 +354,7 @@ MyRowVector& MyRowVector::operator*= (double a)
 
 MyRowVector& MyRowVector::operator/= (double a)
 {
+  MATRIX_PROFILE(ROW_SCALAR_ASSIGN, 0, 0, columns());
   EigenRowVector& op1 = *this;
   op1 /= a;
   return (MyRowVector&) op1;
@@ -329,22 +363,26 @@ MyRowVector& MyRowVector::operator/= (double a)
 
 MyRowVector MyRowVector::operator+ (double a) const
 {
+  MATRIX_PROFILE(ROW_SCALAR, 3, 3 * columns(), columns());
   return (MyRowVector)(((EigenRowVector)(*this)) + EigenRowVector::Constant(columns(),a));
 }
 
 MyRowVector MyRowVector::operator- (double a) const
 {
+  MATRIX_PROFILE(ROW_SCALAR, 3, 3 * columns(), columns());
   return (MyRowVector)(((EigenRowVector)(*this)) - EigenRowVector::Constant(columns(),a));
 }
 
 MyRowVector MyRowVector::operator* (double a) const
 {
+  MATRIX_PROFILE(ROW_SCALAR, 2, 2 * columns(), columns());
   const EigenRowVector & op1 = (*this);
   return (MyRowVector) (op1 * a);
 }
 
 MyRowVector MyRowVector::operator/ (double a) const
 {
+  MATRIX_PROFILE(ROW_SCALAR, 2, 2 * columns(), columns());
   const EigenRowVector & op1 = (*this);
   return (MyRowVector) (op1 / a);
 }
@@ -353,12 +391,14 @@ MyRowVector MyRowVector::operator/ (double a) const
 
 MyColumnVector MyRowVector::transpose() const
 {
+  MATRIX_PROFILE(ROW_TRANSPOSE, 2, 2 * columns(), 0);
   const EigenRowVector & op1 = (*this);
   return MyColumnVector(op1.transpose());
 }
 
 double MyRowVector::operator* (const MyColumnVector &a) const
 {
+  MATRIX_PROFILE(ROW_DOT_PRODUCT, 1, 1, 2 * columns());
   const EigenRowVector & op1 = (*this);
   const EigenColumnVector & op2 = a;
   return (op1 * op2)(0,0);
@@ -367,6 +407,7 @@ double MyRowVector::operator* (const MyColumnVector &a) const
 MyRowVector&
 MyRowVector::operator=(const MyRowVector &a)
 {
+  MATRIX_PROFILE(ROW_ASSIGN, 1, a.columns(), 0);
   EigenRowVector& op1 = *this;
   op1 = (EigenRowVector)a;
   return *this;
@@ -382,6 +423,7 @@ MyRowVector::operator=(double a)
 
 MyRowVector MyRowVector::sub(int j_start , int j_end) const
 {
+  MATRIX_PROFILE(ROW_SUB, 2, 2 * (j_end - j_start + 1), 0);
   const EigenRowVector& op1 = *this;
   return MyRowVector(op1.segment(j_start-1,j_end-j_start+1));
 }
@@ -0,0 +1,181 @@
+#include "wrapper_profile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+namespace MatrixWrapper
+{
+namespace Profile
+{
+
+static Counters counters_;
+
+static const char* names_[NUM_OPERATIONS] = {
+  "Matrix::operator[+-*/]=(double)",
+  "Matrix::operator[+-*/](double)",
+  "Matrix::operator[+-]=(Matrix)",
+  "Matrix::operator[+-](Matrix)",
+  "Matrix::operator*(Matrix)",
+  "Matrix::operator*(ColumnVector)",
+  "Matrix::operator=(SymmetricMatrix)",
+  "Matrix::operator==",
+  "Matrix::rowCopy",
+  "Matrix::columnCopy",
+  "Matrix::transpose",
+  "Matrix::determinant",
+  "Matrix::inverse",
+  "Matrix::convertToSymmetricMatrix",
+  "Matrix::resize",
+  "Matrix::sub",
+
+  "SymmetricMatrix::operator[+-*/]=(double)",
+  "SymmetricMatrix::operator[+-*/](double)",
+  "SymmetricMatrix::operator[+-]=(Matrix)",
+  "SymmetricMatrix::operator[+-](Matrix)",
+  "SymmetricMatrix::operator*(Matrix)",
+  "SymmetricMatrix::multiply(ColumnVector)",
+  "SymmetricMatrix::operator=(double)",
+  "SymmetricMatrix::operator==",
+  "SymmetricMatrix::rowCopy",
+  "SymmetricMatrix::transpose",
+  "SymmetricMatrix::determinant",
+  "SymmetricMatrix::inverse",
+  "SymmetricMatrix::resize",
+  "SymmetricMatrix::sub",
+
+  "ColumnVector::operator[+-*/]=(double)",
+  "ColumnVector::operator[+-*/](double)",
+  "ColumnVector::operator[+-]=(ColumnVector)",
+  "ColumnVector::operator[+-](ColumnVector)",
+  "ColumnVector::operator*(RowVector)",
+  "ColumnVector::operator=(ColumnVector)",
+  "ColumnVector::operator==",
+  "ColumnVector::operator() const",
+  "ColumnVector::transpose",
+  "ColumnVector::vectorAdd",
+  "ColumnVector::resize/assign",
+  "ColumnVector::sub",
+
+  "RowVector::operator[+-*/]=(double)",
+  "RowVector::operator[+-*/](double)",
+  "RowVector::operator[+-]=(RowVector)",
+  "RowVector::operator[+-](RowVector)",
+  "RowVector::operator*(ColumnVector)",
+  "RowVector::operator=(RowVector)",
+  "RowVector::operator==",
+  "RowVector::transpose",
+  "RowVector::vectorAdd",
+  "RowVector::resize/assign",
+  "RowVector::sub"
+};
+
+bool isEnabled()
+{
+#ifdef __MATRIXWRAPPER_PROFILE__
+  return true;
+#else
+  return false;
+#endif
+}
+
+void record(Operation op, unsigned long long allocations, unsigned long long elements, unsigned long long flops)
+{
+  // atomic so that filters running in different threads do not lose counts
+  Counter& counter = counters_.operation[op];
+  __sync_fetch_and_add(&counter.calls, 1ULL);
+  __sync_fetch_and_add(&counter.allocations, allocations);
+  __sync_fetch_and_add(&counter.bytes, elements * sizeof(double));
+  __sync_fetch_and_add(&counter.flops, flops);
+}
+
+const char* getName(Operation op)
+{
+  return (op >= 0 && op < NUM_OPERATIONS) ? names_[op] : "unknown";
+}
+
+void get(Counters& counters)
+{
+  counters = counters_;
+}
+
+void reset()
+{
+  memset(&counters_, 0, sizeof(counters_));
+}
+
+void dump(std::ostream& os)
+{
+  Counters counters;
+  get(counters);
+  dump(os, counters);
+}
+
+static bool compareFlops(const std::pair<unsigned long long, int>& a, const std::pair<unsigned long long, int>& b)
+{
+  return a.first > b.first;
+}
+
+void dump(std::ostream& os, const Counters& counters)
+{
+  if (!isEnabled()) {
+    os << "matrix wrapper instrumentation disabled, rebuild BFL with BFL_WRAPPER_PROFILE=ON" << std::endl;
+    return;
+  }
+
+  std::pair<unsigned long long, int> order[NUM_OPERATIONS];
+  for (int i = 0; i < NUM_OPERATIONS; i++)
+    order[i] = std::make_pair(counters.operation[i].flops, i);
+  std::stable_sort(order, order + NUM_OPERATIONS, compareFlops);
+
+  Counter total;
+  memset(&total, 0, sizeof(total));
+
+  os << std::left << std::setw(42) << "operation" << std::right
+     << std::setw(12) << "calls" << std::setw(12) << "allocs"
+     << std::setw(14) << "bytes" << std::setw(14) << "flops" << std::endl;
+
+  for (int i = 0; i < NUM_OPERATIONS; i++) {
+    const Counter& counter = counters.operation[order[i].second];
+    if (counter.calls == 0) continue;
+
+    os << std::left << std::setw(42) << names_[order[i].second] << std::right
+       << std::setw(12) << counter.calls << std::setw(12) << counter.allocations
+       << std::setw(14) << counter.bytes << std::setw(14) << counter.flops << std::endl;
+
+    total.calls += counter.calls;
+    total.allocations += counter.allocations;
+    total.bytes += counter.bytes;
+    total.flops += counter.flops;
+  }
+
+  os << std::left << std::setw(42) << "total" << std::right
+     << std::setw(12) << total.calls << std::setw(12) << total.allocations
+     << std::setw(14) << total.bytes << std::setw(14) << total.flops << std::endl;
+}
+
+StepReport::StepReport(const std::string& label, std::ostream& os)
+  : label_(label), os_(os)
+{
+  get(start_);
+}
+
+StepReport::~StepReport()
+{
+  Counters end;
+  get(end);
+
+  for (int i = 0; i < NUM_OPERATIONS; i++) {
+    end.operation[i].calls -= start_.operation[i].calls;
+    end.operation[i].allocations -= start_.operation[i].allocations;
+    end.operation[i].bytes -= start_.operation[i].bytes;
+    end.operation[i].flops -= start_.operation[i].flops;
+  }
+
+  os_ << "--- " << label_ << std::endl;
+  dump(os_, end);
+}
+
+} // namespace Profile
+} // namespace MatrixWrapper
@@ -0,0 +1,143 @@
+#include "../config.h"
+
+#ifndef __WRAPPER_PROFILE__
+#define __WRAPPER_PROFILE__
+
+#include <iosfwd>
+#include <string>
+
+// Instrumentation of the matrix wrapper.
+//
+// If BFL is configured with BFL_WRAPPER_PROFILE=ON (__MATRIXWRAPPER_PROFILE__), every wrapper
+// operator records its call, the heap allocations it causes (result and temporaries) and an
+// estimate of the floating point operations. Without it, MATRIX_PROFILE compiles to nothing and
+// all counters stay zero; the API below is available in both cases.
+//
+// Typical use in a filter loop:
+//
+//   MatrixWrapper::Profile::StepReport report("ekf update", std::cerr);
+//   filter->Update(&measurement_model, z);
+//
+// prints the operations of this step when report goes out of scope.
+
+namespace MatrixWrapper
+{
+namespace Profile
+{
+
+enum Operation
+{
+  MATRIX_SCALAR_ASSIGN,
+  MATRIX_SCALAR,
+  MATRIX_ADD_ASSIGN,
+  MATRIX_ADD,
+  MATRIX_MULTIPLY,
+  MATRIX_MULTIPLY_VECTOR,
+  MATRIX_ASSIGN,
+  MATRIX_COMPARE,
+  MATRIX_ROW_COPY,
+  MATRIX_COLUMN_COPY,
+  MATRIX_TRANSPOSE,
+  MATRIX_DETERMINANT,
+  MATRIX_INVERSE,
+  MATRIX_CONVERT_SYMMETRIC,
+  MATRIX_RESIZE,
+  MATRIX_SUB,
+
+  SYMMETRIC_SCALAR_ASSIGN,
+  SYMMETRIC_SCALAR,
+  SYMMETRIC_ADD_ASSIGN,
+  SYMMETRIC_ADD,
+  SYMMETRIC_MULTIPLY,
+  SYMMETRIC_MULTIPLY_VECTOR,
+  SYMMETRIC_ASSIGN,
+  SYMMETRIC_COMPARE,
+  SYMMETRIC_ROW_COPY,
+  SYMMETRIC_TRANSPOSE,
+  SYMMETRIC_DETERMINANT,
+  SYMMETRIC_INVERSE,
+  SYMMETRIC_RESIZE,
+  SYMMETRIC_SUB,
+
+  COLUMN_SCALAR_ASSIGN,
+  COLUMN_SCALAR,
+  COLUMN_ADD_ASSIGN,
+  COLUMN_ADD,
+  COLUMN_OUTER_PRODUCT,
+  COLUMN_ASSIGN,
+  COLUMN_COMPARE,
+  COLUMN_ELEMENT,
+  COLUMN_TRANSPOSE,
+  COLUMN_CONCAT,
+  COLUMN_RESIZE,
+  COLUMN_SUB,
+
+  ROW_SCALAR_ASSIGN,
+  ROW_SCALAR,
+  ROW_ADD_ASSIGN,
+  ROW_ADD,
+  ROW_DOT_PRODUCT,
+  ROW_ASSIGN,
+  ROW_COMPARE,
+  ROW_TRANSPOSE,
+  ROW_CONCAT,
+  ROW_RESIZE,
+  ROW_SUB,
+
+  NUM_OPERATIONS
+};
+
+struct Counter
+{
+  unsigned long long calls;
+  unsigned long long allocations;
+  unsigned long long bytes;
+  unsigned long long flops;
+};
+
+struct Counters
+{
+  Counter operation[NUM_OPERATIONS];
+};
+
+/// true if the library was built with instrumentation
+bool isEnabled();
+
+/// Called by the wrapper; elements is the total number of doubles allocated
+void record(Operation op, unsigned long long allocations, unsigned long long elements, unsigned long long flops);
+
+const char* getName(Operation op);
+
+/// Copy of the current counters
+void get(Counters& counters);
+
+void reset();
+
+/// Table of all operations that were called, sorted by flops
+void dump(std::ostream& os);
+void dump(std::ostream& os, const Counters& counters);
+
+/// Prints the operations executed between construction and destruction
+class StepReport
+{
+ public:
+  StepReport(const std::string& label, std::ostream& os);
+  ~StepReport();
+
+ private:
+  std::string label_;
+  std::ostream& os_;
+  Counters start_;
+};
+
+} // namespace Profile
+} // namespace MatrixWrapper
+
+#ifdef __MATRIXWRAPPER_PROFILE__
+#define MATRIX_PROFILE(op, allocations, elements, flops) \
+  ::MatrixWrapper::Profile::record(::MatrixWrapper::Profile::op, (allocations), (elements), (flops))
+#else
+#define MATRIX_PROFILE(op, allocations, elements, flops)
+#endif
+
+#endif // __WRAPPER_PROFILE__
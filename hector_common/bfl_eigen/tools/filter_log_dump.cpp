@@ -0,0 +1,74 @@
+#include <filterlog_EIGEN.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Prints a filter log written by MatrixWrapper::FilterLogWriter as text, one record per line:
+//   time channel state[0..n-1] followed by the standard deviations or, with --covariance, the upper
+//   triangle of the covariance matrix
+
+static void usage()
+{
+  fprintf(stderr, "usage: filter_log_dump [--channel n] [--covariance] <log file>\n");
+}
+
+int main(int argc, char **argv)
+{
+  const char* filename = 0;
+  int channel = -1;
+  bool covariance = false;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--channel") == 0 && i + 1 < argc) {
+      channel = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--covariance") == 0) {
+      covariance = true;
+    } else if (argv[i][0] != '-' && !filename) {
+      filename = argv[i];
+    } else {
+      usage();
+      return 1;
+    }
+  }
+
+  if (!filename) {
+    usage();
+    return 1;
+  }
+
+  MatrixWrapper::FilterLogReader reader;
+  if (!reader.open(filename)) return 1;
+
+  const MatrixWrapper::FilterLogRecord* record;
+  unsigned long count = 0;
+
+  while ((record = reader.next()) != 0) {
+    if (channel >= 0 && record->channel != channel) continue;
+
+    printf("%.6f %u", record->time, record->channel);
+
+    const double* state = MatrixWrapper::FilterLogReader::getState(record);
+    for (unsigned int i = 0; i < record->state_dimension; ++i)
+      printf(" %.9g", state[i]);
+
+    const double* packed = MatrixWrapper::FilterLogReader::getCovariance(record);
+    unsigned int n = record->covariance_dimension;
+
+    if (covariance) {
+      for (size_t i = 0; i < MatrixWrapper::Serialization::symmetricSize(n); ++i)
+        printf(" %.9g", packed[i]);
+    } else {
+      // diagonal element j of the packed upper triangle is at j (j + 3) / 2
+      for (unsigned int j = 0; j < n; ++j)
+        printf(" %.9g", std::sqrt(packed[j * (j + 3) / 2]));
+    }
+
+    printf("\n");
+    count++;
+  }
+
+  fprintf(stderr, "%lu records\n", count);
+  return 0;
+}
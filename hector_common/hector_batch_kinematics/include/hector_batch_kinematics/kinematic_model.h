@@ -0,0 +1,134 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef hector_batch_kinematics_kinematic_model_h__
+#define hector_batch_kinematics_kinematic_model_h__
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <string>
+#include <vector>
+
+namespace hector_batch_kinematics{
+
+/**
+ * Rigid transform stored as row major 3x3 rotation followed by the translation.
+ * Plain array layout so batches of poses are contiguous in memory.
+ */
+struct Transform
+{
+  double rotation[9];
+  double translation[3];
+
+  void setIdentity();
+  Eigen::Isometry3d toEigen() const;
+  static Transform fromEigen(const Eigen::Isometry3d& transform);
+};
+
+/**
+ * Tree of links connected by revolute, continuous, prismatic or fixed joints, compiled into flat
+ * arrays in topological order (parents before children).
+ *
+ * The fixed part of each joint (origin, and for fixed joints the whole transform) is precomputed,
+ * so evaluating a link pose costs one rotation about the joint axis and one transform product.
+ * Batches of configurations can be evaluated on several threads.
+ */
+class KinematicModel
+{
+public:
+  enum JointType { FIXED, REVOLUTE, PRISMATIC };
+
+  KinematicModel();
+
+  /**
+   * Appends a link. parent is the index of an already added link, or -1 for the root.
+   * For non fixed joints a joint variable is created and its index returned, otherwise -1.
+   */
+  int addLink(const std::string& link_name, int parent, const Eigen::Isometry3d& origin,
+              JointType type = FIXED, const std::string& joint_name = std::string(),
+              const Eigen::Vector3d& axis = Eigen::Vector3d::UnitZ(), double lower = 0.0, double upper = 0.0);
+
+  void clear();
+
+  size_t getNumLinks() const { return link_names_.size(); }
+  size_t getNumVariables() const { return variable_names_.size(); }
+
+  const std::string& getLinkName(size_t link) const { return link_names_[link]; }
+  const std::string& getVariableName(size_t variable) const { return variable_names_[variable]; }
+  double getVariableLower(size_t variable) const { return variable_lower_[variable]; }
+  double getVariableUpper(size_t variable) const { return variable_upper_[variable]; }
+
+  /// Returns -1 if not found
+  int getLinkIndex(const std::string& link_name) const;
+  int getVariableIndex(const std::string& joint_name) const;
+
+  /// Poses of all links relative to the root for one configuration. poses must hold getNumLinks() elements.
+  void computeLinkPoses(const double* q, Transform* poses) const;
+
+  /// Pose of a single link; only the links on its path to the root are evaluated.
+  void computeLinkPose(const double* q, size_t link, Transform& pose) const;
+
+  /**
+   * Evaluates count configurations. q holds count * getNumVariables() values, poses receives
+   * count * getNumLinks() transforms (configuration major). num_threads = 0 uses all cores.
+   */
+  void computeBatch(const double* q, size_t count, Transform* poses, unsigned int num_threads = 0) const;
+
+  /// Batch evaluation of a single link, poses receives count transforms.
+  void computeBatch(const double* q, size_t count, size_t link, Transform* poses, unsigned int num_threads = 0) const;
+
+protected:
+  void computeRange(const double* q, size_t begin, size_t end, Transform* poses) const;
+  void computeRange(const double* q, size_t begin, size_t end, size_t link, Transform* poses) const;
+
+  inline void computeLink(size_t link, const double* q, const Transform& parent_pose, Transform& pose) const;
+
+  // per link, in topological order
+  std::vector<std::string> link_names_;
+  std::vector<int> parents_;
+  std::vector<Transform> origins_;
+  std::vector<int> types_;
+  std::vector<int> variables_;
+  std::vector<double> axes_;         // 3 values per link
+
+  // links on the path from the root to each link, root first
+  std::vector<std::vector<int> > paths_;
+
+  std::vector<std::string> variable_names_;
+  std::vector<double> variable_lower_;
+  std::vector<double> variable_upper_;
+
+  // batches smaller than this per thread are evaluated on the calling thread
+  size_t min_batch_per_thread_;
+};
+
+}
+
+#endif
@@ -0,0 +1,290 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <hector_batch_kinematics/kinematic_model.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace hector_batch_kinematics{
+
+void Transform::setIdentity()
+{
+  for (int i = 0; i < 9; ++i){
+    rotation[i] = (i % 4 == 0) ? 1.0 : 0.0;
+  }
+  translation[0] = translation[1] = translation[2] = 0.0;
+}
+
+Eigen::Isometry3d Transform::toEigen() const
+{
+  Eigen::Isometry3d transform (Eigen::Isometry3d::Identity());
+  for (int r = 0; r < 3; ++r){
+    for (int c = 0; c < 3; ++c){
+      transform.linear()(r, c) = rotation[r * 3 + c];
+    }
+    transform.translation()[r] = translation[r];
+  }
+  return transform;
+}
+
+Transform Transform::fromEigen(const Eigen::Isometry3d& transform)
+{
+  Transform result;
+  for (int r = 0; r < 3; ++r){
+    for (int c = 0; c < 3; ++c){
+      result.rotation[r * 3 + c] = transform.linear()(r, c);
+    }
+    result.translation[r] = transform.translation()[r];
+  }
+  return result;
+}
+
+KinematicModel::KinematicModel()
+  : min_batch_per_thread_(256)
+{}
+
+void KinematicModel::clear()
+{
+  link_names_.clear();
+  parents_.clear();
+  origins_.clear();
+  types_.clear();
+  variables_.clear();
+  axes_.clear();
+  paths_.clear();
+  variable_names_.clear();
+  variable_lower_.clear();
+  variable_upper_.clear();
+}
+
+int KinematicModel::addLink(const std::string& link_name, int parent, const Eigen::Isometry3d& origin,
+                            JointType type, const std::string& joint_name,
+                            const Eigen::Vector3d& axis, double lower, double upper)
+{
+  int index = static_cast<int>(link_names_.size());
+
+  link_names_.push_back(link_name);
+  parents_.push_back(parent);
+  origins_.push_back(Transform::fromEigen(origin));
+  types_.push_back(type);
+
+  Eigen::Vector3d unit_axis (axis.normalized());
+  axes_.push_back(unit_axis.x());
+  axes_.push_back(unit_axis.y());
+  axes_.push_back(unit_axis.z());
+
+  int variable = -1;
+
+  if (type != FIXED){
+    variable = static_cast<int>(variable_names_.size());
+    variable_names_.push_back(joint_name);
+    variable_lower_.push_back(lower);
+    variable_upper_.push_back(upper);
+  }
+
+  variables_.push_back(variable);
+
+  std::vector<int> path;
+  if (parent >= 0){
+    path = paths_[parent];
+  }
+  path.push_back(index);
+  paths_.push_back(path);
+
+  return variable;
+}
+
+int KinematicModel::getLinkIndex(const std::string& link_name) const
+{
+  std::vector<std::string>::const_iterator it = std::find(link_names_.begin(), link_names_.end(), link_name);
+  return it == link_names_.end() ? -1 : static_cast<int>(it - link_names_.begin());
+}
+
+int KinematicModel::getVariableIndex(const std::string& joint_name) const
+{
+  std::vector<std::string>::const_iterator it = std::find(variable_names_.begin(), variable_names_.end(), joint_name);
+  return it == variable_names_.end() ? -1 : static_cast<int>(it - variable_names_.begin());
+}
+
+inline void KinematicModel::computeLink(size_t link, const double* q, const Transform& parent_pose, Transform& pose) const
+{
+  const Transform& origin = origins_[link];
+  const double* o = origin.rotation;
+  const double* p = parent_pose.rotation;
+
+  // local = origin * joint motion
+  double local[9];
+  double local_translation[3] = { origin.translation[0], origin.translation[1], origin.translation[2] };
+
+  int type = types_[link];
+
+  if (type == REVOLUTE){
+    const double* a = &axes_[link * 3];
+    double angle = q[variables_[link]];
+    double c = std::cos(angle);
+    double s = std::sin(angle);
+    double t = 1.0 - c;
+
+    double m[9] = {
+      t * a[0] * a[0] + c,        t * a[0] * a[1] - s * a[2], t * a[0] * a[2] + s * a[1],
+      t * a[0] * a[1] + s * a[2], t * a[1] * a[1] + c,        t * a[1] * a[2] - s * a[0],
+      t * a[0] * a[2] - s * a[1], t * a[1] * a[2] + s * a[0], t * a[2] * a[2] + c
+    };
+
+    for (int r = 0; r < 3; ++r){
+      for (int col = 0; col < 3; ++col){
+        local[r * 3 + col] = o[r * 3] * m[col] + o[r * 3 + 1] * m[3 + col] + o[r * 3 + 2] * m[6 + col];
+      }
+    }
+  }else{
+    std::copy(o, o + 9, local);
+
+    if (type == PRISMATIC){
+      const double* a = &axes_[link * 3];
+      double d = q[variables_[link]];
+
+      for (int r = 0; r < 3; ++r){
+        local_translation[r] += (o[r * 3] * a[0] + o[r * 3 + 1] * a[1] + o[r * 3 + 2] * a[2]) * d;
+      }
+    }
+  }
+
+  for (int r = 0; r < 3; ++r){
+    for (int c = 0; c < 3; ++c){
+      pose.rotation[r * 3 + c] = p[r * 3] * local[c] + p[r * 3 + 1] * local[3 + c] + p[r * 3 + 2] * local[6 + c];
+    }
+    pose.translation[r] = p[r * 3] * local_translation[0] + p[r * 3 + 1] * local_translation[1] + p[r * 3 + 2] * local_translation[2] + parent_pose.translation[r];
+  }
+}
+
+void KinematicModel::computeLinkPoses(const double* q, Transform* poses) const
+{
+  Transform identity;
+  identity.setIdentity();
+
+  size_t num_links = link_names_.size();
+
+  for (size_t i = 0; i < num_links; ++i){
+    int parent = parents_[i];
+    computeLink(i, q, parent < 0 ? identity : poses[parent], poses[i]);
+  }
+}
+
+void KinematicModel::computeLinkPose(const double* q, size_t link, Transform& pose) const
+{
+  Transform current;
+  current.setIdentity();
+
+  const std::vector<int>& path = paths_[link];
+
+  for (size_t i = 0; i < path.size(); ++i){
+    computeLink(path[i], q, current, pose);
+    current = pose;
+  }
+}
+
+void KinematicModel::computeRange(const double* q, size_t begin, size_t end, Transform* poses) const
+{
+  size_t num_links = link_names_.size();
+  size_t num_variables = variable_names_.size();
+
+  for (size_t i = begin; i < end; ++i){
+    computeLinkPoses(q + i * num_variables, poses + i * num_links);
+  }
+}
+
+void KinematicModel::computeRange(const double* q, size_t begin, size_t end, size_t link, Transform* poses) const
+{
+  size_t num_variables = variable_names_.size();
+
+  for (size_t i = begin; i < end; ++i){
+    computeLinkPose(q + i * num_variables, link, poses[i]);
+  }
+}
+
+static unsigned int getNumThreads(unsigned int num_threads, size_t count, size_t min_batch_per_thread)
+{
+  if (num_threads == 0){
+    num_threads = std::max(1u, boost::thread::hardware_concurrency());
+  }
+
+  size_t max_threads = std::max(static_cast<size_t>(1), count / min_batch_per_thread);
+  return static_cast<unsigned int>(std::min(static_cast<size_t>(num_threads), max_threads));
+}
+
+void KinematicModel::computeBatch(const double* q, size_t count, Transform* poses, unsigned int num_threads) const
+{
+  num_threads = getNumThreads(num_threads, count, min_batch_per_thread_);
+
+  if (num_threads == 1){
+    computeRange(q, 0, count, poses);
+    return;
+  }
+
+  void (KinematicModel::*compute)(const double*, size_t, size_t, Transform*) const = &KinematicModel::computeRange;
+
+  boost::thread_group threads;
+  size_t chunk = (count + num_threads - 1) / num_threads;
+
+  // the calling thread takes the first chunk
+  for (size_t begin = chunk; begin < count; begin += chunk){
+    threads.create_thread(boost::bind(compute, this, q, begin, std::min(begin + chunk, count), poses));
+  }
+
+  computeRange(q, 0, std::min(chunk, count), poses);
+  threads.join_all();
+}
+
+void KinematicModel::computeBatch(const double* q, size_t count, size_t link, Transform* poses, unsigned int num_threads) const
+{
+  num_threads = getNumThreads(num_threads, count, min_batch_per_thread_);
+
+  if (num_threads == 1){
+    computeRange(q, 0, count, link, poses);
+    return;
+  }
+
+  void (KinematicModel::*compute)(const double*, size_t, size_t, size_t, Transform*) const = &KinematicModel::computeRange;
+
+  boost::thread_group threads;
+  size_t chunk = (count + num_threads - 1) / num_threads;
+
+  for (size_t begin = chunk; begin < count; begin += chunk){
+    threads.create_thread(boost::bind(compute, this, q, begin, std::min(begin + chunk, count), link, poses));
+  }
+
+  computeRange(q, 0, std::min(chunk, count), link, poses);
+  threads.join_all();
+}
+
+}
@@ -0,0 +1,137 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <hector_batch_kinematics/urdf_loader.h>
+
+#include <ros/console.h>
+
+#include <cmath>
+
+namespace hector_batch_kinematics{
+
+static Eigen::Isometry3d toEigen(const urdf::Pose& pose)
+{
+  Eigen::Isometry3d transform (Eigen::Isometry3d::Identity());
+  transform.translation() = Eigen::Vector3d(pose.position.x, pose.position.y, pose.position.z);
+  transform.linear() = Eigen::Quaterniond(pose.rotation.w, pose.rotation.x, pose.rotation.y, pose.rotation.z).toRotationMatrix();
+  return transform;
+}
+
+static bool addJoint(const urdf::Joint& joint, const std::string& child_link, int parent, KinematicModel& model)
+{
+  Eigen::Isometry3d origin (toEigen(joint.parent_to_joint_origin_transform));
+  Eigen::Vector3d axis (joint.axis.x, joint.axis.y, joint.axis.z);
+
+  switch (joint.type){
+    case urdf::Joint::FIXED:
+      model.addLink(child_link, parent, origin);
+      return true;
+
+    case urdf::Joint::REVOLUTE:
+      model.addLink(child_link, parent, origin, KinematicModel::REVOLUTE, joint.name, axis, joint.limits->lower, joint.limits->upper);
+      return true;
+
+    case urdf::Joint::CONTINUOUS:
+      model.addLink(child_link, parent, origin, KinematicModel::REVOLUTE, joint.name, axis, -M_PI, M_PI);
+      return true;
+
+    case urdf::Joint::PRISMATIC:
+      model.addLink(child_link, parent, origin, KinematicModel::PRISMATIC, joint.name, axis, joint.limits->lower, joint.limits->upper);
+      return true;
+
+    default:
+      ROS_ERROR("Joint %s has an unsupported type", joint.name.c_str());
+      return false;
+  }
+}
+
+static bool addSubtree(const boost::shared_ptr<const urdf::Link>& link, int parent, KinematicModel& model)
+{
+  for (size_t i = 0; i < link->child_links.size(); ++i){
+    const boost::shared_ptr<urdf::Link>& child = link->child_links[i];
+
+    if (!addJoint(*child->parent_joint, child->name, parent, model)){
+      return false;
+    }
+
+    if (!addSubtree(child, static_cast<int>(model.getNumLinks()) - 1, model)){
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool loadFromUrdf(const urdf::Model& urdf_model, KinematicModel& model, const std::string& root_link, const std::string& tip_link)
+{
+  boost::shared_ptr<const urdf::Link> root = root_link.empty() ? urdf_model.getRoot() : urdf_model.getLink(root_link);
+
+  if (!root){
+    ROS_ERROR("Link %s not found in robot description", root_link.c_str());
+    return false;
+  }
+
+  model.clear();
+  model.addLink(root->name, -1, Eigen::Isometry3d::Identity());
+
+  if (tip_link.empty()){
+    return addSubtree(root, 0, model);
+  }
+
+  boost::shared_ptr<const urdf::Link> link = urdf_model.getLink(tip_link);
+
+  if (!link){
+    ROS_ERROR("Link %s not found in robot description", tip_link.c_str());
+    return false;
+  }
+
+  std::vector<boost::shared_ptr<const urdf::Link> > chain;
+
+  while (link->name != root->name){
+    if (!link->parent_joint){
+      ROS_ERROR("Link %s is not a parent of %s", root->name.c_str(), tip_link.c_str());
+      return false;
+    }
+
+    chain.push_back(link);
+    link = link->getParent();
+  }
+
+  for (size_t i = chain.size(); i > 0; --i){
+    const urdf::Link& child = *chain[i - 1];
+
+    if (!addJoint(*child.parent_joint, child.name, static_cast<int>(model.getNumLinks()) - 1, model)){
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}
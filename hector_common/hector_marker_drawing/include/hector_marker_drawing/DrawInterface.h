@@ -30,10 +30,18 @@
 #define drawinterface_h__
 
 #include <Eigen/Core>
+#include <cmath>
 #include <string>
 
 class DrawInterface{
 public:
+  /// Bulk input, one column per item, e.g. PointArray(data, 3, n) over n packed x,y,z floats
+  typedef Eigen::Map<const Eigen::Matrix<float, 3, Eigen::Dynamic> > PointArray;
+  typedef Eigen::Map<const Eigen::Matrix<float, 4, Eigen::Dynamic> > ColorArray;   // r,g,b,a
+  typedef Eigen::Map<const Eigen::Matrix<float, 7, Eigen::Dynamic> > PoseArray;    // x,y,z,qx,qy,qz,qw
+
+  virtual ~DrawInterface() {}
+
   virtual void setNamespace(const std::string& ns) = 0;
 
   virtual void drawPoint(const Eigen::Vector2f& pointWorldFrame) = 0;
@@ -41,6 +49,51 @@ public:
   virtual void drawCovariance(const Eigen::Vector2f& mean, const Eigen::Matrix2f& cov) = 0;
   virtual void drawCovariance(const Eigen::Vector3f& mean, const Eigen::Matrix3f& covMatrix) = 0;
 
+  // Bulk drawing. Implementations should turn each call into a single marker; the defaults fall
+  // back to the per-item calls above and drop the z coordinate and the colors.
+
+  /// Points of size scale
+  virtual void drawPoints(const PointArray& points)
+  {
+    for (int i = 0; i < points.cols(); ++i) drawPoint(points.col(i).head<2>());
+  }
+
+  virtual void drawPoints(const PointArray& points, const ColorArray& colors)
+  {
+    drawPoints(points);
+  }
+
+  /// Connected line of width scale, e.g. a trajectory
+  virtual void drawLineStrip(const PointArray& points)
+  {
+    drawPoints(points);
+  }
+
+  virtual void drawLineStrip(const PointArray& points, const ColorArray& colors)
+  {
+    drawLineStrip(points);
+  }
+
+  /// Triangles of three consecutive points each
+  virtual void drawTriangles(const PointArray& points)
+  {
+    drawPoints(points);
+  }
+
+  virtual void drawTriangles(const PointArray& points, const ColorArray& colors)
+  {
+    drawTriangles(points);
+  }
+
+  /// Poses as lines of the given length along their x axis
+  virtual void drawPoses(const PoseArray& poses, float length = 1.0f)
+  {
+    for (int i = 0; i < poses.cols(); ++i){
+      const float qx = poses(3, i), qy = poses(4, i), qz = poses(5, i), qw = poses(6, i);
+      drawArrow(Eigen::Vector3f(poses(0, i), poses(1, i), std::atan2(2.0f * (qw * qz + qx * qy), 1.0f - 2.0f * (qy * qy + qz * qz))));
+    }
+  }
+
   virtual void setScale(double scale) = 0;
   virtual void setColor(double r, double g, double b, double a = 1.0) = 0;
 
@@ -26,6 +26,9 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //=================================================================================================
 
+#ifndef hectordrawings_h__
+#define hectordrawings_h__
+
 #include "DrawInterface.h"
 //#include "util/UtilFunctions.h"
 
@@ -34,18 +37,43 @@
 #include <Eigen/Geometry>
 #include <Eigen/Dense>
 
+#include <boost/thread/mutex.hpp>
+#include <pthread.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
 
 #include <visualization_msgs/MarkerArray.h>
-
+#include <geometry_msgs/Point.h>
+#include <std_msgs/ColorRGBA.h>
+
+/**
+ * Publishes debug drawings as a marker array.
+ *
+ * By default all state lives in the instance and it must only be used from one thread. In thread
+ * safe mode every drawing thread gets its own buffer with its own copy of the drawing state
+ * (namespace, scale, color, time, initialized from the instance when the thread draws for the first
+ * time) and allocates marker ids in blocks from an atomic counter. A thread only locks its own
+ * buffer while drawing, so the lock is uncontended except while sendAndResetData() collects the
+ * buffers by swapping their marker lists out. When a drawing thread exits, its undelivered markers
+ * are handed to the instance and its buffer is freed.
+ */
 class HectorDrawings : public DrawInterface
 {
 public:
 
-  HectorDrawings()
+  HectorDrawings(bool threadSafe = false)
   {
     idCounter = 0;
     maxId = 0;
 
+    // the defaults below go to the instance, thread buffers copy them
+    threadSafe_ = false;
+    idState_ = 0;
+    retired_.generation = 0;
+    retired_.nextId = retired_.endId = 0;
+    pthread_key_create(&bufferKey_, &releaseThreadBuffer);
+
     ros::NodeHandle nh_;
 
     markerPublisher_ = nh_.advertise<visualization_msgs::Marker>("visualization_marker", 1, true);
@@ -58,16 +86,28 @@ public:
     this->setColor(1.0, 1.0, 1.0);
 
     tempMarker.action = visualization_msgs::Marker::ADD;
+
+    threadSafe_ = threadSafe;
   };
 
+  virtual ~HectorDrawings()
+  {
+    pthread_key_delete(bufferKey_);
+    for (size_t i = 0; i < buffers_.size(); ++i){
+      delete buffers_[i];
+    }
+  }
+
+  bool isThreadSafe() const { return threadSafe_; }
+
   virtual void setNamespace(const std::string& ns)
   {
-    tempMarker.ns = ns;
+    currentMarker().ns = ns;
   }
 
   virtual void drawPoint(const Eigen::Vector2f& pointWorldFrame)
   {
-    tempMarker.id = idCounter++;
+    visualization_msgs::Marker& tempMarker = currentMarker();
 
     tempMarker.pose.position.x = pointWorldFrame.x();
     tempMarker.pose.position.y = pointWorldFrame.y();
@@ -78,12 +118,12 @@ public:
 
     //markerPublisher_.publish(tempMarker);
 
-    markerArray.markers.push_back(tempMarker);
+    pushMarker(tempMarker);
   }
 
   virtual void drawArrow(const Eigen::Vector3f& poseWorld)
   {
-    tempMarker.id = idCounter++;
+    visualization_msgs::Marker& tempMarker = currentMarker();
 
     tempMarker.pose.position.x = poseWorld.x();
     tempMarker.pose.position.y = poseWorld.y();
@@ -95,12 +135,13 @@ public:
 
     //markerPublisher_.publish(tempMarker);
 
-    markerArray.markers.push_back(tempMarker);
+    pushMarker(tempMarker);
 
   }
 
   virtual void drawCovariance(const Eigen::Vector2f& mean, const Eigen::Matrix2f& covMatrix)
   {
+    visualization_msgs::Marker& tempMarker = currentMarker();
 
     tempMarker.pose.position.x = mean[0];
     tempMarker.pose.position.y = mean[1];
@@ -125,12 +166,13 @@ public:
     tempMarker.pose.orientation.w = cos(angle*0.5);
     tempMarker.pose.orientation.z = sin(angle*0.5);
 
-    tempMarker.id = idCounter++;
-    markerArray.markers.push_back(tempMarker);
+    pushMarker(tempMarker);
   }
 
   virtual void drawCovariance(const Eigen::Vector3f& mean, const Eigen::Matrix3f& covMatrix)
   {
+    visualization_msgs::Marker& tempMarker = currentMarker();
+
     tempMarker.type = visualization_msgs::Marker::SPHERE;
 
     tempMarker.color.r = 0.0;
@@ -172,14 +214,69 @@ public:
     tempMarker.scale.y = sqrt(eigValues[1]);
     tempMarker.scale.z = sqrt(eigValues[0]);
 
-    tempMarker.id = idCounter++;
-    markerArray.markers.push_back(tempMarker);
+    pushMarker(tempMarker);
+
+
+  }
+
+  virtual void drawPoints(const PointArray& points)
+  {
+    pushBulkMarker(visualization_msgs::Marker::POINTS, points, 0);
+  }
 
+  virtual void drawPoints(const PointArray& points, const ColorArray& colors)
+  {
+    pushBulkMarker(visualization_msgs::Marker::POINTS, points, &colors);
+  }
 
+  virtual void drawLineStrip(const PointArray& points)
+  {
+    pushBulkMarker(visualization_msgs::Marker::LINE_STRIP, points, 0);
+  }
+
+  virtual void drawLineStrip(const PointArray& points, const ColorArray& colors)
+  {
+    pushBulkMarker(visualization_msgs::Marker::LINE_STRIP, points, &colors);
+  }
+
+  virtual void drawTriangles(const PointArray& points)
+  {
+    pushBulkMarker(visualization_msgs::Marker::TRIANGLE_LIST, points, 0);
+  }
+
+  virtual void drawTriangles(const PointArray& points, const ColorArray& colors)
+  {
+    pushBulkMarker(visualization_msgs::Marker::TRIANGLE_LIST, points, &colors);
+  }
+
+  virtual void drawPoses(const PoseArray& poses, float length = 1.0f)
+  {
+    visualization_msgs::Marker marker;
+    initBulkMarker(visualization_msgs::Marker::LINE_LIST, marker);
+
+    const int n = poses.cols();
+    marker.points.resize(2 * n);
+    for (int i = 0; i < n; ++i){
+      const float qx = poses(3, i), qy = poses(4, i), qz = poses(5, i), qw = poses(6, i);
+
+      geometry_msgs::Point& start = marker.points[2 * i];
+      start.x = poses(0, i);
+      start.y = poses(1, i);
+      start.z = poses(2, i);
+
+      // x axis of the rotation
+      geometry_msgs::Point& end = marker.points[2 * i + 1];
+      end.x = start.x + length * (1.0f - 2.0f * (qy * qy + qz * qz));
+      end.y = start.y + length * (2.0f * (qx * qy + qw * qz));
+      end.z = start.z + length * (2.0f * (qx * qz - qw * qy));
+    }
+
+    pushMarker(marker);
   }
 
   virtual void setScale(double scale)
   {
+    visualization_msgs::Marker& tempMarker = currentMarker();
     tempMarker.scale.x = scale;
     tempMarker.scale.y = scale;
     tempMarker.scale.z = scale;
@@ -187,6 +284,7 @@ public:
 
   virtual void setColor(double r, double g, double b, double a = 1.0)
   {
+    visualization_msgs::Marker& tempMarker = currentMarker();
     tempMarker.color.r = r;
     tempMarker.color.g = g;
     tempMarker.color.b = b;
@@ -194,9 +292,8 @@ public:
   }
 
   virtual void addMarker(visualization_msgs::Marker marker) {
-    if (marker.id == 0) marker.id = idCounter++;
-    if (marker.ns.empty()) marker.ns = tempMarker.ns;
-    markerArray.markers.push_back(marker);
+    if (marker.ns.empty()) marker.ns = currentMarker().ns;
+    pushMarker(marker, marker.id == 0);
   }
 
   virtual void addMarkers(visualization_msgs::MarkerArray markers) {
@@ -208,7 +305,20 @@ public:
 
   virtual void sendAndResetData()
   {
-    allMarkers.markers.insert(allMarkers.markers.end(), markerArray.markers.begin(), markerArray.markers.end());
+    if (threadSafe_){
+      collectBuffers();
+    }
+
+    // reset() only needs ns and id to delete the markers again, so the point lists are not copied
+    allMarkers.markers.reserve(allMarkers.markers.size() + markerArray.markers.size());
+    for (size_t i = 0; i < markerArray.markers.size(); ++i){
+      const visualization_msgs::Marker& marker = markerArray.markers[i];
+      allMarkers.markers.push_back(visualization_msgs::Marker());
+      allMarkers.markers.back().header = marker.header;
+      allMarkers.markers.back().ns = marker.ns;
+      allMarkers.markers.back().id = marker.id;
+    }
+
     markerArrayPublisher_.publish(markerArray);
     markerArray.markers.clear();
     if (idCounter > maxId) maxId = idCounter;
@@ -217,7 +327,7 @@ public:
 
   void setTime(const ros::Time& time)
   {
-    tempMarker.header.stamp = time;
+    currentMarker().header.stamp = time;
   }
 
   void reset()
@@ -239,4 +349,236 @@ public:
 
   int idCounter;
   int maxId;
+
+protected:
+  /// Drawing state and markers of one thread in thread safe mode
+  struct ThreadBuffer
+  {
+    HectorDrawings* owner;
+    visualization_msgs::Marker tempMarker;          // only used by the owning thread
+
+    boost::mutex mutex;                             // guards the members below
+    std::vector<visualization_msgs::Marker> markers;
+    std::vector<visualization_msgs::Marker> previousMarkers; // drawn before the last reset, not yet collected
+    uint32_t generation;
+    uint32_t nextId;
+    uint32_t endId;
+  };
+
+  enum { ID_BLOCK_SIZE = 256 };
+
+  ThreadBuffer* threadBuffer()
+  {
+    ThreadBuffer* buffer = static_cast<ThreadBuffer*>(pthread_getspecific(bufferKey_));
+    if (buffer) return buffer;
+
+    buffer = new ThreadBuffer();
+    buffer->owner = this;
+    buffer->generation = 0;
+    buffer->nextId = buffer->endId = 0;
+    {
+      boost::mutex::scoped_lock lock(buffersMutex_);
+      buffer->tempMarker = tempMarker;
+      buffers_.push_back(buffer);
+    }
+    pthread_setspecific(bufferKey_, buffer);
+    return buffer;
+  }
+
+  visualization_msgs::Marker& currentMarker()
+  {
+    return threadSafe_ ? threadBuffer()->tempMarker : tempMarker;
+  }
+
+  void pushMarker(visualization_msgs::Marker& marker, bool assignId = true)
+  {
+    if (!threadSafe_){
+      if (assignId) marker.id = idCounter++;
+
+      std::vector<geometry_msgs::Point> points;
+      std::vector<std_msgs::ColorRGBA> colors;
+      points.swap(marker.points);
+      colors.swap(marker.colors);
+
+      markerArray.markers.push_back(marker);
+      markerArray.markers.back().points.swap(points);
+      markerArray.markers.back().colors.swap(colors);
+      return;
+    }
+
+    ThreadBuffer* buffer = threadBuffer();
+
+    // large point lists are swapped into the stored marker instead of copied
+    std::vector<geometry_msgs::Point> points;
+    std::vector<std_msgs::ColorRGBA> colors;
+    points.swap(marker.points);
+    colors.swap(marker.colors);
+
+    boost::mutex::scoped_lock lock(buffer->mutex);
+
+    // stamped on every push, also for markers with explicit ids, so every marker is collected by the
+    // first reset after it was drawn
+    advanceGeneration(*buffer, currentGeneration());
+
+    if (assignId){
+      if (buffer->nextId == buffer->endId){
+        // the upper half of idState_ counts resets, so a block always belongs to one cycle
+        uint64_t state = __sync_fetch_and_add(&idState_, static_cast<uint64_t>(ID_BLOCK_SIZE));
+        advanceGeneration(*buffer, static_cast<uint32_t>(state >> 32));
+
+        buffer->nextId = static_cast<uint32_t>(state);
+        buffer->endId = buffer->nextId + ID_BLOCK_SIZE;
+      }
+      marker.id = buffer->nextId++;
+    }
+
+    buffer->markers.push_back(marker);
+    buffer->markers.back().points.swap(points);
+    buffer->markers.back().colors.swap(colors);
+  }
+
+  // A plain read is enough: a stale value keeps the marker in the cycle collectBuffers() is about to
+  // collect, which still takes it from markers.
+  uint32_t currentGeneration() const
+  {
+    return static_cast<uint32_t>(idState_ >> 32);
+  }
+
+  /// Moves markers of an earlier cycle to previousMarkers, the caller must own the buffer
+  static void advanceGeneration(ThreadBuffer& buffer, uint32_t generation)
+  {
+    if (generation == buffer.generation) return;
+
+    buffer.previousMarkers.insert(buffer.previousMarkers.end(), buffer.markers.begin(), buffer.markers.end());
+    buffer.markers.clear();
+    buffer.generation = generation;
+    buffer.nextId = buffer.endId;                   // the id block belongs to the earlier cycle
+  }
+
+  /// Key destructor, called when a drawing thread exits
+  static void releaseThreadBuffer(void* data)
+  {
+    ThreadBuffer* buffer = static_cast<ThreadBuffer*>(data);
+    buffer->owner->retireBuffer(buffer);
+  }
+
+  /// Hands the markers of an exiting thread to retired_ and frees its buffer
+  void retireBuffer(ThreadBuffer* buffer)
+  {
+    boost::mutex::scoped_lock lock(buffersMutex_);
+    buffers_.erase(std::find(buffers_.begin(), buffers_.end(), buffer));
+
+    uint32_t generation = currentGeneration();
+    {
+      boost::mutex::scoped_lock bufferLock(buffer->mutex);
+      advanceGeneration(*buffer, generation);
+      advanceGeneration(retired_, generation);
+
+      retired_.markers.insert(retired_.markers.end(), buffer->markers.begin(), buffer->markers.end());
+      retired_.previousMarkers.insert(retired_.previousMarkers.end(), buffer->previousMarkers.begin(), buffer->previousMarkers.end());
+    }
+    delete buffer;
+  }
+
+  /// Marker of the given type with the current namespace, time, scale and color at the origin
+  void initBulkMarker(int type, visualization_msgs::Marker& marker)
+  {
+    const visualization_msgs::Marker& style = currentMarker();
+
+    marker.header = style.header;
+    marker.ns = style.ns;
+    marker.type = type;
+    marker.action = visualization_msgs::Marker::ADD;
+    marker.pose.orientation.w = 1.0;
+    marker.color = style.color;
+
+    if (type == visualization_msgs::Marker::TRIANGLE_LIST){
+      marker.scale.x = marker.scale.y = marker.scale.z = 1.0;
+    } else {
+      marker.scale = style.scale;
+    }
+  }
+
+  /// Fills the point and color lists in one pass after a single allocation and pushes the marker
+  void pushBulkMarker(int type, const PointArray& points, const ColorArray* colors)
+  {
+    visualization_msgs::Marker marker;
+    initBulkMarker(type, marker);
+
+    const int n = (type == visualization_msgs::Marker::TRIANGLE_LIST) ? points.cols() - points.cols() % 3 : points.cols();
+    const float* p = points.data();
+
+    marker.points.resize(n);
+    for (int i = 0; i < n; ++i, p += 3){
+      geometry_msgs::Point& point = marker.points[i];
+      point.x = p[0];
+      point.y = p[1];
+      point.z = p[2];
+    }
+
+    if (colors && colors->cols() >= n){
+      const float* c = colors->data();
+
+      marker.colors.resize(n);
+      for (int i = 0; i < n; ++i, c += 4){
+        std_msgs::ColorRGBA& color = marker.colors[i];
+        color.r = c[0];
+        color.g = c[1];
+        color.b = c[2];
+        color.a = c[3];
+      }
+    }
+
+    pushMarker(marker);
+  }
+
+  /// Moves the markers of all thread buffers drawn before this call into markerArray
+  void collectBuffers()
+  {
+    uint64_t state, next;
+    do {
+      state = idState_;
+      next = ((state >> 32) + 1) << 32;
+    } while (!__sync_bool_compare_and_swap(&idState_, state, next));
+
+    uint32_t generation = static_cast<uint32_t>(state >> 32);
+    idCounter = static_cast<int>(static_cast<uint32_t>(state));
+
+    std::vector<visualization_msgs::Marker> collected;
+
+    boost::mutex::scoped_lock lock(buffersMutex_);
+    for (size_t i = 0; i < buffers_.size(); ++i){
+      ThreadBuffer& buffer = *buffers_[i];
+      boost::mutex::scoped_lock bufferLock(buffer.mutex);
+      takeMarkers(buffer, generation, collected);
+      bufferLock.unlock();
+
+      markerArray.markers.insert(markerArray.markers.end(), collected.begin(), collected.end());
+      collected.clear();
+    }
+
+    // retired_ is guarded by buffersMutex_
+    takeMarkers(retired_, generation, collected);
+    markerArray.markers.insert(markerArray.markers.end(), collected.begin(), collected.end());
+  }
+
+  /// Swaps the markers of the given cycle out of the buffer
+  static void takeMarkers(ThreadBuffer& buffer, uint32_t generation, std::vector<visualization_msgs::Marker>& collected)
+  {
+    // markers with ids of the next cycle stay in the buffer
+    std::vector<visualization_msgs::Marker>& done = (buffer.generation == generation) ? buffer.markers : buffer.previousMarkers;
+    collected.swap(done);
+    if (buffer.generation == generation){
+      buffer.nextId = buffer.endId;
+    }
+  }
+
+  bool threadSafe_;
+  pthread_key_t bufferKey_;
+  boost::mutex buffersMutex_;
+  std::vector<ThreadBuffer*> buffers_;
+  ThreadBuffer retired_;                            // markers of exited threads
+  volatile uint64_t idState_;                       // reset count << 32 | next free id
 };
+
+#endif
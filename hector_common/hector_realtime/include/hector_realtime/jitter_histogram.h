@@ -0,0 +1,99 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef hector_realtime_jitter_histogram_h__
+#define hector_realtime_jitter_histogram_h__
+
+#include <string>
+
+#include <stdint.h>
+
+namespace hector_realtime{
+
+/**
+ * Histogram of loop wake-up latencies with power of two buckets in microseconds
+ * (<1, <2, <4, ... us). Recording does not allocate and is safe to call from the hot thread;
+ * reading from another thread gives approximate counts.
+ */
+class JitterHistogram
+{
+public:
+  enum { NUM_BUCKETS = 24 };
+
+  JitterHistogram();
+
+  void reset();
+
+  /// Latency in nanoseconds, negative values (early wake-up) are counted as 0
+  void record(int64_t latency_ns);
+
+  uint64_t getCount() const { return count_; }
+  int64_t getMax() const { return max_; }
+  double getMean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+  /// Upper bound of the bucket containing the given quantile (0..1), in nanoseconds
+  int64_t getPercentile(double quantile) const;
+
+  /// One line summary (count, mean, p99, p99.9, max) followed by the non-empty buckets
+  std::string toString() const;
+
+private:
+  uint64_t buckets_[NUM_BUCKETS];
+  uint64_t count_;
+  int64_t sum_;
+  int64_t max_;
+};
+
+/**
+ * Periodic loop on an absolute monotonic schedule. sleep() waits for the next period and records
+ * how late the thread woke up into the histogram.
+ */
+class PeriodicLoop
+{
+public:
+  explicit PeriodicLoop(double frequency);
+
+  void setFrequency(double frequency);
+
+  /// Returns the wake-up latency in nanoseconds
+  int64_t sleep();
+
+  JitterHistogram& getHistogram() { return histogram_; }
+
+private:
+  int64_t period_ns_;
+  int64_t next_ns_;
+  JitterHistogram histogram_;
+};
+
+int64_t getMonotonicTime();
+
+}
+
+#endif
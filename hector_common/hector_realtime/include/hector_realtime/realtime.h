@@ -0,0 +1,69 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef hector_realtime_realtime_h__
+#define hector_realtime_realtime_h__
+
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+
+namespace hector_realtime{
+
+struct RealtimeConfig
+{
+  RealtimeConfig()
+    : enabled(false)
+    , priority(80)
+    , prefault_stack_size(512 * 1024)
+    , prefault_heap_size(64 * 1024 * 1024)
+  {}
+
+  bool enabled;
+  int priority;               // SCHED_FIFO priority of the hot thread, 1 - 99
+  std::vector<int> cpus;      // affinity of the hot thread, empty for no restriction
+  size_t prefault_stack_size;
+  size_t prefault_heap_size;
+};
+
+/**
+ * Locks all current and future pages into memory and prefaults stack and heap, so the hot path
+ * does not take page faults. Heap trimming and mmap based allocation are disabled, freed memory
+ * stays with the process. Returns false and sets error if a step fails (usually missing
+ * CAP_IPC_LOCK / rtprio limits); the remaining steps are still applied.
+ */
+bool configureProcess(const RealtimeConfig& config, std::string& error);
+
+/// Sets CPU affinity and SCHED_FIFO priority of the calling thread.
+bool configureThread(const RealtimeConfig& config, std::string& error);
+
+}
+
+#endif
@@ -0,0 +1,94 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef hector_realtime_ros_realtime_h__
+#define hector_realtime_ros_realtime_h__
+
+#include <hector_realtime/realtime.h>
+#include <hector_realtime/jitter_histogram.h>
+
+#include <ros/ros.h>
+
+namespace hector_realtime{
+
+/**
+ * Reads the real-time parameters of a node:
+ * ~realtime (bool, default false), ~realtime_priority (int, default 80),
+ * ~realtime_cpus (list of cpu indices, default none), ~prefault_heap_mb (int, default 64)
+ */
+inline void loadConfig(const ros::NodeHandle& pnh, RealtimeConfig& config)
+{
+  pnh.param("realtime", config.enabled, false);
+  pnh.param("realtime_priority", config.priority, 80);
+
+  int prefault_heap_mb;
+  pnh.param("prefault_heap_mb", prefault_heap_mb, 64);
+  config.prefault_heap_size = static_cast<size_t>(prefault_heap_mb) * 1024 * 1024;
+
+  config.cpus.clear();
+  XmlRpc::XmlRpcValue cpus;
+
+  if (pnh.getParam("realtime_cpus", cpus) && cpus.getType() == XmlRpc::XmlRpcValue::TypeArray){
+    for (int i = 0; i < cpus.size(); ++i){
+      if (cpus[i].getType() == XmlRpc::XmlRpcValue::TypeInt){
+        config.cpus.push_back(static_cast<int>(cpus[i]));
+      }
+    }
+  }
+}
+
+/// Applies process and thread settings if enabled, logging failures. Call from the hot thread.
+inline bool applyConfig(const RealtimeConfig& config)
+{
+  if (!config.enabled){
+    return false;
+  }
+
+  std::string error;
+  bool ok = true;
+
+  if (!configureProcess(config, error)){
+    ROS_WARN("Real-time process setup incomplete: %s", error.c_str());
+    ok = false;
+  }
+
+  if (!configureThread(config, error)){
+    ROS_WARN("Real-time thread setup incomplete: %s", error.c_str());
+    ok = false;
+  }
+
+  if (ok){
+    ROS_INFO("Real-time mode: SCHED_FIFO priority %d, %d cpus, memory locked", config.priority, static_cast<int>(config.cpus.size()));
+  }
+  return ok;
+}
+
+}
+
+#endif
@@ -0,0 +1,152 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <hector_realtime/jitter_histogram.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <sstream>
+
+#include <time.h>
+
+namespace hector_realtime{
+
+JitterHistogram::JitterHistogram()
+{
+  reset();
+}
+
+void JitterHistogram::reset()
+{
+  for (int i = 0; i < NUM_BUCKETS; ++i){
+    buckets_[i] = 0;
+  }
+  count_ = 0;
+  sum_ = 0;
+  max_ = 0;
+}
+
+void JitterHistogram::record(int64_t latency_ns)
+{
+  if (latency_ns < 0){
+    latency_ns = 0;
+  }
+
+  // bucket b holds latencies below 2^b us
+  uint64_t latency_us = static_cast<uint64_t>(latency_ns / 1000);
+  int bucket = 0;
+  while (latency_us > 0 && bucket < NUM_BUCKETS - 1){
+    latency_us >>= 1;
+    ++bucket;
+  }
+
+  ++buckets_[bucket];
+  ++count_;
+  sum_ += latency_ns;
+  if (latency_ns > max_){
+    max_ = latency_ns;
+  }
+}
+
+int64_t JitterHistogram::getPercentile(double quantile) const
+{
+  uint64_t target = static_cast<uint64_t>(quantile * count_);
+  uint64_t accumulated = 0;
+
+  for (int i = 0; i < NUM_BUCKETS; ++i){
+    accumulated += buckets_[i];
+    if (accumulated > target){
+      return (static_cast<int64_t>(1) << i) * 1000;
+    }
+  }
+
+  return max_;
+}
+
+std::string JitterHistogram::toString() const
+{
+  std::ostringstream stream;
+  stream << "count " << count_ << ", mean " << getMean() * 1e-3 << " us, p99 < " << getPercentile(0.99) / 1000
+         << " us, p99.9 < " << getPercentile(0.999) / 1000 << " us, max " << max_ * 1e-3 << " us";
+
+  for (int i = 0; i < NUM_BUCKETS; ++i){
+    if (buckets_[i]){
+      stream << "\n  < " << (static_cast<int64_t>(1) << i) << " us: " << buckets_[i];
+    }
+  }
+
+  return stream.str();
+}
+
+int64_t getMonotonicTime()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000ll + ts.tv_nsec;
+}
+
+PeriodicLoop::PeriodicLoop(double frequency)
+  : next_ns_(0)
+{
+  setFrequency(frequency);
+}
+
+void PeriodicLoop::setFrequency(double frequency)
+{
+  period_ns_ = static_cast<int64_t>(1e9 / frequency);
+  next_ns_ = 0;
+}
+
+int64_t PeriodicLoop::sleep()
+{
+  int64_t now = getMonotonicTime();
+
+  if (next_ns_ == 0){
+    next_ns_ = now;
+  }
+
+  next_ns_ += period_ns_;
+
+  // if we fell behind by more than a period, restart the schedule instead of bursting
+  if (next_ns_ < now){
+    next_ns_ = now + period_ns_;
+  }
+
+  struct timespec wakeup;
+  wakeup.tv_sec = next_ns_ / 1000000000ll;
+  wakeup.tv_nsec = next_ns_ % 1000000000ll;
+
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, 0) == EINTR){}
+
+  int64_t latency = getMonotonicTime() - next_ns_;
+  histogram_.record(latency);
+  return latency;
+}
+
+}
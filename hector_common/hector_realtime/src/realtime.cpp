@@ -0,0 +1,137 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <hector_realtime/realtime.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace hector_realtime{
+
+static void appendError(std::string& error, const std::string& step)
+{
+  if (!error.empty()){
+    error += "; ";
+  }
+  error += step + ": " + strerror(errno);
+}
+
+// touch every page of a stack area of the given size, so later growth of the stack does not fault
+static void __attribute__((noinline)) prefaultStack(size_t size)
+{
+  unsigned char* buffer = static_cast<unsigned char*>(alloca(size));
+  long page_size = sysconf(_SC_PAGESIZE);
+
+  for (size_t i = 0; i < size; i += page_size){
+    *static_cast<volatile unsigned char*>(buffer + i) = 0;
+  }
+}
+
+bool configureProcess(const RealtimeConfig& config, std::string& error)
+{
+  error.clear();
+
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0){
+    appendError(error, "mlockall");
+  }
+
+  // keep freed memory in the process and serve all allocations from the (locked) heap
+  mallopt(M_TRIM_THRESHOLD, -1);
+  mallopt(M_MMAP_MAX, 0);
+
+  if (config.prefault_heap_size > 0){
+    unsigned char* heap = static_cast<unsigned char*>(malloc(config.prefault_heap_size));
+
+    if (heap){
+      long page_size = sysconf(_SC_PAGESIZE);
+      for (size_t i = 0; i < config.prefault_heap_size; i += page_size){
+        heap[i] = 0;
+      }
+      free(heap);
+    }else{
+      appendError(error, "heap prefault");
+    }
+  }
+
+  if (config.prefault_stack_size > 0){
+    prefaultStack(config.prefault_stack_size);
+  }
+
+  return error.empty();
+}
+
+bool configureThread(const RealtimeConfig& config, std::string& error)
+{
+  error.clear();
+
+  if (!config.cpus.empty()){
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+
+    for (size_t i = 0; i < config.cpus.size(); ++i){
+      CPU_SET(config.cpus[i], &cpu_set);
+    }
+
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    if (result != 0){
+      errno = result;
+      appendError(error, "pthread_setaffinity_np");
+    }
+  }
+
+  if (config.priority > 0){
+    struct sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    param.sched_priority = config.priority;
+
+    int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (result != 0){
+      errno = result;
+      std::ostringstream step;
+      step << "SCHED_FIFO priority " << config.priority;
+      appendError(error, step.str());
+    }
+  }
+
+  if (config.prefault_stack_size > 0){
+    prefaultStack(config.prefault_stack_size);
+  }
+
+  return error.empty();
+}
+
+}
@@ -0,0 +1,97 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+
+#ifndef hector_scan_codec_scan_codec_h__
+#define hector_scan_codec_scan_codec_h__
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace hector_scan_codec{
+
+/**
+ * Lossless compression of laser scan ranges and intensities.
+ *
+ * Ranges are converted to the millimetre integers the scanner reports (a float is only accepted if
+ * it decodes to exactly the same float again), intensities to integers. Every value is predicted
+ * from the previous beam and the same beams of the previous scan with the median edge detector of
+ * LOCO-I, and the residuals are written with adaptive Golomb-Rice codes. Values that are not integral
+ * (NaN, inf, filtered or interpolated ranges) are stored verbatim as escapes.
+ *
+ * Key frames use the previous beam only, so decoding can start at any key frame.
+ */
+class ScanEncoder
+{
+public:
+  ScanEncoder();
+
+  /// The next scan is encoded as key frame
+  void reset();
+
+  /**
+   * Encodes one scan. intensities may be empty. A key frame is written if requested, for the first
+   * scan and whenever the number of beams changes; the return value tells whether it was one.
+   */
+  bool encode(const std::vector<float>& ranges, const std::vector<float>& intensities, bool key_frame, std::vector<uint8_t>& data);
+
+private:
+  std::vector<int32_t> previous_ranges_;
+  std::vector<int32_t> previous_intensities_;
+  std::vector<int32_t> current_ranges_;
+  std::vector<int32_t> current_intensities_;
+};
+
+class ScanDecoder
+{
+public:
+  ScanDecoder();
+
+  void reset();
+
+  /// A delta frame can only be decoded directly after the scan it was encoded against
+  bool hasReference(size_t num_ranges, bool has_intensities) const;
+
+  /**
+   * Decodes a scan written by ScanEncoder::encode. Returns false for corrupt data or a delta frame
+   * without reference; the decoder then waits for the next key frame.
+   */
+  bool decode(const std::vector<uint8_t>& data, size_t num_ranges, bool has_intensities, bool key_frame,
+              std::vector<float>& ranges, std::vector<float>& intensities);
+
+private:
+  std::vector<int32_t> previous_ranges_;
+  std::vector<int32_t> previous_intensities_;
+  bool has_reference_;
+};
+
+}
+
+#endif
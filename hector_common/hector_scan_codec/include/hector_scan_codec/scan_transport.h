@@ -0,0 +1,134 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+
+#ifndef hector_scan_codec_scan_transport_h__
+#define hector_scan_codec_scan_transport_h__
+
+#include <hector_scan_codec/scan_codec.h>
+#include <hector_scan_codec/CompressedLaserScan.h>
+
+#include <ros/ros.h>
+#include <sensor_msgs/LaserScan.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace hector_scan_codec{
+
+/// Conversion between LaserScan and CompressedLaserScan, keeping the prediction state of one stream
+class ScanCompressor
+{
+public:
+  ScanCompressor(unsigned int key_frame_interval = 40);
+
+  void compress(const sensor_msgs::LaserScan& scan, CompressedLaserScan& compressed);
+
+  void reset();
+
+private:
+  ScanEncoder encoder_;
+  unsigned int key_frame_interval_;
+  unsigned int sequence_;
+  unsigned int since_key_frame_;
+};
+
+class ScanDecompressor
+{
+public:
+  ScanDecompressor();
+
+  /// Returns false if the scan cannot be decoded (missing reference after a lost message or corrupt data)
+  bool decompress(const CompressedLaserScan& compressed, sensor_msgs::LaserScan& scan);
+
+  void reset();
+
+private:
+  ScanDecoder decoder_;
+  uint32_t next_sequence_;
+};
+
+/**
+ * Publishes a scan topic both raw and compressed on <topic>/compressed. Each variant is only
+ * encoded and sent while it has subscribers.
+ */
+class ScanPublisher : boost::noncopyable
+{
+public:
+  ScanPublisher();
+  ScanPublisher(ros::NodeHandle& nh, const std::string& topic, uint32_t queue_size, unsigned int key_frame_interval = 40);
+
+  void advertise(ros::NodeHandle& nh, const std::string& topic, uint32_t queue_size, unsigned int key_frame_interval = 40);
+  void publish(const sensor_msgs::LaserScan& scan);
+  void shutdown();
+
+  uint32_t getNumSubscribers() const;
+
+private:
+  ros::Publisher raw_pub_;
+  ros::Publisher compressed_pub_;
+  ScanCompressor compressor_;
+  CompressedLaserScan compressed_;
+  uint32_t compressed_subscribers_;   // a key frame is sent when a subscriber connects
+};
+
+/**
+ * Subscribes to a scan topic, either raw or <topic>/compressed, and always calls the callback with
+ * a sensor_msgs::LaserScan. The transport is "raw" or "compressed"; the default is taken from the
+ * private parameter ~scan_transport.
+ */
+class ScanSubscriber : boost::noncopyable
+{
+public:
+  typedef boost::function<void(const sensor_msgs::LaserScan::ConstPtr&)> Callback;
+
+  ScanSubscriber();
+  ScanSubscriber(ros::NodeHandle& nh, const std::string& topic, uint32_t queue_size, const Callback& callback,
+                 const std::string& transport = std::string());
+
+  void subscribe(ros::NodeHandle& nh, const std::string& topic, uint32_t queue_size, const Callback& callback,
+                 const std::string& transport = std::string());
+  void shutdown();
+
+  uint32_t getNumPublishers() const { return subscriber_.getNumPublishers(); }
+  /// Compressed scans that could not be decoded
+  unsigned int getNumDropped() const { return dropped_; }
+
+private:
+  void compressedCallback(const CompressedLaserScanConstPtr& compressed);
+
+  ros::Subscriber subscriber_;
+  Callback callback_;
+  ScanDecompressor decompressor_;
+  unsigned int dropped_;
+};
+
+}
+
+#endif
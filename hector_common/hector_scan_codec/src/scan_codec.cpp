@@ -0,0 +1,347 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+
+#include <hector_scan_codec/scan_codec.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace hector_scan_codec{
+
+namespace {
+
+const unsigned int UNARY_LIMIT = 24;
+
+class BitWriter
+{
+public:
+  BitWriter(std::vector<uint8_t>& data)
+    : data_(data), buffer_(0), bits_(0)
+  {
+    data_.clear();
+  }
+
+  void write(uint32_t value, unsigned int bits)
+  {
+    if (bits == 0) return;
+    buffer_ = (buffer_ << bits) | (value & (bits == 32 ? 0xffffffffu : ((1u << bits) - 1)));
+    bits_ += bits;
+    while (bits_ >= 8){
+      bits_ -= 8;
+      data_.push_back(static_cast<uint8_t>(buffer_ >> bits_));
+    }
+  }
+
+  void flush()
+  {
+    if (bits_ > 0){
+      data_.push_back(static_cast<uint8_t>(buffer_ << (8 - bits_)));
+      bits_ = 0;
+    }
+  }
+
+private:
+  std::vector<uint8_t>& data_;
+  uint64_t buffer_;
+  unsigned int bits_;
+};
+
+class BitReader
+{
+public:
+  BitReader(const std::vector<uint8_t>& data)
+    : data_(data), position_(0), buffer_(0), bits_(0), error_(false)
+  {}
+
+  uint32_t read(unsigned int bits)
+  {
+    if (bits == 0) return 0;
+    while (bits_ < bits){
+      if (position_ >= data_.size()){
+        error_ = true;
+        return 0;
+      }
+      buffer_ = (buffer_ << 8) | data_[position_++];
+      bits_ += 8;
+    }
+    bits_ -= bits;
+    return static_cast<uint32_t>(buffer_ >> bits_) & (bits == 32 ? 0xffffffffu : ((1u << bits) - 1));
+  }
+
+  bool error() const { return error_; }
+
+private:
+  const std::vector<uint8_t>& data_;
+  size_t position_;
+  uint64_t buffer_;
+  unsigned int bits_;
+  bool error_;
+};
+
+/// Golomb-Rice code with the parameter adapted to the running mean, as in LOCO-I
+class RiceCoder
+{
+public:
+  RiceCoder()
+    : sum_(8), count_(1)
+  {}
+
+  unsigned int parameter() const
+  {
+    unsigned int k = 0;
+    while ((count_ << k) < sum_ && k < 30) ++k;
+    return k;
+  }
+
+  void update(uint32_t value)
+  {
+    sum_ += value;
+    if (++count_ >= 64){
+      sum_ >>= 1;
+      count_ >>= 1;
+    }
+  }
+
+  void write(BitWriter& writer, uint32_t value)
+  {
+    unsigned int k = parameter();
+    uint32_t quotient = value >> k;
+
+    if (quotient < UNARY_LIMIT){
+      for (uint32_t i = 0; i < quotient; ++i) writer.write(1, 1);
+      writer.write(0, 1);
+      writer.write(value, k);
+    }else{
+      for (unsigned int i = 0; i < UNARY_LIMIT; ++i) writer.write(1, 1);
+      writer.write(value, 32);
+    }
+    update(value);
+  }
+
+  uint32_t read(BitReader& reader)
+  {
+    unsigned int k = parameter();
+    uint32_t quotient = 0;
+    while (quotient < UNARY_LIMIT && reader.read(1) && !reader.error()) ++quotient;
+
+    uint32_t value = quotient < UNARY_LIMIT ? (quotient << k) | reader.read(k) : reader.read(32);
+    update(value);
+    return value;
+  }
+
+private:
+  uint32_t sum_;
+  uint32_t count_;
+};
+
+inline uint32_t zigzag(int32_t value) { return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31); }
+inline int32_t unzigzag(uint32_t value) { return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1); }
+
+// prediction and residuals wrap around modulo 2^32, so neither large values nor corrupt residuals
+// overflow a signed integer; the decoder undoes the wrap-around of the encoder exactly
+inline int32_t wrappingAdd(int32_t a, int32_t b) { return static_cast<int32_t>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b)); }
+inline int32_t wrappingSub(int32_t a, int32_t b) { return static_cast<int32_t>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b)); }
+
+inline uint32_t floatBits(float value) { uint32_t bits; memcpy(&bits, &value, sizeof(bits)); return bits; }
+inline float bitsFloat(uint32_t bits) { float value; memcpy(&value, &bits, sizeof(value)); return value; }
+
+/// Integer representation of a range (millimetres) or intensity, false if it is not exact
+inline bool toInteger(float value, int scale, int32_t& integer)
+{
+  if (!(std::fabs(value) < 2.0e6f)) return false;
+
+  double scaled = std::floor(static_cast<double>(value) * scale + 0.5);
+  integer = static_cast<int32_t>(scaled);
+  return floatBits(static_cast<float>(static_cast<double>(integer) / scale)) == floatBits(value);
+}
+
+inline float fromInteger(int32_t integer, int scale)
+{
+  return static_cast<float>(static_cast<double>(integer) / scale);
+}
+
+/// Median edge detector: previous beam a, same beam b and previous beam c of the previous scan
+inline int32_t predict(const int32_t* current, const int32_t* previous, size_t i)
+{
+  if (!previous) return i ? current[i - 1] : 0;
+  if (i == 0) return previous[0];
+
+  int32_t a = current[i - 1], b = previous[i], c = previous[i - 1];
+  if (c >= std::max(a, b)) return std::min(a, b);
+  if (c <= std::min(a, b)) return std::max(a, b);
+  return wrappingSub(wrappingAdd(a, b), c);
+}
+
+void encodeChannel(BitWriter& writer, const std::vector<float>& values, int scale, const std::vector<int32_t>* previous,
+                   std::vector<int32_t>& current, std::vector<uint32_t>& escapes)
+{
+  const size_t n = values.size();
+  current.resize(n);
+  escapes.clear();
+
+  int32_t* cur = n ? &current[0] : 0;
+  const int32_t* prev = previous && n ? &(*previous)[0] : 0;
+
+  // escaped values take the prediction as their integer value, so they cost nothing in the residuals
+  std::vector<int32_t> residuals(n);
+  size_t num_residuals = 0;
+  for (size_t i = 0; i < n; ++i){
+    int32_t pred = predict(cur, prev, i);
+    int32_t integer;
+    if (toInteger(values[i], scale, integer)){
+      cur[i] = integer;
+      residuals[num_residuals++] = wrappingSub(integer, pred);
+    }else{
+      cur[i] = pred;
+      escapes.push_back(i);
+    }
+  }
+
+  RiceCoder escape_coder;
+  escape_coder.write(writer, escapes.size());
+  for (size_t i = 0; i < escapes.size(); ++i){
+    escape_coder.write(writer, i ? escapes[i] - escapes[i - 1] - 1 : escapes[0]);
+  }
+
+  RiceCoder residual_coder;
+  for (size_t i = 0; i < num_residuals; ++i){
+    residual_coder.write(writer, zigzag(residuals[i]));
+  }
+
+  for (size_t i = 0; i < escapes.size(); ++i){
+    writer.write(floatBits(values[escapes[i]]), 32);
+  }
+}
+
+bool decodeChannel(BitReader& reader, size_t n, int scale, const std::vector<int32_t>* previous,
+                   std::vector<int32_t>& current, std::vector<float>& values)
+{
+  current.resize(n);
+  values.resize(n);
+
+  RiceCoder escape_coder;
+  uint32_t num_escapes = escape_coder.read(reader);
+  if (reader.error() || num_escapes > n) return false;
+
+  std::vector<bool> escaped(n, false);
+  std::vector<uint32_t> escapes(num_escapes);
+  for (uint32_t i = 0, index = 0; i < num_escapes; ++i){
+    index += escape_coder.read(reader) + (i ? 1 : 0);
+    if (reader.error() || index >= n) return false;
+    escaped[index] = true;
+    escapes[i] = index;
+  }
+
+  int32_t* cur = n ? &current[0] : 0;
+  const int32_t* prev = previous && n ? &(*previous)[0] : 0;
+
+  RiceCoder residual_coder;
+  for (size_t i = 0; i < n; ++i){
+    int32_t pred = predict(cur, prev, i);
+    cur[i] = escaped[i] ? pred : wrappingAdd(pred, unzigzag(residual_coder.read(reader)));
+    values[i] = fromInteger(cur[i], scale);
+  }
+
+  for (uint32_t i = 0; i < num_escapes; ++i){
+    values[escapes[i]] = bitsFloat(reader.read(32));
+  }
+
+  return !reader.error();
+}
+
+}
+
+ScanEncoder::ScanEncoder()
+{
+}
+
+void ScanEncoder::reset()
+{
+  previous_ranges_.clear();
+  previous_intensities_.clear();
+}
+
+bool ScanEncoder::encode(const std::vector<float>& ranges, const std::vector<float>& intensities, bool key_frame, std::vector<uint8_t>& data)
+{
+  key_frame = key_frame || ranges.empty() || previous_ranges_.size() != ranges.size() ||
+              previous_intensities_.size() != intensities.size();
+
+  BitWriter writer(data);
+  std::vector<uint32_t> escapes;
+
+  encodeChannel(writer, ranges, 1000, key_frame ? 0 : &previous_ranges_, current_ranges_, escapes);
+  encodeChannel(writer, intensities, 1, key_frame ? 0 : &previous_intensities_, current_intensities_, escapes);
+  writer.flush();
+
+  previous_ranges_.swap(current_ranges_);
+  previous_intensities_.swap(current_intensities_);
+  return key_frame;
+}
+
+ScanDecoder::ScanDecoder()
+  : has_reference_(false)
+{
+}
+
+void ScanDecoder::reset()
+{
+  has_reference_ = false;
+}
+
+bool ScanDecoder::hasReference(size_t num_ranges, bool has_intensities) const
+{
+  return has_reference_ && previous_ranges_.size() == num_ranges &&
+         previous_intensities_.size() == (has_intensities ? num_ranges : 0);
+}
+
+bool ScanDecoder::decode(const std::vector<uint8_t>& data, size_t num_ranges, bool has_intensities, bool key_frame,
+                         std::vector<float>& ranges, std::vector<float>& intensities)
+{
+  if (!key_frame && !hasReference(num_ranges, has_intensities)) return false;
+
+  // every value takes at least one bit, so a corrupt num_ranges cannot make the output huge
+  if ((has_intensities ? 2 : 1) * static_cast<uint64_t>(num_ranges) > data.size() * static_cast<uint64_t>(8)) return false;
+
+  BitReader reader(data);
+  std::vector<int32_t> current_ranges, current_intensities;
+
+  has_reference_ =
+      decodeChannel(reader, num_ranges, 1000, key_frame ? 0 : &previous_ranges_, current_ranges, ranges) &&
+      decodeChannel(reader, has_intensities ? num_ranges : 0, 1, key_frame ? 0 : &previous_intensities_, current_intensities, intensities);
+
+  if (has_reference_){
+    previous_ranges_.swap(current_ranges);
+    previous_intensities_.swap(current_intensities);
+  }
+  return has_reference_;
+}
+
+}
@@ -0,0 +1,90 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+
+#include <hector_scan_codec/scan_transport.h>
+
+/**
+ * Compresses scan to scan/compressed (~mode compress, default) or decompresses scan/compressed to
+ * scan (~mode decompress), e.g. to record compressed scans from a driver that publishes raw scans
+ * only, or to play them back to nodes that subscribe to raw scans.
+ */
+class ScanCodecRelay
+{
+public:
+  ScanCodecRelay()
+  {
+    ros::NodeHandle nh;
+    ros::NodeHandle pnh("~");
+
+    std::string mode;
+    int key_frame_interval;
+    pnh.param("mode", mode, std::string("compress"));
+    pnh.param("key_frame_interval", key_frame_interval, 40);
+
+    if (mode == "decompress"){
+      scan_pub_ = nh.advertise<sensor_msgs::LaserScan>("scan", 5);
+      scan_sub_.subscribe(nh, "scan", 5, boost::bind(&ScanCodecRelay::decompressedCallback, this, _1), "compressed");
+    }else{
+      compressed_pub_ = nh.advertise<hector_scan_codec::CompressedLaserScan>("scan/compressed", 5);
+      compressor_ = hector_scan_codec::ScanCompressor(key_frame_interval);
+      scan_sub_.subscribe(nh, "scan", 5, boost::bind(&ScanCodecRelay::scanCallback, this, _1), "raw");
+    }
+  }
+
+  void scanCallback(const sensor_msgs::LaserScan::ConstPtr& scan)
+  {
+    compressor_.compress(*scan, compressed_);
+    compressed_pub_.publish(compressed_);
+  }
+
+  void decompressedCallback(const sensor_msgs::LaserScan::ConstPtr& scan)
+  {
+    scan_pub_.publish(scan);
+  }
+
+protected:
+  hector_scan_codec::ScanSubscriber scan_sub_;
+  ros::Publisher scan_pub_;
+  ros::Publisher compressed_pub_;
+
+  hector_scan_codec::ScanCompressor compressor_;
+  hector_scan_codec::CompressedLaserScan compressed_;
+};
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "scan_codec_relay");
+
+  ScanCodecRelay relay;
+
+  ros::spin();
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+
+#include <hector_scan_codec/scan_transport.h>
+
+namespace hector_scan_codec{
+
+ScanCompressor::ScanCompressor(unsigned int key_frame_interval)
+  : key_frame_interval_(key_frame_interval)
+  , sequence_(0)
+  , since_key_frame_(0)
+{
+}
+
+void ScanCompressor::reset()
+{
+  encoder_.reset();
+}
+
+void ScanCompressor::compress(const sensor_msgs::LaserScan& scan, CompressedLaserScan& compressed)
+{
+  compressed.header = scan.header;
+  compressed.angle_min = scan.angle_min;
+  compressed.angle_max = scan.angle_max;
+  compressed.angle_increment = scan.angle_increment;
+  compressed.time_increment = scan.time_increment;
+  compressed.scan_time = scan.scan_time;
+  compressed.range_min = scan.range_min;
+  compressed.range_max = scan.range_max;
+
+  // intensities are only kept if there is one per range
+  compressed.num_ranges = scan.ranges.size();
+  compressed.has_intensities = !scan.intensities.empty() && scan.intensities.size() == scan.ranges.size();
+
+  static const std::vector<float> no_intensities;
+  bool key_frame = key_frame_interval_ == 0 || since_key_frame_ + 1 >= key_frame_interval_;
+  compressed.key_frame = encoder_.encode(scan.ranges, compressed.has_intensities ? scan.intensities : no_intensities,
+                                         key_frame, compressed.data);
+  compressed.sequence = sequence_++;
+  since_key_frame_ = compressed.key_frame ? 0 : since_key_frame_ + 1;
+}
+
+ScanDecompressor::ScanDecompressor()
+  : next_sequence_(0)
+{
+}
+
+void ScanDecompressor::reset()
+{
+  decoder_.reset();
+}
+
+bool ScanDecompressor::decompress(const CompressedLaserScan& compressed, sensor_msgs::LaserScan& scan)
+{
+  if (!compressed.key_frame && compressed.sequence != next_sequence_){
+    decoder_.reset();
+  }
+  next_sequence_ = compressed.sequence + 1;
+
+  if (!decoder_.decode(compressed.data, compressed.num_ranges, compressed.has_intensities, compressed.key_frame,
+                       scan.ranges, scan.intensities)){
+    return false;
+  }
+
+  scan.header = compressed.header;
+  scan.angle_min = compressed.angle_min;
+  scan.angle_max = compressed.angle_max;
+  scan.angle_increment = compressed.angle_increment;
+  scan.time_increment = compressed.time_increment;
+  scan.scan_time = compressed.scan_time;
+  scan.range_min = compressed.range_min;
+  scan.range_max = compressed.range_max;
+  return true;
+}
+
+ScanPublisher::ScanPublisher()
+  : compressed_subscribers_(0)
+{
+}
+
+ScanPublisher::ScanPublisher(ros::NodeHandle& nh, const std::string& topic, uint32_t queue_size, unsigned int key_frame_interval)
+  : compressed_subscribers_(0)
+{
+  advertise(nh, topic, queue_size, key_frame_interval);
+}
+
+void ScanPublisher::advertise(ros::NodeHandle& nh, const std::string& topic, uint32_t queue_size, unsigned int key_frame_interval)
+{
+  raw_pub_ = nh.advertise<sensor_msgs::LaserScan>(topic, queue_size);
+  compressed_pub_ = nh.advertise<CompressedLaserScan>(topic + "/compressed", queue_size);
+  compressor_ = ScanCompressor(key_frame_interval);
+  compressed_subscribers_ = 0;
+}
+
+void ScanPublisher::publish(const sensor_msgs::LaserScan& scan)
+{
+  if (raw_pub_.getNumSubscribers() > 0){
+    raw_pub_.publish(scan);
+  }
+
+  uint32_t compressed_subscribers = compressed_pub_.getNumSubscribers();
+  if (compressed_subscribers > compressed_subscribers_){
+    compressor_.reset();
+  }
+  compressed_subscribers_ = compressed_subscribers;
+
+  if (compressed_subscribers > 0){
+    compressor_.compress(scan, compressed_);
+    compressed_pub_.publish(compressed_);
+  }
+}
+
+void ScanPublisher::shutdown()
+{
+  raw_pub_.shutdown();
+  compressed_pub_.shutdown();
+}
+
+uint32_t ScanPublisher::getNumSubscribers() const
+{
+  return raw_pub_.getNumSubscribers() + compressed_pub_.getNumSubscribers();
+}
+
+ScanSubscriber::ScanSubscriber()
+  : dropped_(0)
+{
+}
+
+ScanSubscriber::ScanSubscriber(ros::NodeHandle& nh, const std::string& topic, uint32_t queue_size, const Callback& callback,
+                               const std::string& transport)
+  : dropped_(0)
+{
+  subscribe(nh, topic, queue_size, callback, transport);
+}
+
+void ScanSubscriber::subscribe(ros::NodeHandle& nh, const std::string& topic, uint32_t queue_size, const Callback& callback,
+                               const std::string& transport)
+{
+  std::string scan_transport = transport;
+  if (scan_transport.empty()){
+    ros::NodeHandle("~").param("scan_transport", scan_transport, std::string("raw"));
+  }
+
+  callback_ = callback;
+  decompressor_.reset();
+
+  if (scan_transport == "compressed"){
+    subscriber_ = nh.subscribe(topic + "/compressed", queue_size, &ScanSubscriber::compressedCallback, this);
+  }else{
+    if (scan_transport != "raw"){
+      ROS_WARN("Unknown scan transport %s, using raw", scan_transport.c_str());
+    }
+    subscriber_ = nh.subscribe<sensor_msgs::LaserScan>(topic, queue_size, callback_);
+  }
+}
+
+void ScanSubscriber::shutdown()
+{
+  subscriber_.shutdown();
+}
+
+void ScanSubscriber::compressedCallback(const CompressedLaserScanConstPtr& compressed)
+{
+  sensor_msgs::LaserScan::Ptr scan(new sensor_msgs::LaserScan);
+
+  if (!decompressor_.decompress(*compressed, *scan)){
+    ++dropped_;
+    ROS_DEBUG("Waiting for a key frame on %s", subscriber_.getTopic().c_str());
+    return;
+  }
+
+  callback_(scan);
+}
+
+}
@@ -0,0 +1,254 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+
+#ifndef hector_std_msgs_chunk_h__
+#define hector_std_msgs_chunk_h__
+
+#include <hector_std_msgs/Float32.h>
+#include <hector_std_msgs/Float32Chunk.h>
+#include <hector_std_msgs/Float64.h>
+#include <hector_std_msgs/Float64Chunk.h>
+#include <hector_std_msgs/UInt16.h>
+#include <hector_std_msgs/UInt16Chunk.h>
+
+#include <ros/ros.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <limits>
+
+namespace hector_std_msgs{
+
+/**
+ * Maps a chunk message to the stamped message of a single sample and its value type.
+ */
+template <class ChunkT> struct ChunkTraits;
+
+template <> struct ChunkTraits<Float32Chunk>{ typedef Float32 Sample; typedef float Value; };
+template <> struct ChunkTraits<Float64Chunk>{ typedef Float64 Sample; typedef double Value; };
+template <> struct ChunkTraits<UInt16Chunk>{ typedef UInt16 Sample; typedef uint16_t Value; };
+
+/**
+ * Collects samples of a scalar time series and publishes them as chunk messages.
+ *
+ * A chunk is published when it holds max_samples samples, when its first sample is older than
+ * max_latency, or when a sample does not fit the int32 nanosecond offset to the base stamp. The
+ * latency is also checked by a timer of the given node handle, so the node must spin.
+ *
+ *   hector_std_msgs::ChunkPublisher<hector_std_msgs::Float32Chunk> temperature(nh, "temperature", 50, ros::Duration(0.2));
+ *   temperature.publish(stamp, value);
+ */
+template <class ChunkT>
+class ChunkPublisher : boost::noncopyable
+{
+public:
+  typedef typename ChunkTraits<ChunkT>::Sample Sample;
+  typedef typename ChunkTraits<ChunkT>::Value Value;
+
+  ChunkPublisher()
+    : max_samples_(100)
+  {}
+
+  ChunkPublisher(ros::NodeHandle& nh, const std::string& topic, unsigned int max_samples = 100,
+                 const ros::Duration& max_latency = ros::Duration(0.1), uint32_t queue_size = 10)
+    : max_samples_(100)
+  {
+    advertise(nh, topic, max_samples, max_latency, queue_size);
+  }
+
+  ~ChunkPublisher()
+  {
+    shutdown();
+  }
+
+  void advertise(ros::NodeHandle& nh, const std::string& topic, unsigned int max_samples = 100,
+                 const ros::Duration& max_latency = ros::Duration(0.1), uint32_t queue_size = 10)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    max_samples_ = max_samples > 0 ? max_samples : 1;
+    max_latency_ = max_latency;
+    chunk_.dt.reserve(max_samples_);
+    chunk_.data.reserve(max_samples_);
+
+    publisher_ = nh.advertise<ChunkT>(topic, queue_size);
+    if (max_latency_ > ros::Duration(0.0)){
+      timer_ = nh.createTimer(max_latency_ * 0.25, &ChunkPublisher::timerCallback, this);
+    }
+  }
+
+  /// Publishes the pending samples and stops the publisher
+  void shutdown()
+  {
+    flush();
+    timer_.stop();
+    publisher_.shutdown();
+  }
+
+  void setFrameId(const std::string& frame_id)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (frame_id != chunk_.header.frame_id){
+      publishChunk();
+      chunk_.header.frame_id = frame_id;
+    }
+  }
+
+  void publish(const ros::Time& stamp, Value value)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (!chunk_.data.empty()){
+      int64_t dt = (stamp - chunk_.header.stamp).toNSec();
+      if (dt > std::numeric_limits<int32_t>::max() || dt < std::numeric_limits<int32_t>::min()){
+        publishChunk();
+      }
+    }
+
+    if (chunk_.data.empty()){
+      chunk_.header.stamp = stamp;
+      first_sample_time_ = ros::Time::now();
+    }
+
+    chunk_.dt.push_back((stamp - chunk_.header.stamp).toNSec());
+    chunk_.data.push_back(value);
+
+    if (chunk_.data.size() >= max_samples_ ||
+        (max_latency_ > ros::Duration(0.0) && ros::Time::now() - first_sample_time_ >= max_latency_)){
+      publishChunk();
+    }
+  }
+
+  /// Convenience overload for the single sample message, its frame id is used for the chunk
+  void publish(const Sample& sample)
+  {
+    setFrameId(sample.header.frame_id);
+    publish(sample.header.stamp, sample.data);
+  }
+
+  /// Publishes the pending samples immediately
+  void flush()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    publishChunk();
+  }
+
+  uint32_t getNumSubscribers() const { return publisher_.getNumSubscribers(); }
+
+private:
+  void publishChunk()
+  {
+    if (chunk_.data.empty()) return;
+
+    if (publisher_){
+      publisher_.publish(chunk_);
+    }
+    chunk_.dt.clear();
+    chunk_.data.clear();
+  }
+
+  void timerCallback(const ros::TimerEvent&)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (!chunk_.data.empty() && ros::Time::now() - first_sample_time_ >= max_latency_){
+      publishChunk();
+    }
+  }
+
+  ros::Publisher publisher_;
+  ros::Timer timer_;
+  boost::mutex mutex_;
+
+  ChunkT chunk_;
+  unsigned int max_samples_;
+  ros::Duration max_latency_;
+  ros::Time first_sample_time_;
+};
+
+/**
+ * Subscribes to a chunk topic and calls the callback once per sample with the single sample
+ * message, so existing callbacks for Float32, Float64 or UInt16 can be reused unchanged.
+ */
+template <class ChunkT>
+class ChunkSubscriber : boost::noncopyable
+{
+public:
+  typedef typename ChunkTraits<ChunkT>::Sample Sample;
+  typedef boost::function<void(const typename Sample::ConstPtr&)> Callback;
+
+  ChunkSubscriber()
+  {}
+
+  ChunkSubscriber(ros::NodeHandle& nh, const std::string& topic, uint32_t queue_size, const Callback& callback)
+  {
+    subscribe(nh, topic, queue_size, callback);
+  }
+
+  void subscribe(ros::NodeHandle& nh, const std::string& topic, uint32_t queue_size, const Callback& callback)
+  {
+    callback_ = callback;
+    subscriber_ = nh.subscribe(topic, queue_size, &ChunkSubscriber::chunkCallback, this);
+  }
+
+  void shutdown()
+  {
+    subscriber_.shutdown();
+  }
+
+  uint32_t getNumPublishers() const { return subscriber_.getNumPublishers(); }
+
+private:
+  void chunkCallback(const typename ChunkT::ConstPtr& chunk)
+  {
+    if (chunk->dt.size() != chunk->data.size()){
+      ROS_WARN_THROTTLE(1.0, "Ignoring chunk with %u offsets and %u samples on %s",
+                        (unsigned int)chunk->dt.size(), (unsigned int)chunk->data.size(), subscriber_.getTopic().c_str());
+      return;
+    }
+
+    for (size_t i = 0; i < chunk->data.size(); ++i){
+      typename Sample::Ptr sample(new Sample);
+      sample->header.seq = chunk->header.seq;
+      sample->header.frame_id = chunk->header.frame_id;
+      sample->header.stamp = chunk->header.stamp + ros::Duration().fromNSec(chunk->dt[i]);
+      sample->data = chunk->data[i];
+      callback_(sample);
+    }
+  }
+
+  ros::Subscriber subscriber_;
+  Callback callback_;
+};
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef hector_trace_trace_h__
+#define hector_trace_trace_h__
+
+#include <string>
+
+#include <stdint.h>
+
+/**
+ * Lightweight tracing of callback durations, exported as Chrome trace / Perfetto JSON.
+ *
+ * HECTOR_TRACE_SCOPE("node/callback") records the duration of the enclosing scope,
+ * HECTOR_TRACE_SCOPE_ID additionally records an id (e.g. the message stamp in nanoseconds), so
+ * spans of different nodes handling the same message can be correlated on one timeline.
+ * Names have to be string literals or otherwise outlive the trace.
+ *
+ * Events go into a per-thread single producer ring buffer and are written to the file by a
+ * background thread, which frees the buffer of an exited thread after writing its last events.
+ * While tracing is not started a span costs one load and branch; defining HECTOR_TRACE_DISABLE
+ * removes the macros entirely.
+ */
+
+namespace hector_trace{
+
+/// Starts writing events to filename. Timestamps are wall clock, so traces of several nodes can be merged.
+bool start(const std::string& filename, const std::string& process_name);
+
+/// Flushes remaining events and closes the file. Called automatically at exit.
+void stop();
+
+/// Names the calling thread in the trace viewer
+void setThreadName(const std::string& name);
+
+/// Number of events dropped because a ring buffer was full
+uint64_t getDroppedEvents();
+
+extern volatile bool g_enabled;
+
+uint64_t now();
+void record(const char* name, uint64_t begin, uint64_t end, uint64_t id);
+void recordInstant(const char* name, uint64_t id);
+
+class ScopedSpan
+{
+public:
+  explicit ScopedSpan(const char* name, uint64_t id = 0)
+    : name_(g_enabled ? name : 0)
+    , id_(id)
+    , begin_(name_ ? now() : 0)
+  {}
+
+  ~ScopedSpan()
+  {
+    if (name_){
+      record(name_, begin_, now(), id_);
+    }
+  }
+
+private:
+  const char* name_;
+  uint64_t id_;
+  uint64_t begin_;
+};
+
+}
+
+#define HECTOR_TRACE_CONCAT_INNER(a, b) a ## b
+#define HECTOR_TRACE_CONCAT(a, b) HECTOR_TRACE_CONCAT_INNER(a, b)
+
+#ifndef HECTOR_TRACE_DISABLE
+#define HECTOR_TRACE_SCOPE(name) hector_trace::ScopedSpan HECTOR_TRACE_CONCAT(hector_trace_span_, __LINE__) (name)
+#define HECTOR_TRACE_SCOPE_ID(name, id) hector_trace::ScopedSpan HECTOR_TRACE_CONCAT(hector_trace_span_, __LINE__) (name, id)
+#define HECTOR_TRACE_INSTANT(name, id) do { if (hector_trace::g_enabled) hector_trace::recordInstant(name, id); } while (0)
+#else
+#define HECTOR_TRACE_SCOPE(name) do {} while (0)
+#define HECTOR_TRACE_SCOPE_ID(name, id) do {} while (0)
+#define HECTOR_TRACE_INSTANT(name, id) do {} while (0)
+#endif
+
+#endif
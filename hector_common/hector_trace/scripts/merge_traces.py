@@ -0,0 +1,26 @@
+#!/usr/bin/env python
+# Merges trace files of several nodes into one Chrome trace / Perfetto JSON file.
+# Usage: merge_traces.py output.json input1.json input2.json ...
+
+import json
+import sys
+
+def load(filename):
+    text = open(filename).read().strip()
+    # files of nodes that did not shut down cleanly lack the closing bracket
+    if text.endswith(','):
+        text = text[:-1]
+    if not text.endswith(']'):
+        text += ']'
+    return json.loads(text)
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3:
+        sys.stderr.write('usage: merge_traces.py output.json input.json [input.json ...]\n')
+        sys.exit(1)
+
+    events = []
+    for filename in sys.argv[2:]:
+        events.extend(load(filename))
+
+    json.dump({'traceEvents': events, 'displayTimeUnit': 'ms'}, open(sys.argv[1], 'w'))
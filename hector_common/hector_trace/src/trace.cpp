@@ -0,0 +1,305 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <hector_trace/trace.h>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace hector_trace{
+
+volatile bool g_enabled = false;
+
+namespace{
+
+struct Event
+{
+  const char* name;
+  uint64_t begin;
+  uint64_t end;    // 0 for instant events
+  uint64_t id;
+};
+
+/**
+ * Single producer (the owning thread), single consumer (the flush thread) ring buffer.
+ * head is only written by the producer, tail only by the consumer.
+ */
+struct ThreadBuffer
+{
+  enum { CAPACITY = 8192, MASK = CAPACITY - 1 };
+
+  ThreadBuffer()
+    : head(0), tail(0), tid(static_cast<int>(syscall(SYS_gettid))), name_written(false), exited(false)
+  {}
+
+  Event events[CAPACITY];
+  volatile uint32_t head;
+  volatile uint32_t tail;
+  int tid;
+  std::string name;
+  bool name_written;
+  bool exited;     // the owning thread is gone, the buffer is freed once it is drained
+};
+
+__thread ThreadBuffer* t_buffer = 0;
+
+// only used for its destructor, which retires the buffer of an exiting thread
+pthread_key_t g_buffer_key;
+pthread_once_t g_buffer_key_once = PTHREAD_ONCE_INIT;
+
+boost::mutex g_mutex;             // protects g_buffers, g_file and start/stop
+std::vector<ThreadBuffer*> g_buffers;
+FILE* g_file = 0;
+int g_pid = 0;
+volatile bool g_running = false;
+boost::thread* g_flush_thread = 0;
+volatile uint64_t g_dropped = 0;
+bool g_atexit_registered = false;
+
+void removeBuffer(ThreadBuffer* buffer)
+{
+  for (size_t i = 0; i < g_buffers.size(); ++i){
+    if (g_buffers[i] == buffer){
+      g_buffers.erase(g_buffers.begin() + i);
+      break;
+    }
+  }
+  delete buffer;
+}
+
+void retireBuffer(void* data)
+{
+  ThreadBuffer* buffer = static_cast<ThreadBuffer*>(data);
+  t_buffer = 0;
+
+  boost::mutex::scoped_lock lock(g_mutex);
+
+  // without a trace file nothing drains the buffer, its events are discarded like all others
+  if (g_file){
+    buffer->exited = true;
+  }else{
+    removeBuffer(buffer);
+  }
+}
+
+void createBufferKey()
+{
+  pthread_key_create(&g_buffer_key, &retireBuffer);
+}
+
+ThreadBuffer* getBuffer()
+{
+  if (!t_buffer){
+    pthread_once(&g_buffer_key_once, &createBufferKey);
+
+    ThreadBuffer* buffer = new ThreadBuffer();
+    {
+      boost::mutex::scoped_lock lock(g_mutex);
+      g_buffers.push_back(buffer);
+    }
+    pthread_setspecific(g_buffer_key, buffer);
+    t_buffer = buffer;
+  }
+  return t_buffer;
+}
+
+inline void push(const Event& event)
+{
+  ThreadBuffer* buffer = getBuffer();
+
+  uint32_t head = buffer->head;
+  uint32_t next = (head + 1) & ThreadBuffer::MASK;
+
+  if (next == buffer->tail){
+    __sync_fetch_and_add(&g_dropped, 1);
+    return;
+  }
+
+  buffer->events[head] = event;
+  __sync_synchronize();
+  buffer->head = next;
+}
+
+// caller holds g_mutex
+void drain()
+{
+  if (!g_file){
+    return;
+  }
+
+  for (size_t i = 0; i < g_buffers.size(); ){
+    ThreadBuffer* buffer = g_buffers[i];
+
+    if (!buffer->name_written){
+      std::string name = buffer->name.empty() ? "thread" : buffer->name;
+      fprintf(g_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n", g_pid, buffer->tid, name.c_str());
+      buffer->name_written = true;
+    }
+
+    uint32_t tail = buffer->tail;
+    uint32_t head = buffer->head;
+    __sync_synchronize();
+
+    for (; tail != head; tail = (tail + 1) & ThreadBuffer::MASK){
+      const Event& event = buffer->events[tail];
+
+      if (event.end){
+        fprintf(g_file, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"id\":%llu}},\n",
+                event.name, event.begin * 1e-3, (event.end - event.begin) * 1e-3, g_pid, buffer->tid, static_cast<unsigned long long>(event.id));
+      }else{
+        fprintf(g_file, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"id\":%llu}},\n",
+                event.name, event.begin * 1e-3, g_pid, buffer->tid, static_cast<unsigned long long>(event.id));
+      }
+    }
+
+    __sync_synchronize();
+    buffer->tail = tail;
+
+    // the buffer of an exited thread gets no further events
+    if (buffer->exited){
+      removeBuffer(buffer);
+    }else{
+      ++i;
+    }
+  }
+
+  fflush(g_file);
+}
+
+void flushLoop()
+{
+  while (g_running){
+    boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+
+    boost::mutex::scoped_lock lock(g_mutex);
+    drain();
+  }
+}
+
+}
+
+uint64_t now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+void record(const char* name, uint64_t begin, uint64_t end, uint64_t id)
+{
+  Event event = { name, begin, end > begin ? end : begin + 1, id };
+  push(event);
+}
+
+void recordInstant(const char* name, uint64_t id)
+{
+  Event event = { name, now(), 0, id };
+  push(event);
+}
+
+bool start(const std::string& filename, const std::string& process_name)
+{
+  stop();
+
+  boost::mutex::scoped_lock lock(g_mutex);
+
+  g_file = fopen(filename.c_str(), "w");
+
+  if (!g_file){
+    return false;
+  }
+
+  g_pid = static_cast<int>(getpid());
+
+  // JSON array format, the closing bracket is optional for the trace viewers, so a crashed node still leaves a readable trace
+  fprintf(g_file, "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s\"}},\n", g_pid, process_name.c_str());
+
+  if (!g_atexit_registered){
+    atexit(stop);
+    g_atexit_registered = true;
+  }
+
+  g_running = true;
+  g_flush_thread = new boost::thread(&flushLoop);
+  g_enabled = true;
+
+  return true;
+}
+
+void stop()
+{
+  g_enabled = false;
+
+  boost::thread* flush_thread = 0;
+  {
+    boost::mutex::scoped_lock lock(g_mutex);
+    g_running = false;
+    flush_thread = g_flush_thread;
+    g_flush_thread = 0;
+  }
+
+  if (flush_thread){
+    flush_thread->join();
+    delete flush_thread;
+  }
+
+  boost::mutex::scoped_lock lock(g_mutex);
+
+  if (g_file){
+    drain();
+    fprintf(g_file, "{\"name\":\"dropped_events\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"count\":%llu}}\n]\n", g_pid, static_cast<unsigned long long>(g_dropped));
+    fclose(g_file);
+    g_file = 0;
+  }
+}
+
+void setThreadName(const std::string& name)
+{
+  ThreadBuffer* buffer = getBuffer();
+
+  boost::mutex::scoped_lock lock(g_mutex);
+  buffer->name = name;
+  buffer->name_written = false;
+}
+
+uint64_t getDroppedEvents()
+{
+  return g_dropped;
+}
+
+}
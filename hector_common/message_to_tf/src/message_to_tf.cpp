@@ -4,6 +4,7 @@
 #include <sensor_msgs/Imu.h>
 #include <tf/transform_broadcaster.h>
 #include <tf/transform_datatypes.h>
+#include <hector_trace/ros_trace.h>
 
 std::string g_odometry_topic;
 std::string g_pose_topic;
@@ -96,14 +97,17 @@ void sendTransform(geometry_msgs::Pose const &pose, const std_msgs::Header& head
 }
 
 void odomCallback(nav_msgs::Odometry const &odometry) {
+  HECTOR_TRACE_SCOPE_ID("message_to_tf/odom", odometry.header.stamp.toNSec());
   sendTransform(odometry.pose.pose, odometry.header, odometry.child_frame_id);
 }
 
 void poseCallback(geometry_msgs::PoseStamped const &pose) {
+  HECTOR_TRACE_SCOPE_ID("message_to_tf/pose", pose.header.stamp.toNSec());
   sendTransform(pose.pose, pose.header);
 }
 
 void imuCallback(sensor_msgs::Imu const &imu) {
+  HECTOR_TRACE_SCOPE_ID("message_to_tf/imu", imu.header.stamp.toNSec());
   std::vector<geometry_msgs::TransformStamped> transforms;
   std::string child_frame_id;
 
@@ -152,6 +156,8 @@ int main(int argc, char** argv) {
   priv_nh.getParam("stabilized_frame_id", g_stabilized_frame_id);
   priv_nh.getParam("child_frame_id", g_child_frame_id);
 
+  hector_trace::init(priv_nh);
+
   g_transform_broadcaster = new tf::TransformBroadcaster;
 
   ros::NodeHandle node;
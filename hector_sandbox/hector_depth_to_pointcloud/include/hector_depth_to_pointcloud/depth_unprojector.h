@@ -0,0 +1,83 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef hector_depth_to_pointcloud_depth_unprojector_h__
+#define hector_depth_to_pointcloud_depth_unprojector_h__
+
+#include <cstddef>
+#include <vector>
+
+#include <stdint.h>
+
+namespace hector_depth_to_pointcloud{
+
+/**
+ * Converts depth images into organized x/y/z/padding float points (16 bytes per point, PCL PointXYZ layout).
+ *
+ * The unprojection factors (u - cx) / fx and (v - cy) / fy are precomputed once per camera model; a
+ * point then costs two multiplications. Rows are processed four pixels at a time with SSE.
+ * With a decimation factor n, every n x n pixel block is reduced to its closest valid depth, which
+ * keeps the output organized.
+ */
+class DepthUnprojector
+{
+public:
+  DepthUnprojector();
+
+  /// Rebuilds the lookup tables. Returns true if the model changed.
+  bool setCameraModel(int width, int height, double fx, double fy, double cx, double cy, int decimation = 1);
+
+  int getOutputWidth() const { return output_width_; }
+  int getOutputHeight() const { return output_height_; }
+
+  /// Depth in millimeters (16UC1), 0 is invalid. points must hold output width * height * 4 floats.
+  void unproject(const uint16_t* depth, size_t row_step, float* points) const;
+
+  /// Depth in meters (32FC1), only finite positive values are valid.
+  void unproject(const float* depth, size_t row_step, float* points) const;
+
+protected:
+  template<typename T> void unprojectDecimated(const T* depth, size_t row_step, float scale, float* points) const;
+
+  int width_;
+  int height_;
+  int decimation_;
+  int output_width_;
+  int output_height_;
+
+  double fx_, fy_, cx_, cy_;
+
+  // per output column and row, evaluated at the block center for decimated output
+  std::vector<float> x_factors_;
+  std::vector<float> y_factors_;
+};
+
+}
+
+#endif
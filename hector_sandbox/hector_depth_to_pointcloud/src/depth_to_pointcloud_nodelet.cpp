@@ -0,0 +1,154 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include <ros/ros.h>
+#include <image_transport/image_transport.h>
+#include <sensor_msgs/image_encodings.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include <hector_depth_to_pointcloud/depth_unprojector.h>
+
+#include <boost/thread/mutex.hpp>
+
+namespace hector_depth_to_pointcloud{
+
+/**
+ * Converts depth images (16UC1 in mm or 32FC1 in m) with their camera_info into organized x/y/z clouds.
+ * Clouds are published as shared pointers, so nodelets in the same manager receive them without copies.
+ */
+class DepthToPointcloudNodelet : public nodelet::Nodelet
+{
+public:
+  virtual void onInit()
+  {
+    ros::NodeHandle& nh_ = getNodeHandle();
+    ros::NodeHandle& pnh_ = getPrivateNodeHandle();
+
+    pnh_.param("decimation", p_decimation_, 1);
+    pnh_.param("queue_size", p_queue_size_, 1);
+
+    it_.reset(new image_transport::ImageTransport(nh_));
+
+    // only subscribe to the depth image while someone listens to the cloud
+    ros::SubscriberStatusCallback connect_cb = boost::bind(&DepthToPointcloudNodelet::connectCallback, this);
+
+    boost::mutex::scoped_lock lock(connect_mutex_);
+    point_cloud2_pub_ = nh_.advertise<sensor_msgs::PointCloud2>("points", 1, connect_cb, connect_cb);
+  }
+
+  void connectCallback()
+  {
+    boost::mutex::scoped_lock lock(connect_mutex_);
+
+    if (point_cloud2_pub_.getNumSubscribers() == 0){
+      depth_sub_.shutdown();
+    }else if (!depth_sub_){
+      depth_sub_ = it_->subscribeCamera("depth/image", p_queue_size_, &DepthToPointcloudNodelet::depthCallback, this);
+    }
+  }
+
+  void depthCallback(const sensor_msgs::ImageConstPtr& depth_msg, const sensor_msgs::CameraInfoConstPtr& info_msg)
+  {
+    bool is_16u = depth_msg->encoding == sensor_msgs::image_encodings::TYPE_16UC1;
+    bool is_32f = depth_msg->encoding == sensor_msgs::image_encodings::TYPE_32FC1;
+
+    if (!is_16u && !is_32f){
+      NODELET_ERROR_THROTTLE(1.0, "Unsupported depth image encoding %s", depth_msg->encoding.c_str());
+      return;
+    }
+
+    // the unprojector reads width pixels of height rows with the given step
+    size_t bytes_per_pixel = is_16u ? sizeof(uint16_t) : sizeof(float);
+    if (depth_msg->step < depth_msg->width * bytes_per_pixel ||
+        depth_msg->data.size() < static_cast<size_t>(depth_msg->step) * depth_msg->height){
+      NODELET_ERROR_THROTTLE(1.0, "Inconsistent depth image: %dx%d, step %d, %d bytes", depth_msg->width, depth_msg->height,
+                             depth_msg->step, static_cast<int>(depth_msg->data.size()));
+      return;
+    }
+
+    // camera_info is usually constant, the lookup tables are only rebuilt if it changes
+    if (unprojector_.setCameraModel(depth_msg->width, depth_msg->height, info_msg->K[0], info_msg->K[4], info_msg->K[2], info_msg->K[5], p_decimation_)){
+      NODELET_INFO("Camera model %dx%d, output cloud %dx%d", depth_msg->width, depth_msg->height,
+                   unprojector_.getOutputWidth(), unprojector_.getOutputHeight());
+    }
+
+    // a new message per frame: published messages are shared with other nodelets and must not be modified
+    sensor_msgs::PointCloud2Ptr cloud (new sensor_msgs::PointCloud2());
+    cloud->header = depth_msg->header;
+    cloud->width = unprojector_.getOutputWidth();
+    cloud->height = unprojector_.getOutputHeight();
+    cloud->is_bigendian = false;
+    cloud->is_dense = false;
+    cloud->point_step = 4 * sizeof(float);
+    cloud->row_step = cloud->width * cloud->point_step;
+    cloud->fields.resize(3);
+
+    const char* names[3] = { "x", "y", "z" };
+    for (int i = 0; i < 3; ++i){
+      cloud->fields[i].name = names[i];
+      cloud->fields[i].offset = i * sizeof(float);
+      cloud->fields[i].datatype = sensor_msgs::PointField::FLOAT32;
+      cloud->fields[i].count = 1;
+    }
+
+    cloud->data.resize(cloud->row_step * cloud->height);
+
+    if (cloud->data.empty()){
+      return;
+    }
+
+    float* points = reinterpret_cast<float*>(&cloud->data[0]);
+
+    if (is_16u){
+      unprojector_.unproject(reinterpret_cast<const uint16_t*>(&depth_msg->data[0]), depth_msg->step, points);
+    }else{
+      unprojector_.unproject(reinterpret_cast<const float*>(&depth_msg->data[0]), depth_msg->step, points);
+    }
+
+    point_cloud2_pub_.publish(cloud);
+  }
+
+protected:
+  boost::shared_ptr<image_transport::ImageTransport> it_;
+  image_transport::CameraSubscriber depth_sub_;
+  ros::Publisher point_cloud2_pub_;
+  boost::mutex connect_mutex_;
+
+  DepthUnprojector unprojector_;
+
+  int p_decimation_;
+  int p_queue_size_;
+};
+
+}
+
+PLUGINLIB_DECLARE_CLASS(hector_depth_to_pointcloud, DepthToPointcloudNodelet, hector_depth_to_pointcloud::DepthToPointcloudNodelet, nodelet::Nodelet);
@@ -0,0 +1,221 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <hector_depth_to_pointcloud/depth_unprojector.h>
+
+#include <cmath>
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace hector_depth_to_pointcloud{
+
+static const float kNaN = std::numeric_limits<float>::quiet_NaN();
+static const float kInfinity = std::numeric_limits<float>::infinity();
+
+DepthUnprojector::DepthUnprojector()
+  : width_(0)
+  , height_(0)
+  , decimation_(1)
+  , output_width_(0)
+  , output_height_(0)
+  , fx_(0.0), fy_(0.0), cx_(0.0), cy_(0.0)
+{}
+
+bool DepthUnprojector::setCameraModel(int width, int height, double fx, double fy, double cx, double cy, int decimation)
+{
+  if (decimation < 1){
+    decimation = 1;
+  }
+
+  if (width == width_ && height == height_ && fx == fx_ && fy == fy_ && cx == cx_ && cy == cy_ && decimation == decimation_){
+    return false;
+  }
+
+  width_ = width;
+  height_ = height;
+  fx_ = fx; fy_ = fy; cx_ = cx; cy_ = cy;
+  decimation_ = decimation;
+  output_width_ = width / decimation;
+  output_height_ = height / decimation;
+
+  double offset = 0.5 * (decimation - 1);
+
+  x_factors_.resize(output_width_);
+  for (int u = 0; u < output_width_; ++u){
+    x_factors_[u] = static_cast<float>((u * decimation + offset - cx) / fx);
+  }
+
+  y_factors_.resize(output_height_);
+  for (int v = 0; v < output_height_; ++v){
+    y_factors_[v] = static_cast<float>((v * decimation + offset - cy) / fy);
+  }
+
+  return true;
+}
+
+static inline void storePoint(float* point, float depth, float x_factor, float y_factor)
+{
+  // comparisons with NaN are false
+  if (depth > 0.0f && depth < kInfinity){
+    point[0] = depth * x_factor;
+    point[1] = depth * y_factor;
+    point[2] = depth;
+  }else{
+    point[0] = point[1] = point[2] = kNaN;
+  }
+  point[3] = 0.0f;
+}
+
+template<typename T>
+void DepthUnprojector::unprojectDecimated(const T* depth, size_t row_step, float scale, float* points) const
+{
+  for (int v = 0; v < output_height_; ++v){
+    float y_factor = y_factors_[v];
+
+    for (int u = 0; u < output_width_; ++u){
+      // closest valid depth of the block, comparisons with NaN are false
+      float closest = kInfinity;
+
+      for (int dv = 0; dv < decimation_; ++dv){
+        const T* row = reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(depth) + (v * decimation_ + dv) * row_step);
+
+        for (int du = 0; du < decimation_; ++du){
+          float d = static_cast<float>(row[u * decimation_ + du]) * scale;
+          if (d > 0.0f && d < closest){
+            closest = d;
+          }
+        }
+      }
+
+      storePoint(points, std::isinf(closest) ? 0.0f : closest, x_factors_[u], y_factor);
+      points += 4;
+    }
+  }
+}
+
+#ifdef __SSE2__
+
+static inline void storeBlock(float* points, __m128 d, __m128 x_factor, __m128 y_factor)
+{
+  __m128 x = _mm_mul_ps(d, x_factor);
+  __m128 y = _mm_mul_ps(d, y_factor);
+  __m128 z = d;
+  __m128 w = _mm_setzero_ps();
+
+  _MM_TRANSPOSE4_PS(x, y, z, w);
+
+  _mm_storeu_ps(points, x);
+  _mm_storeu_ps(points + 4, y);
+  _mm_storeu_ps(points + 8, z);
+  _mm_storeu_ps(points + 12, w);
+}
+
+void DepthUnprojector::unproject(const uint16_t* depth, size_t row_step, float* points) const
+{
+  if (decimation_ > 1){
+    unprojectDecimated(depth, row_step, 0.001f, points);
+    return;
+  }
+
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 scale = _mm_set1_ps(0.001f);
+  const __m128 nan = _mm_set1_ps(kNaN);
+
+  for (int v = 0; v < height_; ++v){
+    const uint16_t* row = reinterpret_cast<const uint16_t*>(reinterpret_cast<const uint8_t*>(depth) + v * row_step);
+    __m128 y_factor = _mm_set1_ps(y_factors_[v]);
+    int u = 0;
+
+    for (; u + 4 <= width_; u += 4, points += 16){
+      __m128i raw = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + u)), zero);
+      __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(raw), scale);
+
+      // 0 marks invalid measurements
+      __m128 invalid = _mm_castsi128_ps(_mm_cmpeq_epi32(raw, zero));
+      d = _mm_or_ps(_mm_and_ps(invalid, nan), _mm_andnot_ps(invalid, d));
+
+      storeBlock(points, d, _mm_loadu_ps(&x_factors_[u]), y_factor);
+    }
+
+    for (; u < width_; ++u, points += 4){
+      storePoint(points, row[u] * 0.001f, x_factors_[u], y_factors_[v]);
+    }
+  }
+}
+
+void DepthUnprojector::unproject(const float* depth, size_t row_step, float* points) const
+{
+  if (decimation_ > 1){
+    unprojectDecimated(depth, row_step, 1.0f, points);
+    return;
+  }
+
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 infinity = _mm_set1_ps(kInfinity);
+  const __m128 nan = _mm_set1_ps(kNaN);
+
+  for (int v = 0; v < height_; ++v){
+    const float* row = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(depth) + v * row_step);
+    __m128 y_factor = _mm_set1_ps(y_factors_[v]);
+    int u = 0;
+
+    for (; u + 4 <= width_; u += 4, points += 16){
+      __m128 d = _mm_loadu_ps(row + u);
+
+      // same test as storePoint(): finite and positive, NaN fails both comparisons
+      __m128 valid = _mm_and_ps(_mm_cmpgt_ps(d, zero), _mm_cmplt_ps(d, infinity));
+      d = _mm_or_ps(_mm_and_ps(valid, d), _mm_andnot_ps(valid, nan));
+
+      storeBlock(points, d, _mm_loadu_ps(&x_factors_[u]), y_factor);
+    }
+
+    for (; u < width_; ++u, points += 4){
+      storePoint(points, row[u], x_factors_[u], y_factors_[v]);
+    }
+  }
+}
+
+#else
+
+void DepthUnprojector::unproject(const uint16_t* depth, size_t row_step, float* points) const
+{
+  unprojectDecimated(depth, row_step, 0.001f, points);
+}
+
+void DepthUnprojector::unproject(const float* depth, size_t row_step, float* points) const
+{
+  unprojectDecimated(depth, row_step, 1.0f, points);
+}
+
+#endif
+
+}
@@ -29,20 +29,33 @@
 #include <ros/ros.h>
 #include <laser_geometry/laser_geometry.h>
 #include <tf/transform_listener.h>
+#include <hector_scan_codec/scan_transport.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <hector_trace/ros_trace.h>
+
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <deque>
 
 class LaserscanToPointcloud
 {
 public:
 
   LaserscanToPointcloud()
+    : running_(false)
+    , scans_received_(0)
+    , scans_projected_(0)
+    , scans_waited_(0)
+    , scans_late_(0)
+    , scans_dropped_(0)
+    , last_lost_(0)
   {
     ros::NodeHandle nh_;
 
-    scan_sub_ = nh_.subscribe("scan", 1, &LaserscanToPointcloud::scanCallback, this);
-    point_cloud2_pub_ = nh_.advertise<sensor_msgs::PointCloud2>("scan_cloud",1,false);
-
-
     ros::NodeHandle pnh_("~");
+    hector_trace::init(pnh_);
+
     pnh_.param("max_range", p_max_range_, 29.0);
     pnh_.param("min_range", p_min_range_, 0.0);
 
@@ -55,52 +68,229 @@ public:
       if (p_target_frame_ == "NO_TARGET_FRAME_SPECIFIED"){
         ROS_ERROR("No target frame specified! Needs to be set for high fidelity projection to work");
         p_use_high_fidelity_projection_ = false;
-        return;
       }
+    }
+
+    if (p_use_high_fidelity_projection_){
+      // scans wait in a queue until tf covers their start and end time, projection happens on a
+      // worker thread so the subscriber callback never blocks on tf
+      pnh_.param("scan_queue_size", p_scan_queue_size_, 20);
+      pnh_.param("max_tf_wait", p_max_tf_wait_, 0.2);
 
       tfl_.reset(new tf::TransformListener());
 
+      scan_sub_.subscribe(nh_, "scan", p_scan_queue_size_, boost::bind(&LaserscanToPointcloud::queueScan, this, _1));
+      diagnostics_pub_ = nh_.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+      diagnostics_timer_ = nh_.createTimer(ros::Duration(1.0), &LaserscanToPointcloud::publishDiagnostics, this);
+
+      running_ = true;
+      worker_ = boost::thread(&LaserscanToPointcloud::projectionLoop, this);
+    }else{
+      scan_sub_.subscribe(nh_, "scan", 1, boost::bind(&LaserscanToPointcloud::scanCallback, this, _1));
+    }
+
+    point_cloud2_pub_ = nh_.advertise<sensor_msgs::PointCloud2>("scan_cloud",1,false);
+  }
+
+  ~LaserscanToPointcloud()
+  {
+    {
+      boost::mutex::scoped_lock lock(queue_mutex_);
+      running_ = false;
+    }
+    queue_condition_.notify_all();
+
+    if (worker_.joinable()){
+      worker_.join();
     }
 
+    ROS_INFO("Scans received: %u, projected: %u, waited for tf: %u, late: %u, dropped: %u",
+             scans_received_, scans_projected_, scans_waited_, scans_late_, scans_dropped_);
   }
 
   void scanCallback (const sensor_msgs::LaserScan::ConstPtr& scan_in)
   {
+    HECTOR_TRACE_SCOPE_ID("laserscan_to_pointcloud/scan", scan_in->header.stamp.toNSec());
+
     cloud2_.data.clear();
 
-    const sensor_msgs::LaserScan* scan_to_convert = scan_in.get();
+    projector_.projectLaser(*applyMinRange(scan_in), cloud2_, p_max_range_, laser_geometry::channel_option::Intensity);
+
+    point_cloud2_pub_.publish(cloud2_);
+  }
+
+  void queueScan(const sensor_msgs::LaserScan::ConstPtr& scan_in)
+  {
+    HECTOR_TRACE_INSTANT("laserscan_to_pointcloud/queue_scan", scan_in->header.stamp.toNSec());
+
+    {
+      boost::mutex::scoped_lock lock(queue_mutex_);
+
+      ++scans_received_;
+
+      if (static_cast<int>(scan_queue_.size()) >= p_scan_queue_size_){
+        scan_queue_.pop_front();
+        ++scans_dropped_;
+      }
+
+      QueuedScan queued;
+      queued.scan = scan_in;
+      queued.arrival = ros::WallTime::now();
+      scan_queue_.push_back(queued);
+    }
+
+    queue_condition_.notify_one();
+  }
+
+protected:
+  struct QueuedScan
+  {
+    sensor_msgs::LaserScan::ConstPtr scan;
+    ros::WallTime arrival;
+  };
+
+  const sensor_msgs::LaserScan* applyMinRange(const sensor_msgs::LaserScan::ConstPtr& scan_in)
+  {
+    if (p_min_range_ <= 0.0){
+      return scan_in.get();
+    }
+
+    scan_min_range_ = *scan_in;
+
+    size_t num_scans = scan_min_range_.ranges.size();
+
+    std::vector<float>& ranges_vec = scan_min_range_.ranges;
+
+    float min_range = static_cast<float>(p_min_range_);
+
+    for (size_t i = 0; i < num_scans; ++i){
+      if (ranges_vec[i] < min_range){
+        ranges_vec[i] = -INFINITY;
+      }
+    }
+
+    return &scan_min_range_;
+  }
 
-    if (p_min_range_ > 0.0){
-      scan_min_range_ = *scan_in;
+  bool waitForTransform(const std::string& frame_id, const ros::Time& stamp, const ros::WallTime& deadline)
+  {
+    while (!tfl_->canTransform(p_target_frame_, frame_id, stamp)){
+      if (!running_ || ros::WallTime::now() >= deadline){
+        return false;
+      }
+      ros::WallDuration(0.002).sleep();
+    }
+    return true;
+  }
+
+  void projectionLoop()
+  {
+    while (true){
+      QueuedScan queued;
+
+      {
+        boost::mutex::scoped_lock lock(queue_mutex_);
+        while (running_ && scan_queue_.empty()){
+          queue_condition_.wait(lock);
+        }
+        if (!running_){
+          return;
+        }
+        queued = scan_queue_.front();
+        scan_queue_.pop_front();
+      }
 
-      size_t num_scans = scan_min_range_.ranges.size();
+      const sensor_msgs::LaserScan& scan = *queued.scan;
+      ros::Time end_time = scan.header.stamp + ros::Duration(scan.ranges.empty() ? 0.0 : (scan.ranges.size() - 1) * scan.time_increment);
 
-      std::vector<float>& ranges_vec = scan_min_range_.ranges;
+      // the deadline is counted from arrival, so a scan never waits longer than max_tf_wait in total
+      ros::WallTime deadline = queued.arrival + ros::WallDuration(p_max_tf_wait_);
 
-      float min_range = static_cast<float>(p_min_range_);
+      bool available = tfl_->canTransform(p_target_frame_, scan.header.frame_id, scan.header.stamp) &&
+                       tfl_->canTransform(p_target_frame_, scan.header.frame_id, end_time);
 
-      for (size_t i = 0; i < num_scans; ++i){
-        if (ranges_vec[i] < min_range){
-          ranges_vec[i] = -INFINITY;
+      if (!available){
+        {
+          boost::mutex::scoped_lock lock(queue_mutex_);
+          ++scans_waited_;
         }
+
+        HECTOR_TRACE_SCOPE_ID("laserscan_to_pointcloud/wait_for_tf", scan.header.stamp.toNSec());
+        available = waitForTransform(scan.header.frame_id, scan.header.stamp, deadline) &&
+                    waitForTransform(scan.header.frame_id, end_time, deadline);
+      }
+
+      if (!available){
+        boost::mutex::scoped_lock lock(queue_mutex_);
+        ++scans_late_;
+        continue;
+      }
+
+      HECTOR_TRACE_SCOPE_ID("laserscan_to_pointcloud/project", scan.header.stamp.toNSec());
+
+      cloud2_.data.clear();
+
+      try{
+        projector_.transformLaserScanToPointCloud(p_target_frame_, *applyMinRange(queued.scan), cloud2_, *tfl_, p_max_range_, laser_geometry::channel_option::Intensity);
+      }catch (tf::TransformException& e){
+        ROS_WARN_THROTTLE(1.0, "Could not project scan: %s", e.what());
+        boost::mutex::scoped_lock lock(queue_mutex_);
+        ++scans_late_;
+        continue;
       }
 
-      scan_to_convert = &scan_min_range_;
+      point_cloud2_pub_.publish(cloud2_);
+
+      boost::mutex::scoped_lock lock(queue_mutex_);
+      ++scans_projected_;
     }
+  }
 
-    if (p_use_high_fidelity_projection_){
-      projector_.transformLaserScanToPointCloud(p_target_frame_, *scan_to_convert, cloud2_, *tfl_, p_max_range_, laser_geometry::channel_option::Intensity);
-    }else{
-      projector_.projectLaser(*scan_to_convert, cloud2_, p_max_range_, laser_geometry::channel_option::Intensity);
+  void publishDiagnostics(const ros::TimerEvent&)
+  {
+    diagnostic_msgs::DiagnosticArray diagnostics;
+    diagnostics.header.stamp = ros::Time::now();
+    diagnostics.status.resize(1);
+
+    diagnostic_msgs::DiagnosticStatus& status = diagnostics.status[0];
+    status.name = ros::this_node::getName() + ": scan queue";
+    status.hardware_id = p_target_frame_;
+
+    {
+      boost::mutex::scoped_lock lock(queue_mutex_);
+      addValue(status, "received", scans_received_);
+      addValue(status, "projected", scans_projected_);
+      addValue(status, "waited for tf", scans_waited_);
+      addValue(status, "late", scans_late_);
+      addValue(status, "dropped", scans_dropped_);
+      addValue(status, "queued", scan_queue_.size());
+
+      if (scans_late_ + scans_dropped_ > last_lost_){
+        status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+        status.message = "Scans lost since last report";
+      }else{
+        status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        status.message = "OK";
+      }
+      last_lost_ = scans_late_ + scans_dropped_;
     }
 
+    diagnostics_pub_.publish(diagnostics);
+  }
 
-    point_cloud2_pub_.publish(cloud2_);
+  template <typename T>
+  static void addValue(diagnostic_msgs::DiagnosticStatus& status, const std::string& key, T value)
+  {
+    diagnostic_msgs::KeyValue key_value;
+    key_value.key = key;
+    key_value.value = boost::lexical_cast<std::string>(value);
+    status.values.push_back(key_value);
   }
 
-protected:
-  ros::Subscriber scan_sub_;
+  hector_scan_codec::ScanSubscriber scan_sub_;
   ros::Publisher point_cloud2_pub_;
+  ros::Publisher diagnostics_pub_;
+  ros::Timer diagnostics_timer_;
 
   boost::shared_ptr<tf::TransformListener> tfl_;
 
@@ -108,11 +298,27 @@ protected:
   double p_min_range_;
   bool p_use_high_fidelity_projection_;
   std::string p_target_frame_;
+  int p_scan_queue_size_;
+  double p_max_tf_wait_;
 
   laser_geometry::LaserProjection projector_;
 
   sensor_msgs::PointCloud2 cloud2_;
   sensor_msgs::LaserScan scan_min_range_;
+
+  // high fidelity projection: scans in arrival order, guarded by queue_mutex_ together with the counters
+  std::deque<QueuedScan> scan_queue_;
+  boost::mutex queue_mutex_;
+  boost::condition_variable queue_condition_;
+  boost::thread worker_;
+  volatile bool running_;
+
+  unsigned int scans_received_;
+  unsigned int scans_projected_;
+  unsigned int scans_waited_;   // tf was not available on arrival
+  unsigned int scans_late_;     // tf did not become available within max_tf_wait
+  unsigned int scans_dropped_;  // queue overflow
+  unsigned int last_lost_;
 };
 
 int main(int argc, char** argv)
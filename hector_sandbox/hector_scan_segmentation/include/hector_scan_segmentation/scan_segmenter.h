@@ -0,0 +1,145 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+
+#ifndef hector_scan_segmentation_scan_segmenter_h__
+#define hector_scan_segmentation_scan_segmenter_h__
+
+#include <vector>
+#include <stddef.h>
+
+namespace hector_scan_segmentation{
+
+struct Point2
+{
+  float x, y;
+};
+
+struct Cluster
+{
+  unsigned int first_beam, last_beam;   // inclusive
+  unsigned int first_point, num_points; // into ScanSegmenter::getPoints()
+  Point2 centroid;
+  float radius;                         // largest distance of a point from the centroid
+};
+
+struct Segment
+{
+  Point2 start, end;                    // first and last point projected onto the fitted line
+  unsigned int cluster;
+  unsigned int first_beam, last_beam;
+  float rms_error;                      // total least squares fit
+};
+
+/**
+ * Segments a scan into clusters of consecutive beams and fits line segments to them.
+ *
+ * Clustering is a single pass in beam order: a cluster ends where the distance between neighbouring
+ * points exceeds an adaptive breakpoint threshold (growing with range and angle increment) or after
+ * too many invalid beams. Lines are extracted per cluster by split-and-merge: the cluster is split
+ * recursively at the point farthest from the chord, then neighbouring pieces are merged while their
+ * joint fit stays below the error threshold. Line fits use prefix sums of the point moments, so
+ * every fit and merge test is O(1).
+ */
+class ScanSegmenter
+{
+public:
+  struct Params
+  {
+    float cluster_distance;       // minimum breakpoint distance [m]
+    float breakpoint_angle;       // lambda of the adaptive breakpoint detector [rad]
+    unsigned int max_invalid_beams;
+    unsigned int min_cluster_points;
+    float split_distance;         // split while a point is farther from the chord [m]
+    float merge_rms;              // merge while the joint rms error stays below [m]
+    unsigned int min_segment_points;
+    float min_segment_length;     // [m]
+
+    Params()
+      : cluster_distance(0.1f)
+      , breakpoint_angle(0.17f)
+      , max_invalid_beams(2)
+      , min_cluster_points(3)
+      , split_distance(0.03f)
+      , merge_rms(0.015f)
+      , min_segment_points(5)
+      , min_segment_length(0.1f)
+    {}
+  };
+
+  ScanSegmenter();
+
+  void setParams(const Params& params) { params_ = params; }
+  const Params& getParams() const { return params_; }
+
+  /// Converts the ranges to points and clusters them
+  void cluster(const std::vector<float>& ranges, float angle_min, float angle_increment, float range_min, float range_max);
+
+  /// Fits line segments to the clusters of the last cluster() call
+  void extractLines();
+
+  const std::vector<Point2>& getPoints() const { return points_; }
+  const std::vector<Cluster>& getClusters() const { return clusters_; }
+  const std::vector<Segment>& getSegments() const { return segments_; }
+
+private:
+  struct Piece
+  {
+    unsigned int first, last;   // point indices, inclusive
+  };
+
+  struct Line
+  {
+    float nx, ny, d;            // n . p = d, |n| = 1
+    float rms;
+  };
+
+  Line fit(unsigned int first, unsigned int last) const;
+  void split(unsigned int first, unsigned int last);
+  void addSegment(unsigned int cluster, const Piece& piece);
+
+  Params params_;
+
+  // sin/cos table, rebuilt when the scan geometry changes
+  std::vector<float> cos_table_, sin_table_;
+  float table_angle_min_, table_angle_increment_;
+
+  std::vector<Point2> points_;
+  std::vector<unsigned int> beams_;     // beam index of each point
+  std::vector<Cluster> clusters_;
+  std::vector<Segment> segments_;
+
+  // prefix sums of x, y, xx, xy, yy over points_
+  std::vector<double> sx_, sy_, sxx_, sxy_, syy_;
+  std::vector<Piece> pieces_;
+};
+
+}
+
+#endif
@@ -0,0 +1,137 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+
+#include <ros/ros.h>
+#include <hector_scan_codec/scan_transport.h>
+#include <hector_scan_segmentation/scan_segmenter.h>
+#include <hector_scan_segmentation/ScanSegments.h>
+#include <hector_trace/ros_trace.h>
+
+class ScanSegmentation
+{
+public:
+
+  ScanSegmentation()
+  {
+    ros::NodeHandle nh_;
+
+    ros::NodeHandle pnh_("~");
+    hector_trace::init(pnh_);
+
+    hector_scan_segmentation::ScanSegmenter::Params params;
+    double value;
+    int count;
+    pnh_.param("cluster_distance", value, static_cast<double>(params.cluster_distance)); params.cluster_distance = value;
+    pnh_.param("breakpoint_angle", value, static_cast<double>(params.breakpoint_angle)); params.breakpoint_angle = value;
+    pnh_.param("max_invalid_beams", count, static_cast<int>(params.max_invalid_beams)); params.max_invalid_beams = count;
+    pnh_.param("min_cluster_points", count, static_cast<int>(params.min_cluster_points)); params.min_cluster_points = count;
+    pnh_.param("split_distance", value, static_cast<double>(params.split_distance)); params.split_distance = value;
+    pnh_.param("merge_rms", value, static_cast<double>(params.merge_rms)); params.merge_rms = value;
+    pnh_.param("min_segment_points", count, static_cast<int>(params.min_segment_points)); params.min_segment_points = count;
+    pnh_.param("min_segment_length", value, static_cast<double>(params.min_segment_length)); params.min_segment_length = value;
+    segmenter_.setParams(params);
+
+    segments_pub_ = nh_.advertise<hector_scan_segmentation::ScanSegments>("scan_segments", 1, false);
+    scan_sub_.subscribe(nh_, "scan", 1, boost::bind(&ScanSegmentation::scanCallback, this, _1));
+  }
+
+  void scanCallback(const sensor_msgs::LaserScan::ConstPtr& scan)
+  {
+    if (segments_pub_.getNumSubscribers() == 0) return;
+
+    HECTOR_TRACE_SCOPE_ID("scan_segmentation/scan", scan->header.stamp.toNSec());
+
+    ros::WallTime start = ros::WallTime::now();
+    {
+      HECTOR_TRACE_SCOPE_ID("scan_segmentation/cluster", scan->header.stamp.toNSec());
+      segmenter_.cluster(scan->ranges, scan->angle_min, scan->angle_increment, scan->range_min, scan->range_max);
+    }
+
+    ros::WallTime clustered = ros::WallTime::now();
+    {
+      HECTOR_TRACE_SCOPE_ID("scan_segmentation/extract_lines", scan->header.stamp.toNSec());
+      segmenter_.extractLines();
+    }
+    ros::WallTime extracted = ros::WallTime::now();
+
+    const std::vector<hector_scan_segmentation::Cluster>& clusters = segmenter_.getClusters();
+    const std::vector<hector_scan_segmentation::Segment>& segments = segmenter_.getSegments();
+
+    segments_msg_.header = scan->header;
+    segments_msg_.clusters.resize(clusters.size());
+    segments_msg_.segments.resize(segments.size());
+
+    for (size_t i = 0; i < clusters.size(); ++i){
+      hector_scan_segmentation::ScanCluster& cluster = segments_msg_.clusters[i];
+      cluster.first_beam = clusters[i].first_beam;
+      cluster.last_beam = clusters[i].last_beam;
+      cluster.num_points = clusters[i].num_points;
+      cluster.centroid.x = clusters[i].centroid.x;
+      cluster.centroid.y = clusters[i].centroid.y;
+      cluster.centroid.z = 0.0f;
+      cluster.radius = clusters[i].radius;
+    }
+
+    for (size_t i = 0; i < segments.size(); ++i){
+      hector_scan_segmentation::LineSegment& segment = segments_msg_.segments[i];
+      segment.start.x = segments[i].start.x;
+      segment.start.y = segments[i].start.y;
+      segment.start.z = 0.0f;
+      segment.end.x = segments[i].end.x;
+      segment.end.y = segments[i].end.y;
+      segment.end.z = 0.0f;
+      segment.cluster = segments[i].cluster;
+      segment.first_beam = segments[i].first_beam;
+      segment.last_beam = segments[i].last_beam;
+      segment.rms_error = segments[i].rms_error;
+    }
+
+    segments_msg_.clustering_time = (clustered - start).toSec();
+    segments_msg_.line_extraction_time = (extracted - clustered).toSec();
+
+    segments_pub_.publish(segments_msg_);
+  }
+
+protected:
+  hector_scan_codec::ScanSubscriber scan_sub_;
+  ros::Publisher segments_pub_;
+
+  hector_scan_segmentation::ScanSegmenter segmenter_;
+  hector_scan_segmentation::ScanSegments segments_msg_;
+};
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "hector_scan_segmentation_node");
+
+  ScanSegmentation segmentation;
+
+  ros::spin();
+}
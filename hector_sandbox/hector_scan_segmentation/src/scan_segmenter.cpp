@@ -0,0 +1,271 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+
+#include <hector_scan_segmentation/scan_segmenter.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace hector_scan_segmentation{
+
+ScanSegmenter::ScanSegmenter()
+  : table_angle_min_(0.0f)
+  , table_angle_increment_(0.0f)
+{
+}
+
+void ScanSegmenter::cluster(const std::vector<float>& ranges, float angle_min, float angle_increment, float range_min, float range_max)
+{
+  const size_t n = ranges.size();
+
+  if (cos_table_.size() != n || table_angle_min_ != angle_min || table_angle_increment_ != angle_increment){
+    cos_table_.resize(n);
+    sin_table_.resize(n);
+    for (size_t i = 0; i < n; ++i){
+      double angle = angle_min + static_cast<double>(i) * angle_increment;
+      cos_table_[i] = std::cos(angle);
+      sin_table_[i] = std::sin(angle);
+    }
+    table_angle_min_ = angle_min;
+    table_angle_increment_ = angle_increment;
+  }
+
+  points_.clear();
+  beams_.clear();
+  clusters_.clear();
+
+  const float lambda = params_.breakpoint_angle;
+  const float increment = std::fabs(angle_increment);
+
+  bool open = false;
+  unsigned int invalid_run = 0;
+  float last_range = 0.0f;
+  Cluster current;
+
+  for (size_t i = 0; i <= n; ++i){
+    bool valid = i < n && std::isfinite(ranges[i]) && ranges[i] >= range_min && ranges[i] <= range_max;
+    bool close = i == n;
+    Point2 p;
+
+    if (valid){
+      p.x = ranges[i] * cos_table_[i];
+      p.y = ranges[i] * sin_table_[i];
+
+      if (open){
+        // adaptive breakpoint detector: the largest gap a surface inclined by lambda to the beam can cause
+        float dphi = increment * static_cast<float>(i - beams_.back());
+        float threshold = dphi < lambda ? last_range * std::sin(dphi) / std::sin(lambda - dphi) : INFINITY;
+        threshold = std::max(threshold, params_.cluster_distance);
+
+        const Point2& q = points_.back();
+        float dx = p.x - q.x, dy = p.y - q.y;
+        close = dx * dx + dy * dy > threshold * threshold;
+      }
+    }else if (open && ++invalid_run > params_.max_invalid_beams){
+      close = true;
+    }
+
+    if (open && close){
+      current.num_points = points_.size() - current.first_point;
+      current.last_beam = beams_.back();
+
+      if (current.num_points >= params_.min_cluster_points){
+        double cx = 0.0, cy = 0.0;
+        for (size_t k = current.first_point; k < points_.size(); ++k){
+          cx += points_[k].x;
+          cy += points_[k].y;
+        }
+        current.centroid.x = cx / current.num_points;
+        current.centroid.y = cy / current.num_points;
+
+        float radius2 = 0.0f;
+        for (size_t k = current.first_point; k < points_.size(); ++k){
+          float dx = points_[k].x - current.centroid.x, dy = points_[k].y - current.centroid.y;
+          radius2 = std::max(radius2, dx * dx + dy * dy);
+        }
+        current.radius = std::sqrt(radius2);
+        clusters_.push_back(current);
+      }else{
+        points_.resize(current.first_point);
+        beams_.resize(current.first_point);
+      }
+      open = false;
+    }
+
+    if (valid){
+      if (!open){
+        current.first_beam = i;
+        current.first_point = points_.size();
+        open = true;
+      }
+      points_.push_back(p);
+      beams_.push_back(i);
+      last_range = ranges[i];
+      invalid_run = 0;
+    }
+  }
+}
+
+ScanSegmenter::Line ScanSegmenter::fit(unsigned int first, unsigned int last) const
+{
+  const double n = last - first + 1;
+  const double mx = (sx_[last + 1] - sx_[first]) / n;
+  const double my = (sy_[last + 1] - sy_[first]) / n;
+  const double cxx = (sxx_[last + 1] - sxx_[first]) / n - mx * mx;
+  const double cxy = (sxy_[last + 1] - sxy_[first]) / n - mx * my;
+  const double cyy = (syy_[last + 1] - syy_[first]) / n - my * my;
+
+  // the normal is the eigenvector of the smaller eigenvalue of the covariance
+  const double half_trace = 0.5 * (cxx + cyy);
+  const double root = std::sqrt(0.25 * (cxx - cyy) * (cxx - cyy) + cxy * cxy);
+  const double lambda_min = half_trace - root;
+
+  double nx = cxy, ny = lambda_min - cxx;
+  double ax = lambda_min - cyy, ay = cxy;
+  if (ax * ax + ay * ay > nx * nx + ny * ny){
+    nx = ax;
+    ny = ay;
+  }
+  double norm = std::sqrt(nx * nx + ny * ny);
+  if (norm < 1e-12){
+    // all points identical, or a perfect line along an axis
+    nx = cxx >= cyy ? 0.0 : 1.0;
+    ny = cxx >= cyy ? 1.0 : 0.0;
+    norm = 1.0;
+  }
+
+  Line line;
+  line.nx = nx / norm;
+  line.ny = ny / norm;
+  line.d = line.nx * mx + line.ny * my;
+  line.rms = std::sqrt(std::max(0.0, lambda_min));
+  return line;
+}
+
+void ScanSegmenter::split(unsigned int first, unsigned int last)
+{
+  if (last > first + 1){
+    const Point2& a = points_[first];
+    const Point2& b = points_[last];
+    float dx = b.x - a.x, dy = b.y - a.y;
+    float length = std::sqrt(dx * dx + dy * dy);
+
+    unsigned int farthest = first;
+    float max_distance = 0.0f;
+    for (unsigned int k = first + 1; k < last; ++k){
+      const Point2& p = points_[k];
+      float distance = length > 0.0f ? std::fabs(dx * (p.y - a.y) - dy * (p.x - a.x)) / length
+                                     : std::sqrt((p.x - a.x) * (p.x - a.x) + (p.y - a.y) * (p.y - a.y));
+      if (distance > max_distance){
+        max_distance = distance;
+        farthest = k;
+      }
+    }
+
+    if (max_distance > params_.split_distance){
+      split(first, farthest);
+      split(farthest + 1, last);
+      return;
+    }
+  }
+
+  Piece piece;
+  piece.first = first;
+  piece.last = last;
+  pieces_.push_back(piece);
+}
+
+void ScanSegmenter::extractLines()
+{
+  segments_.clear();
+
+  const size_t m = points_.size();
+  sx_.resize(m + 1);
+  sy_.resize(m + 1);
+  sxx_.resize(m + 1);
+  sxy_.resize(m + 1);
+  syy_.resize(m + 1);
+  sx_[0] = sy_[0] = sxx_[0] = sxy_[0] = syy_[0] = 0.0;
+  for (size_t k = 0; k < m; ++k){
+    double x = points_[k].x, y = points_[k].y;
+    sx_[k + 1] = sx_[k] + x;
+    sy_[k + 1] = sy_[k] + y;
+    sxx_[k + 1] = sxx_[k] + x * x;
+    sxy_[k + 1] = sxy_[k] + x * y;
+    syy_[k + 1] = syy_[k] + y * y;
+  }
+
+  for (unsigned int c = 0; c < clusters_.size(); ++c){
+    const Cluster& cluster = clusters_[c];
+
+    pieces_.clear();
+    split(cluster.first_point, cluster.first_point + cluster.num_points - 1);
+
+    // merge neighbouring pieces while the joint fit is good enough
+    Piece merged = pieces_[0];
+    for (size_t k = 1; k < pieces_.size(); ++k){
+      if (fit(merged.first, pieces_[k].last).rms < params_.merge_rms){
+        merged.last = pieces_[k].last;
+      }else{
+        addSegment(c, merged);
+        merged = pieces_[k];
+      }
+    }
+    addSegment(c, merged);
+  }
+}
+
+void ScanSegmenter::addSegment(unsigned int cluster, const Piece& piece)
+{
+  if (piece.last + 1 - piece.first < params_.min_segment_points) return;
+
+  Line line = fit(piece.first, piece.last);
+
+  Segment segment;
+  const Point2& a = points_[piece.first];
+  const Point2& b = points_[piece.last];
+  float da = line.nx * a.x + line.ny * a.y - line.d;
+  float db = line.nx * b.x + line.ny * b.y - line.d;
+  segment.start.x = a.x - da * line.nx;
+  segment.start.y = a.y - da * line.ny;
+  segment.end.x = b.x - db * line.nx;
+  segment.end.y = b.y - db * line.ny;
+
+  float dx = segment.end.x - segment.start.x, dy = segment.end.y - segment.start.y;
+  if (dx * dx + dy * dy < params_.min_segment_length * params_.min_segment_length) return;
+
+  segment.cluster = cluster;
+  segment.first_beam = beams_[piece.first];
+  segment.last_beam = beams_[piece.last];
+  segment.rms_error = line.rms;
+  segments_.push_back(segment);
+}
+
+}
@@ -29,20 +29,84 @@
 
 #include "ros/ros.h"
 #include <sensor_msgs/LaserScan.h>
+#include <hector_scan_codec/scan_transport.h>
+#include <std_msgs/String.h>
+#include <hector_trace/ros_trace.h>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
 #include <vector>
 
+typedef std::pair<size_t, size_t> IndexInterval;  // [first, last)
+
+/**
+ * Constant memory statistics of one beam: a coarse range histogram and the persistence of short
+ * returns, an exponential moving average of "range below mask_max_range".
+ */
+struct BeamStatistics
+{
+  enum { NUM_BINS = 8 };
+
+  BeamStatistics()
+    : persistence(0.0f)
+    , masked(false)
+  {
+    std::fill(histogram, histogram + NUM_BINS, 0);
+  }
+
+  // bins 0-5, 5-10, 10-20, 20-40, 40-80, 80-160, 160-320, >320 cm
+  static int bin(float range)
+  {
+    int b = 0;
+    for (float upper = 0.05f; b < NUM_BINS - 1 && range >= upper; upper *= 2.0f){
+      ++b;
+    }
+    return b;
+  }
+
+  static float binCenter(int b)
+  {
+    return b == 0 ? 0.025f : 0.0375f * static_cast<float>(1 << b);
+  }
+
+  void add(float range, bool short_return, float alpha)
+  {
+    unsigned short& count = histogram[bin(range)];
+    if (count == 0xffff){
+      for (int i = 0; i < NUM_BINS; ++i){
+        histogram[i] >>= 1;
+      }
+    }
+    ++count;
+
+    persistence += alpha * ((short_return ? 1.0f : 0.0f) - persistence);
+  }
+
+  int modeBin() const
+  {
+    return std::max_element(histogram, histogram + NUM_BINS) - histogram;
+  }
+
+  unsigned short histogram[NUM_BINS];
+  float persistence;
+  bool masked;
+};
 
 class LaserScanFilter
 {
 public:
   LaserScanFilter()
+    : scans_learned_(0)
   {
     ros::NodeHandle nh;
 
-    scan_sub_ = nh.subscribe("hokuyo_scan", 1, &LaserScanFilter::scanCallback, this);
-    scan_filtered_pub_ = nh.advertise<sensor_msgs::LaserScan>("hokuyo_scan_filtered",1,false);
+    // ~scan_transport selects raw or compressed input, the output is published both ways
+    scan_sub_.subscribe(nh, "hokuyo_scan", 1, boost::bind(&LaserScanFilter::scanCallback, this, _1));
+    scan_filtered_pub_.advertise(nh, "hokuyo_scan_filtered", 1);
 
     ros::NodeHandle pnh("~");
+    hector_trace::init(pnh);
+
     XmlRpc::XmlRpcValue my_list;
     pnh.getParam("filter_index_list", my_list);
     if (my_list.getType() != XmlRpc::XmlRpcValue::TypeArray) ros::shutdown();
@@ -59,22 +123,50 @@ public:
 
       ROS_INFO("scan filter index interval %d : min: %d max: %d",i, min, max);
     }
+
+    // online mode: beams that consistently return very short ranges are masked automatically
+    pnh.param("learn_mask", p_learn_mask_, false);
+    pnh.param("apply_learned_mask", p_apply_learned_mask_, false);
+    pnh.param("mask_max_range", p_mask_max_range_, 0.3);
+    pnh.param("mask_window", p_mask_window_, 200);
+    pnh.param("mask_persistence", p_mask_persistence_, 0.9);
+    pnh.param("unmask_persistence", p_unmask_persistence_, 0.6);
+    pnh.param("mask_padding", p_mask_padding_, 2);
+    pnh.param("mask_update_interval", p_mask_update_interval_, 2.0);
+
+    if (p_learn_mask_){
+      learned_mask_pub_ = pnh.advertise<std_msgs::String>("learned_mask", 1, true);
+      ROS_INFO("learning scan filter mask from returns closer than %f m", p_mask_max_range_);
+    }
+
+    updateFilterIntervals();
   }
 
-  void scanCallback(const sensor_msgs::LaserScan& scan)
+  void scanCallback(const sensor_msgs::LaserScan::ConstPtr& scan)
   {
-    this->pubFilteredScan(scan);
+    HECTOR_TRACE_SCOPE_ID("turtlebot_scan_filter/scan", scan->header.stamp.toNSec());
+
+    if (p_learn_mask_){
+      learn(*scan);
+    }
+
+    this->pubFilteredScan(*scan);
   }
 
   void pubFilteredScan(const sensor_msgs::LaserScan& scan)
   {
     filtered_scan_ = scan;
 
-    size_t filter_indices_size = filter_indices_.size();
+    std::vector<float>& ranges = filtered_scan_.ranges;
+    const float filtered_range = scan.range_max + 1.0;
 
-    for (size_t i = 0; i < filter_indices_size; ++i)
+    size_t filter_intervals_size = filter_intervals_.size();
+
+    for (size_t i = 0; i < filter_intervals_size; ++i)
     {
-      filtered_scan_.ranges[filter_indices_[i]] = scan.range_max + 1.0;
+      size_t first = std::min(filter_intervals_[i].first, ranges.size());
+      size_t last = std::min(filter_intervals_[i].second, ranges.size());
+      std::fill(ranges.begin() + first, ranges.begin() + last, filtered_range);
     }
 
     scan_filtered_pub_.publish(filtered_scan_);
@@ -82,18 +174,156 @@ public:
 
   void addFilterIndices(size_t min, size_t max)
   {
-    for (size_t i = min; i < max; ++i){
-      filter_indices_.push_back(i);
+    if (min < max){
+      configured_intervals_.push_back(IndexInterval(min, max));
     }
   }
 
 protected:
-  ros::Subscriber scan_sub_;
-  ros::Publisher scan_filtered_pub_;
+  void learn(const sensor_msgs::LaserScan& scan)
+  {
+    if (beam_statistics_.size() != scan.ranges.size()){
+      beam_statistics_.assign(scan.ranges.size(), BeamStatistics());
+      learned_intervals_.clear();
+      scans_learned_ = 0;
+      last_mask_update_ = scan.header.stamp;
+    }
+
+    const float alpha = 1.0f / static_cast<float>(std::max(1, p_mask_window_));
+    const float mask_max_range = static_cast<float>(p_mask_max_range_);
+
+    for (size_t i = 0; i < scan.ranges.size(); ++i){
+      float range = scan.ranges[i];
+      if (!std::isfinite(range)) range = scan.range_max + 1.0f;
+
+      // returns from the robot body are often reported below range_min, they count as short as well
+      beam_statistics_[i].add(range, range < mask_max_range, alpha);
+    }
+
+    ++scans_learned_;
+
+    if (scans_learned_ >= static_cast<unsigned int>(p_mask_window_) &&
+        (scan.header.stamp - last_mask_update_).toSec() >= p_mask_update_interval_){
+      last_mask_update_ = scan.header.stamp;
+      updateLearnedMask();
+    }
+  }
+
+  void updateLearnedMask()
+  {
+    // hysteresis per beam
+    for (size_t i = 0; i < beam_statistics_.size(); ++i){
+      BeamStatistics& beam = beam_statistics_[i];
+      if (!beam.masked && beam.persistence >= p_mask_persistence_){
+        beam.masked = true;
+      }else if (beam.masked && beam.persistence < p_unmask_persistence_){
+        beam.masked = false;
+      }
+    }
+
+    // intervals of masked beams, widened by the padding and merged if they touch
+    std::vector<IndexInterval> intervals;
+    const size_t padding = static_cast<size_t>(std::max(0, p_mask_padding_));
+    const size_t num_beams = beam_statistics_.size();
+
+    for (size_t i = 0; i < num_beams; ){
+      if (!beam_statistics_[i].masked){
+        ++i;
+        continue;
+      }
+
+      size_t last = i;
+      while (last < num_beams && beam_statistics_[last].masked) ++last;
+
+      IndexInterval interval(i > padding ? i - padding : 0, std::min(num_beams, last + padding));
+      if (!intervals.empty() && interval.first <= intervals.back().second){
+        intervals.back().second = interval.second;
+      }else{
+        intervals.push_back(interval);
+      }
+      i = last;
+    }
+
+    if (intervals == learned_intervals_) return;
+
+    learned_intervals_.swap(intervals);
+    publishLearnedMask();
+    updateFilterIntervals();
+  }
+
+  void publishLearnedMask()
+  {
+    // YAML in the format of config/default.yaml, so a reviewed mask can be copied there
+    std::stringstream yaml;
+    yaml << "filter_index_list : [";
+
+    XmlRpc::XmlRpcValue list;
+    list.setSize(learned_intervals_.size());
+
+    for (size_t i = 0; i < learned_intervals_.size(); ++i){
+      const IndexInterval& interval = learned_intervals_[i];
+      yaml << (i ? ", " : "") << "[" << interval.first << ", " << interval.second << "]";
+
+      list[i].setSize(2);
+      list[i][0] = static_cast<int>(interval.first);
+      list[i][1] = static_cast<int>(interval.second);
+
+      // typical range of the interval from the histogram of its center beam, for review
+      const BeamStatistics& center = beam_statistics_[(interval.first + interval.second) / 2];
+      ROS_INFO("learned scan filter interval %u : min: %u max: %u, typical range %.3f m, persistence %.2f",
+               static_cast<unsigned int>(i), static_cast<unsigned int>(interval.first), static_cast<unsigned int>(interval.second),
+               BeamStatistics::binCenter(center.modeBin()), center.persistence);
+    }
+    yaml << "]";
+
+    ros::NodeHandle("~").setParam("learned_filter_index_list", list);
+
+    std_msgs::String msg;
+    msg.data = yaml.str();
+    learned_mask_pub_.publish(msg);
+  }
+
+  void updateFilterIntervals()
+  {
+    std::vector<IndexInterval> intervals(configured_intervals_);
+    if (p_apply_learned_mask_){
+      intervals.insert(intervals.end(), learned_intervals_.begin(), learned_intervals_.end());
+    }
+
+    // sorted and merged, so every beam is written at most once per scan
+    std::sort(intervals.begin(), intervals.end());
+    filter_intervals_.clear();
+    for (size_t i = 0; i < intervals.size(); ++i){
+      if (!filter_intervals_.empty() && intervals[i].first <= filter_intervals_.back().second){
+        filter_intervals_.back().second = std::max(filter_intervals_.back().second, intervals[i].second);
+      }else{
+        filter_intervals_.push_back(intervals[i]);
+      }
+    }
+  }
+
+  hector_scan_codec::ScanSubscriber scan_sub_;
+  hector_scan_codec::ScanPublisher scan_filtered_pub_;
+  ros::Publisher learned_mask_pub_;
 
   sensor_msgs::LaserScan filtered_scan_;
 
-  std::vector<size_t> filter_indices_;
+  std::vector<IndexInterval> configured_intervals_;
+  std::vector<IndexInterval> learned_intervals_;
+  std::vector<IndexInterval> filter_intervals_;
+
+  std::vector<BeamStatistics> beam_statistics_;
+  unsigned int scans_learned_;
+  ros::Time last_mask_update_;
+
+  bool p_learn_mask_;
+  bool p_apply_learned_mask_;
+  double p_mask_max_range_;
+  int p_mask_window_;
+  double p_mask_persistence_;
+  double p_unmask_persistence_;
+  int p_mask_padding_;
+  double p_mask_update_interval_;
 };
 
 int main(int argc, char **argv)
@@ -0,0 +1,115 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef hector_lc_arm_reachability_reachability_map_h__
+#define hector_lc_arm_reachability_reachability_map_h__
+
+#include <Eigen/Core>
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace hector_lc_arm_reachability{
+
+/**
+ * File header of a reachability map. The header is followed by one 64 bit orientation mask per voxel,
+ * x index fastest. Bit b of a mask is set if the effector reached the voxel with its approach axis in
+ * orientation bin b.
+ */
+struct ReachabilityMapHeader
+{
+  char magic[8];            // "HRMAP01"
+  uint32_t size_x;
+  uint32_t size_y;
+  uint32_t size_z;
+  uint32_t num_orientation_bins;
+  double resolution;
+  double origin[3];         // position of the corner of voxel (0,0,0) in the base frame
+  uint64_t num_samples;
+  char base_link[64];
+  char tip_link[64];
+};
+
+/**
+ * Voxelized reachability map with approach direction bins, for constant time pruning of grasp targets.
+ *
+ * Approach directions are binned on a cube map with 3x3 cells per face (54 bins), so the orientation
+ * set of a voxel fits into one 64 bit word. The map file is memory mapped on load; queries are an
+ * index computation and a bit test.
+ */
+class ReachabilityMap
+{
+public:
+  enum { BINS_PER_FACE_SIDE = 3, NUM_ORIENTATION_BINS = 6 * BINS_PER_FACE_SIDE * BINS_PER_FACE_SIDE };
+
+  ReachabilityMap();
+  ~ReachabilityMap();
+
+  /// Memory maps a map file. Returns false if the file cannot be opened or is not a reachability map.
+  bool load(const std::string& filename);
+  void unload();
+
+  bool isLoaded() const { return masks_ != 0; }
+  const ReachabilityMapHeader& getHeader() const { return *header_; }
+
+  /// Position relative to the arm base. False outside the map.
+  bool isReachable(const Eigen::Vector3d& position) const;
+
+  /// Position and approach direction (unit vector) relative to the arm base.
+  bool isReachable(const Eigen::Vector3d& position, const Eigen::Vector3d& approach) const;
+
+  /// Fraction of orientation bins reached in the voxel, 0 outside the map
+  double getCapability(const Eigen::Vector3d& position) const;
+
+  /// Orientation mask of the voxel containing position, 0 outside the map
+  uint64_t getOrientationMask(const Eigen::Vector3d& position) const;
+
+  /// Cube map bin of a (not necessarily normalized) direction
+  static int getOrientationBin(const Eigen::Vector3d& direction);
+
+  /// Writes a map file from a filled header and header.size_x * size_y * size_z masks.
+  static bool write(const std::string& filename, const ReachabilityMapHeader& header, const std::vector<uint64_t>& masks);
+
+protected:
+  inline long getVoxelIndex(const Eigen::Vector3d& position) const;
+
+  void* mapping_;
+  size_t mapping_size_;
+
+  const ReachabilityMapHeader* header_;
+  const uint64_t* masks_;
+
+  double inverse_resolution_;
+};
+
+}
+
+#endif
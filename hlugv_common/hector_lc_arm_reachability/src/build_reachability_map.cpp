@@ -0,0 +1,166 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <ros/ros.h>
+#include <urdf/model.h>
+
+#include <hector_batch_kinematics/urdf_loader.h>
+#include <hector_lc_arm_reachability/reachability_map.h>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#include <cmath>
+#include <cstring>
+
+/**
+ * Samples the joint space of the arm and writes a reachability map file.
+ */
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "build_reachability_map");
+
+  ros::NodeHandle pnh("~");
+
+  std::string base_link;
+  std::string tip_link;
+  std::string output_file;
+  double resolution;
+  int approach_axis;
+  int num_samples;
+  int batch_size;
+
+  pnh.param("base_link", base_link, std::string("arm_base_link"));
+  pnh.param("tip_link", tip_link, std::string("endeffector_yaw_link"));
+  pnh.param("output_file", output_file, std::string("hector_lc_arm_reachability.map"));
+  pnh.param("resolution", resolution, 0.02);
+  pnh.param("approach_axis", approach_axis, 0);
+  pnh.param("num_samples", num_samples, 5000000);
+  pnh.param("batch_size", batch_size, 100000);
+
+  if (approach_axis < 0 || approach_axis > 2){
+    ROS_ERROR("approach_axis has to be 0 (x), 1 (y) or 2 (z)");
+    return 1;
+  }
+
+  urdf::Model urdf_model;
+
+  if (!urdf_model.initParam("robot_description")){
+    ROS_ERROR("Could not read robot_description from parameter server");
+    return 1;
+  }
+
+  hector_batch_kinematics::KinematicModel model;
+
+  if (!hector_batch_kinematics::loadFromUrdf(urdf_model, model, base_link, tip_link)){
+    return 1;
+  }
+
+  // the chain cannot reach further than the sum of its link offsets
+  double reach = 0.0;
+  for (boost::shared_ptr<const urdf::Link> link = urdf_model.getLink(tip_link); link && link->name != base_link; link = link->getParent()){
+    const urdf::Vector3& offset = link->parent_joint->parent_to_joint_origin_transform.position;
+    reach += std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+  }
+
+  hector_lc_arm_reachability::ReachabilityMapHeader header;
+  std::memset(&header, 0, sizeof(header));
+
+  uint32_t size = static_cast<uint32_t>(std::ceil(2.0 * reach / resolution)) + 1;
+  header.size_x = header.size_y = header.size_z = size;
+  header.resolution = resolution;
+  header.origin[0] = header.origin[1] = header.origin[2] = -0.5 * size * resolution;
+  header.num_samples = num_samples;
+  strncpy(header.base_link, base_link.c_str(), sizeof(header.base_link) - 1);
+  strncpy(header.tip_link, tip_link.c_str(), sizeof(header.tip_link) - 1);
+
+  std::vector<uint64_t> masks (static_cast<size_t>(size) * size * size, 0);
+
+  ROS_INFO("Sampling %d configurations of %d joints, map of %u^3 voxels at %f m", num_samples, static_cast<int>(model.getNumVariables()), size, resolution);
+
+  size_t num_variables = model.getNumVariables();
+  size_t tip = model.getNumLinks() - 1;
+  std::vector<double> q (static_cast<size_t>(batch_size) * num_variables);
+  std::vector<hector_batch_kinematics::Transform> poses (batch_size);
+
+  boost::mt19937 rng;
+  boost::uniform_real<> unit_distribution (0.0, 1.0);
+  boost::variate_generator<boost::mt19937&, boost::uniform_real<> > unit (rng, unit_distribution);
+
+  const double inverse_resolution = 1.0 / resolution;
+
+  for (int sampled = 0; sampled < num_samples && ros::ok(); sampled += batch_size){
+    size_t count = std::min(batch_size, num_samples - sampled);
+
+    for (size_t i = 0; i < count; ++i){
+      for (size_t j = 0; j < num_variables; ++j){
+        double lower = model.getVariableLower(j);
+        q[i * num_variables + j] = lower + (model.getVariableUpper(j) - lower) * unit();
+      }
+    }
+
+    model.computeBatch(&q[0], count, tip, &poses[0]);
+
+    for (size_t i = 0; i < count; ++i){
+      const hector_batch_kinematics::Transform& pose = poses[i];
+
+      long x = static_cast<long>((pose.translation[0] - header.origin[0]) * inverse_resolution);
+      long y = static_cast<long>((pose.translation[1] - header.origin[1]) * inverse_resolution);
+      long z = static_cast<long>((pose.translation[2] - header.origin[2]) * inverse_resolution);
+
+      if (x < 0 || y < 0 || z < 0 || x >= size || y >= size || z >= size){
+        continue;
+      }
+
+      // approach axis is a column of the row major rotation
+      Eigen::Vector3d approach (pose.rotation[approach_axis], pose.rotation[3 + approach_axis], pose.rotation[6 + approach_axis]);
+      int bin = hector_lc_arm_reachability::ReachabilityMap::getOrientationBin(approach);
+
+      masks[(z * size + y) * size + x] |= static_cast<uint64_t>(1) << bin;
+    }
+
+    ROS_INFO("%d / %d samples", sampled + static_cast<int>(count), num_samples);
+  }
+
+  size_t reachable = 0;
+  for (size_t i = 0; i < masks.size(); ++i){
+    if (masks[i]){
+      ++reachable;
+    }
+  }
+
+  if (!hector_lc_arm_reachability::ReachabilityMap::write(output_file, header, masks)){
+    ROS_ERROR("Could not write %s", output_file.c_str());
+    return 1;
+  }
+
+  ROS_INFO("Wrote %s: %d of %d voxels reachable", output_file.c_str(), static_cast<int>(reachable), static_cast<int>(masks.size()));
+  return 0;
+}
@@ -0,0 +1,217 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <hector_lc_arm_reachability/reachability_map.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace hector_lc_arm_reachability{
+
+static const char kMagic[8] = "HRMAP01";
+
+ReachabilityMap::ReachabilityMap()
+  : mapping_(0)
+  , mapping_size_(0)
+  , header_(0)
+  , masks_(0)
+  , inverse_resolution_(0.0)
+{}
+
+ReachabilityMap::~ReachabilityMap()
+{
+  unload();
+}
+
+bool ReachabilityMap::load(const std::string& filename)
+{
+  unload();
+
+  int fd = open(filename.c_str(), O_RDONLY);
+
+  if (fd < 0){
+    return false;
+  }
+
+  struct stat file_stat;
+
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(sizeof(ReachabilityMapHeader))){
+    close(fd);
+    return false;
+  }
+
+  void* mapping = mmap(0, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (mapping == MAP_FAILED){
+    return false;
+  }
+
+  const ReachabilityMapHeader* header = static_cast<const ReachabilityMapHeader*>(mapping);
+  size_t num_voxels = static_cast<size_t>(header->size_x) * header->size_y * header->size_z;
+
+  if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header->num_orientation_bins != NUM_ORIENTATION_BINS ||
+      !(header->resolution > 0.0 && header->resolution < std::numeric_limits<double>::infinity()) ||
+      static_cast<size_t>(file_stat.st_size) != sizeof(ReachabilityMapHeader) + num_voxels * sizeof(uint64_t)){
+    munmap(mapping, file_stat.st_size);
+    return false;
+  }
+
+  mapping_ = mapping;
+  mapping_size_ = file_stat.st_size;
+  header_ = header;
+  masks_ = reinterpret_cast<const uint64_t*>(static_cast<const char*>(mapping) + sizeof(ReachabilityMapHeader));
+  inverse_resolution_ = 1.0 / header->resolution;
+
+  return true;
+}
+
+void ReachabilityMap::unload()
+{
+  if (mapping_){
+    munmap(mapping_, mapping_size_);
+  }
+
+  mapping_ = 0;
+  mapping_size_ = 0;
+  header_ = 0;
+  masks_ = 0;
+}
+
+inline long ReachabilityMap::getVoxelIndex(const Eigen::Vector3d& position) const
+{
+  if (!masks_){
+    return -1;
+  }
+
+  double fx = (position.x() - header_->origin[0]) * inverse_resolution_;
+  double fy = (position.y() - header_->origin[1]) * inverse_resolution_;
+  double fz = (position.z() - header_->origin[2]) * inverse_resolution_;
+
+  // also rejects NaN
+  if (!(fx >= 0.0 && fy >= 0.0 && fz >= 0.0 && fx < header_->size_x && fy < header_->size_y && fz < header_->size_z)){
+    return -1;
+  }
+
+  long x = static_cast<long>(fx);
+  long y = static_cast<long>(fy);
+  long z = static_cast<long>(fz);
+
+  return (z * header_->size_y + y) * header_->size_x + x;
+}
+
+bool ReachabilityMap::isReachable(const Eigen::Vector3d& position) const
+{
+  long index = getVoxelIndex(position);
+  return index >= 0 && masks_[index] != 0;
+}
+
+bool ReachabilityMap::isReachable(const Eigen::Vector3d& position, const Eigen::Vector3d& approach) const
+{
+  long index = getVoxelIndex(position);
+  return index >= 0 && (masks_[index] & (static_cast<uint64_t>(1) << getOrientationBin(approach))) != 0;
+}
+
+double ReachabilityMap::getCapability(const Eigen::Vector3d& position) const
+{
+  return static_cast<double>(__builtin_popcountll(getOrientationMask(position))) / NUM_ORIENTATION_BINS;
+}
+
+uint64_t ReachabilityMap::getOrientationMask(const Eigen::Vector3d& position) const
+{
+  long index = getVoxelIndex(position);
+  return index >= 0 ? masks_[index] : 0;
+}
+
+int ReachabilityMap::getOrientationBin(const Eigen::Vector3d& direction)
+{
+  double ax = std::abs(direction.x());
+  double ay = std::abs(direction.y());
+  double az = std::abs(direction.z());
+
+  // face: +x -x +y -y +z -z, (u, v) are the remaining coordinates divided by the major one
+  int face;
+  double u, v, major;
+
+  if (ax >= ay && ax >= az){
+    face = direction.x() >= 0.0 ? 0 : 1;
+    major = ax; u = direction.y(); v = direction.z();
+  }else if (ay >= az){
+    face = direction.y() >= 0.0 ? 2 : 3;
+    major = ay; u = direction.x(); v = direction.z();
+  }else{
+    face = direction.z() >= 0.0 ? 4 : 5;
+    major = az; u = direction.x(); v = direction.y();
+  }
+
+  if (major <= 0.0){
+    return 0;
+  }
+
+  int cu = static_cast<int>((u / major + 1.0) * 0.5 * BINS_PER_FACE_SIDE);
+  int cv = static_cast<int>((v / major + 1.0) * 0.5 * BINS_PER_FACE_SIDE);
+  cu = cu < 0 ? 0 : (cu >= BINS_PER_FACE_SIDE ? BINS_PER_FACE_SIDE - 1 : cu);
+  cv = cv < 0 ? 0 : (cv >= BINS_PER_FACE_SIDE ? BINS_PER_FACE_SIDE - 1 : cv);
+
+  return (face * BINS_PER_FACE_SIDE + cv) * BINS_PER_FACE_SIDE + cu;
+}
+
+bool ReachabilityMap::write(const std::string& filename, const ReachabilityMapHeader& header, const std::vector<uint64_t>& masks)
+{
+  size_t num_voxels = static_cast<size_t>(header.size_x) * header.size_y * header.size_z;
+
+  if (masks.size() != num_voxels){
+    return false;
+  }
+
+  FILE* file = fopen(filename.c_str(), "wb");
+
+  if (!file){
+    return false;
+  }
+
+  ReachabilityMapHeader file_header (header);
+  std::memcpy(file_header.magic, kMagic, sizeof(kMagic));
+  file_header.num_orientation_bins = NUM_ORIENTATION_BINS;
+
+  bool ok = fwrite(&file_header, sizeof(file_header), 1, file) == 1 &&
+            (num_voxels == 0 || fwrite(&masks[0], sizeof(uint64_t), num_voxels, file) == num_voxels);
+
+  return fclose(file) == 0 && ok;
+}
+
+}
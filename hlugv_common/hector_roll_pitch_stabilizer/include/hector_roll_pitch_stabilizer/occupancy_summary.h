@@ -0,0 +1,116 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef hector_roll_pitch_stabilizer_occupancy_summary_h__
+#define hector_roll_pitch_stabilizer_occupancy_summary_h__
+
+#include <vector>
+#include <stdint.h>
+
+namespace hector_roll_pitch_stabilizer{
+
+struct Point3
+{
+  float x, y, z;
+
+  Point3() : x(0.0f), y(0.0f), z(0.0f) {}
+  Point3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+};
+
+/**
+ * Coarse voxel summary of the space around the robot, used to plan 3D scan sweeps.
+ *
+ * Cells are only classified as unknown, free or occupied. Scans are inserted as rays in a fixed
+ * frame; a planned sensor pose is rated by the number of unknown cells its rays would pass through
+ * before hitting an occupied cell. Cells already claimed by an accepted pose of the current plan
+ * are not counted again, so consecutive evaluations give the information gain of a pose in
+ * addition to the poses accepted before.
+ */
+class OccupancySummary
+{
+public:
+  enum State { UNKNOWN = 0, FREE = 1, OCCUPIED = 2 };
+
+  OccupancySummary(float resolution = 0.25f, float size_xy = 20.0f, float size_z = 5.0f);
+
+  /// The grid stays in place until center is more than a quarter of the grid size away from the
+  /// current center, then it is cleared and recentered on center
+  void setCenter(const Point3& center);
+  const Point3& getCenter() const { return center_; }
+
+  void clear();
+
+  /// Marks the cells between origin and end as free and the end cell as occupied if hit is set
+  void insertRay(const Point3& origin, const Point3& end, bool hit);
+
+  /// Starts a new plan, no cells are claimed
+  void beginPlan();
+
+  /// Adds the unknown, unclaimed cells along a ray to the current candidate
+  void evaluateRay(const Point3& origin, const Point3& direction, float max_range);
+
+  /// Number of cells collected since the last acceptCandidate() / rejectCandidate()
+  unsigned int getCandidateGain() const { return candidate_.size(); }
+
+  /// Claims (accept) or forgets (reject) the cells of the current candidate
+  void acceptCandidate();
+  void rejectCandidate();
+
+  unsigned int getNumKnownCells() const { return known_cells_; }
+  unsigned int getNumCells() const { return cells_.size(); }
+
+private:
+  template <typename Visitor>
+  void traverse(const Point3& origin, const Point3& end, Visitor& visitor) const;
+
+  struct InsertVisitor;
+  struct EvaluateVisitor;
+  friend struct InsertVisitor;
+  friend struct EvaluateVisitor;
+
+  float resolution_;
+  int size_[3];
+  Point3 center_;
+  Point3 min_;                        // corner of cell (0,0,0)
+
+  std::vector<uint8_t> cells_;
+  unsigned int known_cells_;
+
+  // claims are stamped with the plan id, candidate cells with the candidate id, so neither has to
+  // be cleared between evaluations
+  std::vector<uint32_t> claimed_;
+  std::vector<uint32_t> visited_;
+  uint32_t plan_id_;
+  uint32_t candidate_id_;
+  std::vector<unsigned int> candidate_;
+};
+
+}
+
+#endif
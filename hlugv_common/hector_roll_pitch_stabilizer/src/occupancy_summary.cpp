@@ -0,0 +1,217 @@
+//=================================================================================================
+// Copyright (c) 2012, Stefan Kohlbrecher, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Simulation, Systems Optimization and Robotics
+//       group, TU Darmstadt nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <hector_roll_pitch_stabilizer/occupancy_summary.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace hector_roll_pitch_stabilizer{
+
+OccupancySummary::OccupancySummary(float resolution, float size_xy, float size_z)
+  : resolution_(resolution)
+  , known_cells_(0)
+  , plan_id_(1)
+  , candidate_id_(1)
+{
+  size_[0] = size_[1] = std::max(1, static_cast<int>(std::ceil(size_xy / resolution)));
+  size_[2] = std::max(1, static_cast<int>(std::ceil(size_z / resolution)));
+
+  unsigned int num_cells = size_[0] * size_[1] * size_[2];
+  cells_.assign(num_cells, UNKNOWN);
+  claimed_.assign(num_cells, 0);
+  visited_.assign(num_cells, 0);
+
+  setCenter(Point3());
+}
+
+void OccupancySummary::setCenter(const Point3& center)
+{
+  float dx = center.x - center_.x;
+  float dy = center.y - center_.y;
+  float dz = center.z - center_.z;
+
+  if (std::fabs(dx) > 0.25f * size_[0] * resolution_ ||
+      std::fabs(dy) > 0.25f * size_[1] * resolution_ ||
+      std::fabs(dz) > 0.25f * size_[2] * resolution_){
+    clear();
+    center_ = center;
+  }
+
+  min_.x = center_.x - 0.5f * size_[0] * resolution_;
+  min_.y = center_.y - 0.5f * size_[1] * resolution_;
+  min_.z = center_.z - 0.5f * size_[2] * resolution_;
+}
+
+void OccupancySummary::clear()
+{
+  std::fill(cells_.begin(), cells_.end(), static_cast<uint8_t>(UNKNOWN));
+  known_cells_ = 0;
+}
+
+// Amanatides & Woo voxel traversal. The visitor is called with the index of every cell between
+// origin and end inside the grid and stops the traversal by returning false.
+template <typename Visitor>
+void OccupancySummary::traverse(const Point3& origin, const Point3& end, Visitor& visitor) const
+{
+  const float o[3] = { (origin.x - min_.x) / resolution_, (origin.y - min_.y) / resolution_, (origin.z - min_.z) / resolution_ };
+  const float e[3] = { (end.x - min_.x) / resolution_, (end.y - min_.y) / resolution_, (end.z - min_.z) / resolution_ };
+
+  // clip the segment to the grid
+  float t_enter = 0.0f, t_exit = 1.0f;
+  for (int k = 0; k < 3; ++k){
+    float d = e[k] - o[k];
+    if (std::fabs(d) < 1e-9f){
+      if (o[k] < 0.0f || o[k] >= size_[k]) return;
+      continue;
+    }
+    float t0 = (0.0f - o[k]) / d;
+    float t1 = (size_[k] - o[k]) / d;
+    if (t0 > t1) std::swap(t0, t1);
+    t_enter = std::max(t_enter, t0);
+    t_exit = std::min(t_exit, t1);
+  }
+  if (t_enter > t_exit) return;
+
+  int cell[3], last[3], step[3];
+  float t_max[3], t_delta[3];
+  for (int k = 0; k < 3; ++k){
+    float d = e[k] - o[k];
+    float p = o[k] + t_enter * d;
+    cell[k] = std::min(std::max(static_cast<int>(std::floor(p)), 0), size_[k] - 1);
+    last[k] = std::min(std::max(static_cast<int>(std::floor(o[k] + t_exit * d)), 0), size_[k] - 1);
+
+    if (d > 0.0f){
+      step[k] = 1;
+      t_delta[k] = 1.0f / d;
+      t_max[k] = t_enter + (cell[k] + 1 - p) / d;
+    } else if (d < 0.0f){
+      step[k] = -1;
+      t_delta[k] = -1.0f / d;
+      t_max[k] = t_enter + (cell[k] - p) / d;
+    } else {
+      step[k] = 0;
+      t_delta[k] = t_max[k] = std::numeric_limits<float>::max();
+    }
+  }
+
+  const int stride_y = size_[0];
+  const int stride_z = size_[0] * size_[1];
+
+  for (;;){
+    if (!visitor(cell[0] + cell[1] * stride_y + cell[2] * stride_z)) return;
+    if (cell[0] == last[0] && cell[1] == last[1] && cell[2] == last[2]) return;
+
+    int k = (t_max[0] < t_max[1]) ? (t_max[0] < t_max[2] ? 0 : 2) : (t_max[1] < t_max[2] ? 1 : 2);
+    if (t_max[k] > t_exit) return;
+    cell[k] += step[k];
+    if (cell[k] < 0 || cell[k] >= size_[k]) return;
+    t_max[k] += t_delta[k];
+  }
+}
+
+struct OccupancySummary::InsertVisitor
+{
+  OccupancySummary& summary;
+  int end_cell;
+
+  bool operator()(int index)
+  {
+    uint8_t& cell = summary.cells_[index];
+    if (cell == UNKNOWN) ++summary.known_cells_;
+    if (index == end_cell){
+      cell = OCCUPIED;
+    } else if (cell != OCCUPIED){
+      cell = FREE;
+    }
+    return true;
+  }
+};
+
+struct OccupancySummary::EvaluateVisitor
+{
+  OccupancySummary& summary;
+
+  bool operator()(int index)
+  {
+    uint8_t cell = summary.cells_[index];
+    if (cell == OCCUPIED) return false;
+    if (cell == UNKNOWN && summary.claimed_[index] != summary.plan_id_ && summary.visited_[index] != summary.candidate_id_){
+      summary.visited_[index] = summary.candidate_id_;
+      summary.candidate_.push_back(index);
+    }
+    return true;
+  }
+};
+
+void OccupancySummary::insertRay(const Point3& origin, const Point3& end, bool hit)
+{
+  InsertVisitor visitor = { *this, -1 };
+
+  if (hit){
+    int x = static_cast<int>(std::floor((end.x - min_.x) / resolution_));
+    int y = static_cast<int>(std::floor((end.y - min_.y) / resolution_));
+    int z = static_cast<int>(std::floor((end.z - min_.z) / resolution_));
+    if (x >= 0 && x < size_[0] && y >= 0 && y < size_[1] && z >= 0 && z < size_[2]){
+      visitor.end_cell = x + y * size_[0] + z * size_[0] * size_[1];
+    }
+  }
+
+  traverse(origin, end, visitor);
+}
+
+void OccupancySummary::beginPlan()
+{
+  ++plan_id_;
+  rejectCandidate();
+}
+
+void OccupancySummary::evaluateRay(const Point3& origin, const Point3& direction, float max_range)
+{
+  Point3 end(origin.x + direction.x * max_range, origin.y + direction.y * max_range, origin.z + direction.z * max_range);
+  EvaluateVisitor visitor = { *this };
+  traverse(origin, end, visitor);
+}
+
+void OccupancySummary::acceptCandidate()
+{
+  for (std::vector<unsigned int>::const_iterator it = candidate_.begin(); it != candidate_.end(); ++it){
+    claimed_[*it] = plan_id_;
+  }
+  rejectCandidate();
+}
+
+void OccupancySummary::rejectCandidate()
+{
+  candidate_.clear();
+  ++candidate_id_;
+}
+
+}
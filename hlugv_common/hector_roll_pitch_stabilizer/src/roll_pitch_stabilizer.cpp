@@ -28,10 +28,23 @@
 
 
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 #include <tf/transform_listener.h>
+#include <tf/transform_broadcaster.h>
 #include <std_msgs/Float64.h>
+#include <sensor_msgs/JointState.h>
+#include <sensor_msgs/LaserScan.h>
+#include <urdf/model.h>
+#include <hector_trace/ros_trace.h>
+#include <hector_realtime/ros_realtime.h>
+#include <boost/thread.hpp>
 #include <string>
+#include <deque>
+#include <vector>
+#include <cmath>
+#include <algorithm>
 #include "hector_roll_pitch_stabilizer/DoScan.h"
+#include "hector_roll_pitch_stabilizer/occupancy_summary.h"
 
 std::string p_base_frame_;
 std::string p_base_stabilized_frame_;
@@ -44,9 +57,74 @@ ros::Publisher pub_desired_roll_angle_;
 ros::Publisher pub_desired_pitch_angle_;
 ros::ServiceServer scan_server_;
 
+// the control loop and the scan service thread both command the mount; stabilizer_mutex_ guards
+// transform_, the desired angle messages and updatesEnabled
+boost::mutex stabilizer_mutex_;
 bool updatesEnabled = true;
 
-void stabilize() {
+// preallocated so the control loop does not allocate messages
+std_msgs::Float64 desired_roll_msg_;
+std_msgs::Float64 desired_pitch_msg_;
+
+hector_realtime::RealtimeConfig realtime_config_;
+hector_realtime::PeriodicLoop* realtime_loop_ = 0;
+
+// actual mount pose, published directly from the joint feedback instead of going through
+// joint_states -> robot_state_publisher -> tf
+struct MountJoint {
+  std::string name;
+  std::string parent_frame;
+  std::string child_frame;
+  tf::Transform origin;
+  tf::Vector3 axis;
+  double position;
+  bool valid;
+};
+
+struct MountSample {
+  ros::Time stamp;
+  double roll;
+  double pitch;
+};
+
+bool p_publish_mount_transform_;
+double p_mount_buffer_duration_;
+double p_max_extrapolation_;
+
+MountJoint roll_joint_;
+MountJoint pitch_joint_;
+std::deque<MountSample> mount_samples_;
+
+tf::TransformBroadcaster* tfB_ = 0;
+std::vector<tf::StampedTransform> mount_transforms_;
+ros::Subscriber joint_state_sub_;
+ros::Subscriber scan_sub_;
+
+// adaptive sweep planning: a coarse occupancy summary built from the incoming scans decides which
+// mount angles of a DoScan request are worth a stop
+bool p_adaptive_sweep_;
+std::string p_fixed_frame_;
+double p_sweep_max_range_;
+double p_sweep_max_velocity_;
+int p_sweep_beams_;
+int p_sweep_min_gain_;
+int p_summary_beam_step_;
+
+hector_roll_pitch_stabilizer::OccupancySummary* occupancy_summary_ = 0;
+boost::mutex occupancy_mutex_;
+// copy of the summary the scan service plans on, so scanCallback is not blocked while planning
+hector_roll_pitch_stabilizer::OccupancySummary* planning_summary_ = 0;
+std::string scan_frame_;
+double scan_angle_min_ = 0.0;
+double scan_angle_max_ = 0.0;
+
+// the scan service blocks for the whole sweep, so it is served by its own thread
+ros::CallbackQueue scan_service_queue_;
+
+// Requires stabilizer_mutex_ to be held.
+void stabilizeLocked() {
+  HECTOR_TRACE_SCOPE("roll_pitch_stabilizer/stabilize");
+
   try
   {
       tfL_->lookupTransform(p_base_frame_, p_base_stabilized_frame_, ros::Time(0), transform_);
@@ -54,13 +132,11 @@ void stabilize() {
       tfScalar yaw, pitch, roll;
       transform_.getBasis().getEulerYPR(yaw, pitch, roll);
 
-      std_msgs::Float64 tmp;
-
-      tmp.data = -roll;
-      pub_desired_roll_angle_.publish(tmp);
+      desired_roll_msg_.data = -roll;
+      pub_desired_roll_angle_.publish(desired_roll_msg_);
 
-      tmp.data = -pitch;
-      pub_desired_pitch_angle_.publish(tmp);    
+      desired_pitch_msg_.data = -pitch;
+      pub_desired_pitch_angle_.publish(desired_pitch_msg_);
   }
   catch(tf::TransformException e)
   {
@@ -69,15 +145,376 @@ void stabilize() {
   }
 }
 
+void stabilize() {
+  boost::mutex::scoped_lock lock(stabilizer_mutex_);
+  stabilizeLocked();
+}
+
+// skipped while the scan service moves the mount
+void stabilizeIfEnabled() {
+  boost::mutex::scoped_lock lock(stabilizer_mutex_);
+  if ( updatesEnabled ) {
+    stabilizeLocked();
+  }
+}
+
+void setUpdatesEnabled(bool enabled) {
+  boost::mutex::scoped_lock lock(stabilizer_mutex_);
+  updatesEnabled = enabled;
+}
+
 void updateTimerCallback(const ros::TimerEvent& event)
 {
-  if ( updatesEnabled ) {
-    stabilize();
+  stabilizeIfEnabled();
+}
+
+// control loop in its own thread, used in real-time mode instead of the update timer
+void realtimeLoop() {
+  hector_realtime::applyConfig(realtime_config_);
+
+  while (ros::ok()) {
+    realtime_loop_->sleep();
+
+    stabilizeIfEnabled();
+  }
+}
+
+void jitterReportCallback(const ros::TimerEvent& event)
+{
+  ROS_INFO("Control loop wake-up latency: %s", realtime_loop_->getHistogram().toString().c_str());
+}
+
+bool initMountJoint(const urdf::Model& model, const std::string& name, MountJoint& joint) {
+  boost::shared_ptr<const urdf::Joint> urdf_joint = model.getJoint(name);
+  if (!urdf_joint) {
+    ROS_ERROR("Mount joint %s not found in robot_description", name.c_str());
+    return false;
+  }
+
+  const urdf::Pose& pose = urdf_joint->parent_to_joint_origin_transform;
+  double x, y, z, w;
+  pose.rotation.getQuaternion(x, y, z, w);
+
+  joint.name = name;
+  joint.parent_frame = urdf_joint->parent_link_name;
+  joint.child_frame = urdf_joint->child_link_name;
+  joint.origin = tf::Transform(tf::Quaternion(x, y, z, w), tf::Vector3(pose.position.x, pose.position.y, pose.position.z));
+  joint.axis = tf::Vector3(urdf_joint->axis.x, urdf_joint->axis.y, urdf_joint->axis.z);
+  joint.position = 0.0;
+  joint.valid = false;
+  return true;
+}
+
+void setMountTransform(const MountJoint& joint, double position, const ros::Time& stamp, tf::StampedTransform& transform) {
+  transform.setData(joint.origin * tf::Transform(tf::Quaternion(joint.axis, position)));
+  transform.stamp_ = stamp;
+  transform.frame_id_ = joint.parent_frame;
+  transform.child_frame_id_ = joint.child_frame;
+}
+
+// appends the transforms of both joints at the given time to mount_transforms_
+void addMountTransforms(const ros::Time& stamp, double roll, double pitch) {
+  mount_transforms_.resize(mount_transforms_.size() + 2);
+  setMountTransform(roll_joint_, roll, stamp, mount_transforms_[mount_transforms_.size() - 2]);
+  setMountTransform(pitch_joint_, pitch, stamp, mount_transforms_[mount_transforms_.size() - 1]);
+}
+
+// interpolates the buffered joint feedback to the given time, extrapolates by at most p_max_extrapolation_
+bool getMountSample(const ros::Time& stamp, MountSample& sample) {
+  if (mount_samples_.empty() || stamp < mount_samples_.front().stamp) return false;
+
+  std::deque<MountSample>::const_iterator next = mount_samples_.begin();
+  while (next != mount_samples_.end() && next->stamp < stamp) ++next;
+
+  if (next == mount_samples_.end()) {
+    const MountSample& last = mount_samples_.back();
+    if ((stamp - last.stamp).toSec() > p_max_extrapolation_) return false;
+    if (mount_samples_.size() < 2) {
+      sample = last;
+      sample.stamp = stamp;
+      return true;
+    }
+    next = mount_samples_.end() - 1;
+  }
+
+  if (next == mount_samples_.begin()) {
+    sample = *next;
+    sample.stamp = stamp;
+    return true;
+  }
+
+  const MountSample& a = *(next - 1);
+  const MountSample& b = *next;
+  double dt = (b.stamp - a.stamp).toSec();
+  double t = dt > 0.0 ? (stamp - a.stamp).toSec() / dt : 1.0;
+
+  sample.stamp = stamp;
+  sample.roll = a.roll + t * (b.roll - a.roll);
+  sample.pitch = a.pitch + t * (b.pitch - a.pitch);
+  return true;
+}
+
+void jointStateCallback(const sensor_msgs::JointStateConstPtr& joint_state) {
+  HECTOR_TRACE_SCOPE("roll_pitch_stabilizer/joint_state");
+
+  bool updated = false;
+  for (size_t i = 0; i < joint_state->name.size() && i < joint_state->position.size(); ++i) {
+    if (joint_state->name[i] == roll_joint_.name) {
+      roll_joint_.position = joint_state->position[i];
+      roll_joint_.valid = true;
+      updated = true;
+    } else if (joint_state->name[i] == pitch_joint_.name) {
+      pitch_joint_.position = joint_state->position[i];
+      pitch_joint_.valid = true;
+      updated = true;
+    }
+  }
+
+  if (!updated || !roll_joint_.valid || !pitch_joint_.valid) return;
+
+  MountSample sample;
+  sample.stamp = joint_state->header.stamp.isZero() ? ros::Time::now() : joint_state->header.stamp;
+  sample.roll = roll_joint_.position;
+  sample.pitch = pitch_joint_.position;
+
+  // feedback from separate controllers may arrive slightly out of order
+  if (!mount_samples_.empty() && sample.stamp < mount_samples_.back().stamp) {
+    if (sample.stamp < mount_samples_.front().stamp) return;
+    std::deque<MountSample>::iterator it = mount_samples_.end();
+    while ((it - 1)->stamp > sample.stamp) --it;
+    mount_samples_.insert(it, sample);
+  } else {
+    mount_samples_.push_back(sample);
+  }
+
+  while (mount_samples_.size() > 2 && (mount_samples_.back().stamp - mount_samples_.front().stamp).toSec() > p_mount_buffer_duration_) {
+    mount_samples_.pop_front();
+  }
+
+  mount_transforms_.clear();
+  addMountTransforms(sample.stamp, sample.roll, sample.pitch);
+  tfB_->sendTransform(mount_transforms_);
+}
+
+// publishes the mount pose at the first and last beam of each scan, so the projection of the
+// scan does not have to wait for the next joint update
+void publishScanMountTransforms(const sensor_msgs::LaserScanConstPtr& scan) {
+  ros::Time start = scan->header.stamp;
+  ros::Time end = start;
+  if (scan->ranges.size() > 1 && scan->time_increment > 0.0) {
+    end += ros::Duration(scan->time_increment * (scan->ranges.size() - 1));
+  }
+
+  mount_transforms_.clear();
+
+  MountSample sample;
+  if (getMountSample(start, sample)) addMountTransforms(sample.stamp, sample.roll, sample.pitch);
+  if (end != start && getMountSample(end, sample)) addMountTransforms(sample.stamp, sample.roll, sample.pitch);
+
+  if (!mount_transforms_.empty()) tfB_->sendTransform(mount_transforms_);
+}
+
+hector_roll_pitch_stabilizer::Point3 toPoint(const tf::Vector3& v) {
+  return hector_roll_pitch_stabilizer::Point3(v.x(), v.y(), v.z());
+}
+
+void updateOccupancySummary(const sensor_msgs::LaserScanConstPtr& scan) {
+  tf::StampedTransform sensor_pose;
+  try
+  {
+    tfL_->lookupTransform(p_fixed_frame_, scan->header.frame_id, scan->header.stamp, sensor_pose);
+  }
+  catch(tf::TransformException e)
+  {
+    return;
+  }
+
+  boost::mutex::scoped_lock lock(occupancy_mutex_);
+
+  scan_frame_ = scan->header.frame_id;
+  scan_angle_min_ = scan->angle_min;
+  scan_angle_max_ = scan->angle_max;
+
+  const tf::Vector3& origin = sensor_pose.getOrigin();
+  hector_roll_pitch_stabilizer::Point3 origin_point(toPoint(origin));
+  occupancy_summary_->setCenter(origin_point);
+
+  double max_range = std::min(static_cast<double>(scan->range_max), p_sweep_max_range_);
+
+  for (size_t i = 0; i < scan->ranges.size(); i += p_summary_beam_step_) {
+    double range = scan->ranges[i];
+    bool hit = true;
+
+    if (!(range >= scan->range_min)) continue;
+    if (range >= max_range) {
+      // no return within range is free space up to the range limit
+      range = max_range;
+      hit = false;
+    }
+
+    double angle = scan->angle_min + i * scan->angle_increment;
+    tf::Vector3 end = sensor_pose * tf::Vector3(range * cos(angle), range * sin(angle), 0.0);
+    occupancy_summary_->insertRay(origin_point, toPoint(end), hit);
+  }
+}
+
+void scanCallback(const sensor_msgs::LaserScanConstPtr& scan) {
+  HECTOR_TRACE_SCOPE("roll_pitch_stabilizer/scan");
+
+  if (p_publish_mount_transform_) publishScanMountTransforms(scan);
+  if (occupancy_summary_) updateOccupancySummary(scan);
+}
+
+// scan parameters captured together with planning_summary_
+struct ScanGeometry {
+  std::string frame;
+  double angle_min;
+  double angle_max;
+};
+
+// collects the unknown cells a scan from the given sensor pose would observe
+void evaluateSensorPose(const ScanGeometry& scan, const tf::Transform& sensor_pose) {
+  const int beams = std::max(2, p_sweep_beams_);
+  hector_roll_pitch_stabilizer::Point3 origin(toPoint(sensor_pose.getOrigin()));
+  const tf::Matrix3x3& basis = sensor_pose.getBasis();
+
+  for (int b = 0; b < beams; ++b) {
+    double angle = scan.angle_min + (scan.angle_max - scan.angle_min) * b / (beams - 1);
+    planning_summary_->evaluateRay(origin, toPoint(basis * tf::Vector3(cos(angle), sin(angle), 0.0)), p_sweep_max_range_);
+  }
+}
+
+// Rates the mount angles min_angle:step:max_angle of one axis (the other one is held) by the
+// unknown cells the scan plane would observe and greedily accepts the best one until the gain
+// drops below ~sweep_min_gain. Cells seen by stops accepted earlier in the plan are not counted
+// again, so densely spaced stops are only chosen where they still add information.
+// Works on planning_summary_, occupancy_mutex_ must not be held.
+void planSweep(const ScanGeometry& scan, bool pitch_axis, double min_angle, double max_angle, double step, double roll, double pitch, std::vector<double>& stops) {
+  stops.clear();
+  if (step <= 0.0 || max_angle < min_angle) return;
+
+  tf::StampedTransform mount_pose, sensor_offset;
+  try
+  {
+    tfL_->lookupTransform(p_fixed_frame_, roll_joint_.parent_frame, ros::Time(0), mount_pose);
+    tfL_->lookupTransform(pitch_joint_.child_frame, scan.frame, ros::Time(0), sensor_offset);
+  }
+  catch(tf::TransformException e)
+  {
+    ROS_WARN("Sweep planning failed: %s", e.what());
+    return;
+  }
+
+  std::vector<double> candidates;
+  for (double angle = min_angle; angle <= max_angle + 1e-6; angle += step) candidates.push_back(angle);
+
+  std::vector<tf::Transform> sensor_poses(candidates.size());
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    double r = pitch_axis ? roll : candidates[i];
+    double p = pitch_axis ? candidates[i] : pitch;
+    sensor_poses[i] = mount_pose
+                    * roll_joint_.origin * tf::Transform(tf::Quaternion(roll_joint_.axis, r))
+                    * pitch_joint_.origin * tf::Transform(tf::Quaternion(pitch_joint_.axis, p))
+                    * sensor_offset;
+  }
+
+  std::vector<bool> accepted(candidates.size(), false);
+
+  for (;;) {
+    int best = -1;
+    unsigned int best_gain = 0;
+
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      if (accepted[i]) continue;
+
+      evaluateSensorPose(scan, sensor_poses[i]);
+      if (planning_summary_->getCandidateGain() > best_gain) {
+        best = i;
+        best_gain = planning_summary_->getCandidateGain();
+      }
+      planning_summary_->rejectCandidate();
+    }
+
+    if (best < 0 || static_cast<int>(best_gain) < p_sweep_min_gain_) break;
+
+    evaluateSensorPose(scan, sensor_poses[best]);
+    planning_summary_->acceptCandidate();
+    accepted[best] = true;
+  }
+
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    if (accepted[i]) stops.push_back(candidates[i]);
+  }
+}
+
+// commands the angle and waits for the travel time plus the dwell time
+void moveMount(const ros::Publisher& pub, double& current, double target, int dwell_ms) {
+  std_msgs::Float64 msg;
+  msg.data = target;
+  pub.publish(msg);
+
+  double travel = p_sweep_max_velocity_ > 0.0 ? std::fabs(target - current) / p_sweep_max_velocity_ : 0.0;
+  current = target;
+  usleep(static_cast<useconds_t>(1e6 * travel) + 1000 * dwell_ms);
+}
+
+bool doAdaptiveScan(hector_roll_pitch_stabilizer::DoScan::Request &request, hector_roll_pitch_stabilizer::DoScan::Response &response) {
+  double roll, pitch;
+  {
+    boost::mutex::scoped_lock lock(stabilizer_mutex_);
+    stabilizeLocked();
+    roll = desired_roll_msg_.data;
+    pitch = desired_pitch_msg_.data;
+  }
+
+  ScanGeometry scan;
+  {
+    boost::mutex::scoped_lock lock(occupancy_mutex_);
+    if (scan_frame_.empty()) return false;
+
+    *planning_summary_ = *occupancy_summary_;
+    scan.frame = scan_frame_;
+    scan.angle_min = scan_angle_min_;
+    scan.angle_max = scan_angle_max_;
+  }
+
+  std::vector<double> pitch_stops, roll_stops;
+  planning_summary_->beginPlan();
+  planSweep(scan, true, request.min_angle_pitch, request.max_angle_pitch, request.step, roll, pitch, pitch_stops);
+  planSweep(scan, false, request.min_angle_roll, request.max_angle_roll, request.step, roll, pitch, roll_stops);
+
+  ROS_INFO("Adaptive scan: %u pitch and %u roll stops", (unsigned int) pitch_stops.size(), (unsigned int) roll_stops.size());
+  response.num_stops = pitch_stops.size() + roll_stops.size();
+
+  double current = pitch;
+  for (size_t i = 0; i < pitch_stops.size(); ++i) moveMount(pub_desired_pitch_angle_, current, pitch_stops[i], request.sleep_time_ms);
+  if (!pitch_stops.empty()) moveMount(pub_desired_pitch_angle_, current, pitch, 0);
+
+  current = roll;
+  for (size_t i = 0; i < roll_stops.size(); ++i) moveMount(pub_desired_roll_angle_, current, roll_stops[i], request.sleep_time_ms);
+  if (!roll_stops.empty()) moveMount(pub_desired_roll_angle_, current, roll, 0);
+
+  return true;
+}
+
+void scanServiceLoop() {
+  while (ros::ok()) {
+    scan_service_queue_.callAvailable(ros::WallDuration(0.1));
   }
 }
 
 bool doScan(hector_roll_pitch_stabilizer::DoScan::Request &request, hector_roll_pitch_stabilizer::DoScan::Response &response) {
-  updatesEnabled = false;
+  HECTOR_TRACE_SCOPE("roll_pitch_stabilizer/do_scan");
+
+  setUpdatesEnabled(false);
+
+  if (request.adaptive) {
+    if (occupancy_summary_ && doAdaptiveScan(request, response)) {
+      setUpdatesEnabled(true);
+      return true;
+    }
+    ROS_WARN("Adaptive scan not available (no scans received yet or ~adaptive_sweep disabled), sweeping the full range");
+  }
   
   std_msgs::Float64 tmp;
   
@@ -123,7 +560,8 @@ bool doScan(hector_roll_pitch_stabilizer::DoScan::Request &request, hector_roll_
     usleep(1000*request.sleep_time_ms);
   }
   
-  updatesEnabled = true;  
+  response.num_stops = 0;
+  setUpdatesEnabled(true);
   
   return true;
 }
@@ -136,18 +574,98 @@ int main(int argc, char **argv) {
   pn.param("base_frame", p_base_frame_, std::string("base_frame"));
   pn.param("base_stabilized_frame", p_base_stabilized_frame_, std::string("base_stabilized_frame"));
 
-  tfL_ = new tf::TransformListener();
+  double update_rate;
+  double jitter_report_interval;
+  pn.param("update_rate", update_rate, 30.0);
+  pn.param("jitter_report_interval", jitter_report_interval, 10.0);
+
+  pn.param("publish_mount_transform", p_publish_mount_transform_, false);
+  pn.param("mount_buffer_duration", p_mount_buffer_duration_, 1.0);
+  pn.param("max_extrapolation", p_max_extrapolation_, 0.05);
+
+  pn.param("adaptive_sweep", p_adaptive_sweep_, false);
+  pn.param("fixed_frame", p_fixed_frame_, std::string("odom"));
+  pn.param("sweep_max_range", p_sweep_max_range_, 8.0);
+  pn.param("sweep_max_velocity", p_sweep_max_velocity_, 1.0);
+  pn.param("sweep_beams", p_sweep_beams_, 64);
+  pn.param("sweep_min_gain", p_sweep_min_gain_, 50);
+  pn.param("summary_beam_step", p_summary_beam_step_, 4);
+  p_summary_beam_step_ = std::max(1, p_summary_beam_step_);
+
+  double summary_resolution, summary_size_xy, summary_size_z;
+  pn.param("summary_resolution", summary_resolution, 0.25);
+  pn.param("summary_size_xy", summary_size_xy, 20.0);
+  pn.param("summary_size_z", summary_size_z, 5.0);
+
+  hector_trace::init(pn);
+  hector_realtime::loadConfig(pn, realtime_config_);
 
-  ros::Timer update_timer = pn.createTimer(ros::Duration(1.0 / 30), &updateTimerCallback, false);
+  tfL_ = new tf::TransformListener();
 
   pub_desired_roll_angle_ = pn.advertise<std_msgs::Float64>("/desired_roll_angle",10,false);
   pub_desired_pitch_angle_ = pn.advertise<std_msgs::Float64>("/desired_pitch_angle",10,false);
   
-  scan_server_ = n.advertiseService(std::string("/hector_roll_pitch_stabilizer/do_scan"), &doScan);
+  ros::NodeHandle scan_service_nh;
+  scan_service_nh.setCallbackQueue(&scan_service_queue_);
+  scan_server_ = scan_service_nh.advertiseService(std::string("/hector_roll_pitch_stabilizer/do_scan"), &doScan);
+  boost::thread scan_service_thread(&scanServiceLoop);
+
+  if (p_publish_mount_transform_ || p_adaptive_sweep_) {
+    std::string roll_joint, pitch_joint;
+    pn.param("roll_joint", roll_joint, std::string("ls_roll_joint"));
+    pn.param("pitch_joint", pitch_joint, std::string("ls_pitch_joint"));
+
+    urdf::Model model;
+    if (model.initParam("robot_description") && initMountJoint(model, roll_joint, roll_joint_) && initMountJoint(model, pitch_joint, pitch_joint_)) {
+      if (p_publish_mount_transform_) {
+        tfB_ = new tf::TransformBroadcaster();
+        mount_transforms_.reserve(4);
+
+        joint_state_sub_ = n.subscribe("joint_states", 100, &jointStateCallback, ros::TransportHints().tcpNoDelay());
+        ROS_INFO("Publishing mount transforms %s -> %s -> %s", roll_joint_.parent_frame.c_str(), roll_joint_.child_frame.c_str(), pitch_joint_.child_frame.c_str());
+      }
+
+      if (p_adaptive_sweep_) {
+        occupancy_summary_ = new hector_roll_pitch_stabilizer::OccupancySummary(summary_resolution, summary_size_xy, summary_size_z);
+        planning_summary_ = new hector_roll_pitch_stabilizer::OccupancySummary(summary_resolution, summary_size_xy, summary_size_z);
+      }
+
+      scan_sub_ = n.subscribe("scan", 10, &scanCallback);
+    } else {
+      ROS_ERROR("Could not load the mount joints from robot_description, mount transforms and adaptive sweeps are disabled");
+      p_publish_mount_transform_ = false;
+    }
+  }
+
+  ros::Timer update_timer;
+  ros::Timer jitter_report_timer;
+  boost::thread realtime_thread;
+
+  if (realtime_config_.enabled) {
+    realtime_loop_ = new hector_realtime::PeriodicLoop(update_rate);
+    realtime_thread = boost::thread(&realtimeLoop);
+
+    if (jitter_report_interval > 0.0) {
+      jitter_report_timer = pn.createTimer(ros::Duration(jitter_report_interval), &jitterReportCallback, false);
+    }
+  } else {
+    update_timer = pn.createTimer(ros::Duration(1.0 / update_rate), &updateTimerCallback, false);
+  }
 
   ros::spin();
 
+  if (realtime_loop_) {
+    realtime_thread.join();
+    ROS_INFO("Control loop wake-up latency: %s", realtime_loop_->getHistogram().toString().c_str());
+    delete realtime_loop_;
+  }
+
+  scan_service_thread.join();
+
   delete tfL_;
+  delete tfB_;
+  delete occupancy_summary_;
+  delete planning_summary_;
 
   return 0;
 }
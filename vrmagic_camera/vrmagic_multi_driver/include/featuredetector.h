@@ -0,0 +1,126 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2012, TU Darmstadt.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of TU Darmstadt nor the names of the
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#ifndef FEATUREDETECTOR_H
+#define FEATUREDETECTOR_H
+
+#include <vector>
+
+/**
+ * Keypoint detection and binary description on MONO16 frames.
+ *
+ * The 10 bit image is reduced to 8 bit and a pyramid with a scale factor of two per level is built.
+ * On every level FAST-9 corners are detected with SSE2 (16 pixels per step), suppressed to 3x3
+ * local maxima and bucketed into a grid so that every cell keeps at most perCell corners.
+ * Keypoints get an intensity centroid orientation and a 256 bit steered BRIEF descriptor computed
+ * on a box filtered copy of the level.
+ *
+ * All buffers are kept between frames; one detector must not be used from two threads at once.
+ */
+class FeatureDetector
+{
+public:
+    struct Params
+    {
+	int levels;        // pyramid levels
+	int threshold;     // FAST threshold on the 8 bit image
+	int cellSize;      // grid cell size in pixels of the respective level
+	int perCell;       // corners kept per cell
+	int maxFeatures;   // strongest keypoints kept over all levels
+	Params() : levels(3), threshold(20), cellSize(32), perCell(2), maxFeatures(1000) {}
+    };
+
+    struct Keypoint
+    {
+	float x, y;        // level 0 pixel coordinates
+	float angle;       // radians
+	float response;
+	unsigned char level;
+    };
+
+    enum { DESCRIPTOR_SIZE = 32 };
+
+    FeatureDetector();
+
+    void setParams(const Params &params) { this->params = params; }
+    const Params &getParams() const { return params; }
+
+    /// data holds little-endian 16 bit pixels, stepBytes per row
+    void detect(const unsigned char *data, unsigned int width, unsigned int height, unsigned int stepBytes);
+
+    const std::vector<Keypoint> &getKeypoints() const { return keypoints; }
+    /// DESCRIPTOR_SIZE bytes per keypoint
+    const std::vector<unsigned char> &getDescriptors() const { return descriptors; }
+
+private:
+    struct Level
+    {
+	unsigned int width, height;
+	std::vector<unsigned char> image;
+	std::vector<unsigned char> blurred;
+	std::vector<unsigned short> score;
+	std::vector<unsigned short> rowSum;
+	std::vector<unsigned int> corners;
+    };
+
+    struct Candidate
+    {
+	unsigned int cell;
+	unsigned short score;
+	unsigned short x, y;
+	unsigned char level;
+	bool operator<(const Candidate &other) const
+	{ return cell < other.cell || (cell == other.cell && score > other.score); }
+    };
+
+    void buildPyramid(const unsigned char *data, unsigned int width, unsigned int height, unsigned int stepBytes);
+    void detectCorners(unsigned int l);
+    void blur(Level &level);
+    float orientation(const Level &level, int x, int y) const;
+    void describe(const Level &level, int x, int y, float angle, unsigned char *descriptor) const;
+
+    Params params;
+    std::vector<Level> pyramid;
+    std::vector<Candidate> candidates;
+    std::vector<Candidate> selected;
+    std::vector<Keypoint> keypoints;
+    std::vector<unsigned char> descriptors;
+
+    // test pairs of the descriptor for each of ANGLE_BINS orientations
+    enum { ANGLE_BINS = 30, PATTERN_SIZE = 256 };
+    std::vector<signed char> pattern;
+    int circleExtent[16];
+};
+
+#endif // FEATUREDETECTOR_H
@@ -0,0 +1,117 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2012, TU Darmstadt.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of TU Darmstadt nor the names of the
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#ifndef SENSORCORRECTION_H
+#define SENSORCORRECTION_H
+
+#include <string>
+#include <vector>
+
+#include "temporalfilter.h"
+
+/**
+ * Per-sensor non-uniformity correction: dark offset, flat-field gain and defective pixels.
+ *
+ * unpack() converts the packed 10 bit camera data (8 high bits, 2 low bits per 16 bit word) to
+ * MONO16 and applies the correction in the same pass:
+ *
+ *   out = min(1023, max(0, raw - dark) * gain / 1024)
+ *
+ * Defective pixels are replaced with the mean of their horizontal neighbours afterwards; they are
+ * few, so this touches only a handful of cache lines per frame. An optional TemporalFilter is
+ * applied in the same pass, right before the pixels are stored.
+ *
+ * The maps are captured by accumulating frames with beginCapture()/accumulate() and finishing with
+ * finishDark() (covered lens) or finishFlat() (uniformly lit target, after the dark frame).
+ */
+class SensorCorrection
+{
+public:
+    SensorCorrection();
+
+    bool isValid() const { return valid; }
+    void clear();
+
+    /// src holds width * height packed pixels, dst receives width * height MONO16 pixels
+    void unpack(const unsigned char *src, unsigned char *dst, unsigned int width, unsigned int height) const
+    {
+	unpack(src, width * 2, dst, width, height, 0, 0);
+    }
+
+    /// src is the sensor window at (left, top) with rows srcPitch bytes apart, dst is packed
+    void unpack(const unsigned char *src, unsigned int srcPitch, unsigned char *dst,
+	    unsigned int width, unsigned int height, unsigned int left, unsigned int top,
+	    TemporalFilter *filter = NULL) const;
+
+    /// plain conversion without correction
+    static void unpackRaw(const unsigned char *src, unsigned char *dst, unsigned int pixels);
+    static void unpackRaw(const unsigned char *src, unsigned int srcPitch, unsigned char *dst,
+	    unsigned int width, unsigned int height, TemporalFilter *filter = NULL);
+
+    void beginCapture(unsigned int width, unsigned int height);
+    /// adds one uncorrected MONO16 frame
+    void accumulate(const unsigned char *mono16);
+    unsigned int capturedFrames() const { return frames; }
+
+    /// pixels brighter than the mean dark level by more than hotThreshold are marked defective
+    void finishDark(unsigned int hotThreshold);
+    /// pixels whose response deviates by more than maxDeviation (relative) from the mean are marked defective
+    void finishFlat(float maxDeviation);
+
+    unsigned int defectCount() const { return defects.size(); }
+
+    bool load(const std::string &fileName);
+    bool save(const std::string &fileName) const;
+
+private:
+    enum { DEFECT_HOT = 1, DEFECT_FLAT = 2 };
+
+    void updateDefects();
+    static void unpackRaw(const unsigned char *src, unsigned char *dst, unsigned int pixels,
+	    const TemporalFilter *filter, unsigned short *history);
+    static void unpackCorrected(const unsigned char *src, unsigned char *dst,
+	    const unsigned short *d, const unsigned short *g, unsigned int pixels,
+	    const TemporalFilter *filter, unsigned short *history);
+
+    unsigned int width, height;
+    std::vector<unsigned short> dark;     // 10 bit counts
+    std::vector<unsigned short> gain;     // 1024 = 1.0, below 32768
+    std::vector<unsigned char> defectMask;  // DEFECT_HOT | DEFECT_FLAT per pixel
+    std::vector<unsigned int> defects;    // indices of the pixels set in defectMask
+    std::vector<unsigned int> sum;        // capture accumulator
+    unsigned int frames;
+    bool valid;
+};
+
+#endif // SENSORCORRECTION_H
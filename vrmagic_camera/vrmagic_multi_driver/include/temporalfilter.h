@@ -0,0 +1,113 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2012, TU Darmstadt.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of TU Darmstadt nor the names of the
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#ifndef TEMPORALFILTER_H
+#define TEMPORALFILTER_H
+
+#include <algorithm>
+#include <vector>
+
+#include <emmintrin.h>
+
+/**
+ * Motion adaptive recursive temporal filter for 10 bit MONO16 frames.
+ *
+ * Every pixel keeps a filtered history value h (4 fractional bits) and is updated with
+ *
+ *   h += (v - h) * alpha,   alpha = min(1, staticWeight + |v - h| / motionThreshold * (1 - staticWeight))
+ *
+ * so static pixels are averaged over about 1 / staticWeight frames while pixels that change by more
+ * than motionThreshold counts pass through unfiltered. The kernel works on eight pixels at a time in
+ * 16 bit fixed point and is applied by SensorCorrection::unpack() right before the output is
+ * stored, so filtering adds no pass over the frame. The first frame after a reset or a change of
+ * the frame size initializes the history.
+ */
+class TemporalFilter
+{
+public:
+    TemporalFilter();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled; }
+
+    /// staticWeight in (0, 1], motionThreshold in counts
+    void setParams(float staticWeight, unsigned int motionThreshold);
+
+    void reset() { primed = false; }
+
+    /// history of a width x height frame, called once per frame before apply()
+    unsigned short *prepare(unsigned int width, unsigned int height);
+
+    /// filters eight 10 bit pixels against the history at h and returns the output pixels
+    inline __m128i apply(__m128i v, unsigned short *h) const
+    {
+	__m128i hist = _mm_loadu_si128((const __m128i *) h);
+	__m128i d = _mm_sub_epi16(_mm_slli_epi16(v, 4), hist);
+	__m128i sign = _mm_srai_epi16(d, 15);
+	__m128i mag = _mm_sub_epi16(_mm_xor_si128(d, sign), sign);
+
+	// alpha in Q14, the step is |d| * alpha rounded towards zero, so the history does not drift
+	__m128i alpha = _mm_add_epi16(_mm_set1_epi16(frameWeight),
+		_mm_mullo_epi16(_mm_min_epi16(mag, _mm_set1_epi16(threshold)), _mm_set1_epi16(frameSlope)));
+	alpha = _mm_min_epi16(alpha, _mm_set1_epi16(16384));
+	__m128i step = _mm_mulhi_epu16(_mm_slli_epi16(mag, 2), alpha);
+
+	hist = _mm_add_epi16(hist, _mm_sub_epi16(_mm_xor_si128(step, sign), sign));
+	_mm_storeu_si128((__m128i *) h, hist);
+	return _mm_srli_epi16(_mm_add_epi16(hist, _mm_set1_epi16(8)), 4);
+    }
+
+    /// scalar version of apply() for the remaining pixels
+    inline unsigned int apply(unsigned int v, unsigned short *h) const
+    {
+	int d = (int) (v << 4) - *h;
+	unsigned int mag = d < 0 ? -d : d;
+	unsigned int alpha = frameWeight + std::min(mag, (unsigned int) threshold) * frameSlope;
+	if(alpha > 16384)
+	    alpha = 16384;
+	int step = (mag * 4 * alpha) >> 16;
+	*h += d < 0 ? -step : step;
+	return (*h + 8) >> 4;
+    }
+
+private:
+    bool enabled, primed;
+    unsigned int width, height;
+    std::vector<unsigned short> history;    // 10 bit values with 4 fractional bits
+
+    short staticWeight, slope, threshold;   // Q14, per Q4 count, Q4 counts
+    short frameWeight, frameSlope;          // values for the current frame, alpha = 1 while priming
+};
+
+#endif // TEMPORALFILTER_H
@@ -32,20 +32,29 @@
 *  POSSIBILITY OF SUCH DAMAGE.
 *********************************************************************/
 
+#include <ros/callback_queue.h>
 #include <image_transport/image_transport.h>
 #include <image_transport/camera_publisher.h>
 #include <sensor_msgs/fill_image.h>
 #include <sensor_msgs/Image.h>
 #include <sensor_msgs/CameraInfo.h>
 #include <sensor_msgs/SetCameraInfo.h>
+#include <std_srvs/Empty.h>
 
 #include <dynamic_reconfigure/server.h>
 #include <vrmagic_multi_driver/CamParamsConfig.h>
+#include <vrmagic_multi_driver/Features.h>
 
+#include <boost/function.hpp>
 #include <boost/thread.hpp>
 
+#include <deque>
+
 #include <vrmagic_devkit_wrapper/vrmusbcam2.h>
 
+#include "featuredetector.h"
+#include "sensorcorrection.h"
+
 class PropertyCache;
 
 class VRMagicStereoNode
@@ -58,6 +67,10 @@ private:
 	image_transport::CameraPublisher camPubLeft, camPubRight;
 	sensor_msgs::CameraInfo leftCalib, rightCalib;
         ros::ServiceServer leftCalibUpdate, rightCalibUpdate;
+	// services and reconfigure requests are served by their own thread, so they never run at the
+	// real-time priority of the acquisition loop
+	ros::CallbackQueue serviceQueue;
+	boost::thread serviceThread;
 	// it would be better to use CameraInfoManager, if saving to cameraeprom is not required
   dynamic_reconfigure::Server<vrmagic_multi_driver::CamParamsConfig> dConfServer;
         ros::Rate fpsLimit;
@@ -67,8 +80,59 @@ private:
         sensor_msgs::Image imgLeft;
         sensor_msgs::Image imgRight;
 	const std::string frame_id;
+
+	// optional keypoint output, computed from the unpacked frames
+	bool featuresEnabled;
+	ros::Publisher featPubLeft, featPubRight;
+	FeatureDetector detectorLeft, detectorRight;
+	vrmagic_multi_driver::Features featuresLeft, featuresRight;
+
+	// long-lived worker that takes detection jobs (the right sensor) while the
+	// publishing thread processes the left one
+	boost::thread featureWorker;
+	boost::mutex featureAccess;
+	boost::condition_variable featureQueued, featureDone;
+	std::deque<boost::function<void ()> > featureJobs;
+	unsigned int featureJobsPending;
+	bool featureWorkerStop;
+
+	// dark/flat/defect correction applied while unpacking, captured through services
+	SensorCorrection correctionLeft, correctionRight;
+	std::string correctionDir;
+	ros::ServiceServer captureDarkService, captureFlatService, clearCorrectionService;
+
+	// temporal denoising fused into the unpack pass, one history frame per sensor
+	TemporalFilter filterLeft, filterRight;
+
+	// acquisition control: sensors without subscribers are not converted, and every
+	// frameDivider-th cycle is triggered while the publish cycle overruns its period
+	int publishQueueSize;
+	bool acquiring;
+	bool grabbingLeft, grabbingRight;   // sensor was converted in the last acquisition
+	unsigned int frameDivider, maxFrameDivider;
+	unsigned int overrunCycles, headroomCycles;
+
+	// sensor window: read out by the sensor where it supports a ROI, otherwise cropped while
+	// unpacking; width/height above are the window size, the stored calibration is full frame
+	unsigned int sensorWidth, sensorHeight;
+	unsigned int roiLeft, roiTop;
+	bool hardwareRoi, softwareCrop;
+	sensor_msgs::CameraInfo leftInfo, rightInfo;
+	double acquisitionTime, fullFrameAcquisitionTime;
+	unsigned int roiReportFrames;
+	bool windowPending;            // applied after the full frame time was measured
+
+	// held by the acquisition loop for a frame; services that grab frames or change the
+	// correction or calibration take it to run between frames
+	boost::mutex acquisitionAccess;
+	// reconfigure changes of the window, denoising and frame rate, applied by the acquisition loop
+	boost::mutex configAccess;
+	vrmagic_multi_driver::CamParamsConfig pendingConfig;
+	bool configPending;
 	
   void propertyUpdate(vrmagic_multi_driver::CamParamsConfig &config, uint32_t level);
+	void applyPendingConfig();
+	void serviceLoop();
 
         bool runUpdateLeft(sensor_msgs::SetCameraInfo::Request &req,
             sensor_msgs::SetCameraInfo::Response &res);
@@ -76,12 +140,30 @@ private:
         bool runUpdateRight(sensor_msgs::SetCameraInfo::Request &req,
             sensor_msgs::SetCameraInfo::Response &res);
 
+	bool runCaptureDark(std_srvs::Empty::Request &req, std_srvs::Empty::Response &res);
+	bool runCaptureFlat(std_srvs::Empty::Request &req, std_srvs::Empty::Response &res);
+	bool runClearCorrection(std_srvs::Empty::Request &req, std_srvs::Empty::Response &res);
+	bool captureCorrectionFrames();
+	void loadCorrection();
+	void storeCorrection();
+
+	void setSensorWindow(bool enabled, int left, int top, int roiWidth, int roiHeight);
+	void windowCalibration(const sensor_msgs::CameraInfo &full, sensor_msgs::CameraInfo &window) const;
+	void recordAcquisitionTime(double seconds);
+
         void storeCalibration();
         void loadCalibration();
         void AnnounceTopics();
         void AbandonTopics();
-        void broadcastFrame();
-	void grabFrame(VRmDWORD port, sensor_msgs::Image &img, const ros::Time &triggerTime);
+        bool broadcastFrame();
+	void adaptFrameRate(double cycleTime, double period);
+	void discardFrame(VRmDWORD port);
+	ros::Time triggerFrame();
+	void grabFrame(VRmDWORD port, sensor_msgs::Image &img, const ros::Time &triggerTime,
+		const SensorCorrection *correction, TemporalFilter *filter);
+	void initFeatures();
+	void featureWorkerLoop();
+	void publishFeatures(const ros::Time &triggerTime, bool grabbedLeft, bool grabbedRight);
         void initCam(VRmDWORD camDesired);
 	void initProperties();
 
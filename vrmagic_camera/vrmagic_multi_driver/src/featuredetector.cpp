@@ -0,0 +1,445 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2012, TU Darmstadt.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of TU Darmstadt nor the names of the
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include "featuredetector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+#include <emmintrin.h>
+
+// keypoints keep this distance to the image border so that orientation and descriptor patches
+// (radius 15 plus the blur radius) are fully inside
+static const int BORDER = 18;
+static const int PATCH_RADIUS = 15;
+static const int PATTERN_RADIUS = 13;
+
+// FAST circle of radius 3, clockwise starting at the top
+static const int circleX[16] = { 0, 1, 2, 3, 3, 3, 2, 1, 0, -1, -2, -3, -3, -3, -2, -1 };
+static const int circleY[16] = { -3, -3, -2, -1, 0, 1, 2, 3, 3, 3, 2, 1, 0, -1, -2, -3 };
+
+FeatureDetector::FeatureDetector()
+{
+    // descriptor test pairs: approximately gaussian distributed inside the patch, generated with a
+    // fixed linear congruential generator so descriptors are comparable between runs and machines
+    unsigned int seed = 0x2f6b1c3d;
+    float base[PATTERN_SIZE][4];
+
+    for(int i = 0; i < PATTERN_SIZE; i++)
+    {
+	for(int j = 0; j < 4; j++)
+	{
+	    float v;
+	    do
+	    {
+		float sum = 0.0f;
+		for(int k = 0; k < 4; k++)
+		{
+		    seed = seed * 1664525u + 1013904223u;
+		    sum += (seed >> 8) / 16777216.0f - 0.5f;
+		}
+		v = sum * 2.0f * PATTERN_RADIUS / 2.0f;
+	    } while(std::fabs(v) > PATTERN_RADIUS);
+	    base[i][j] = v;
+	}
+
+	// keep both points inside the circle so that every rotation stays within the patch
+	for(int j = 0; j < 4; j += 2)
+	{
+	    float r = std::sqrt(base[i][j] * base[i][j] + base[i][j + 1] * base[i][j + 1]);
+	    if(r > PATTERN_RADIUS)
+	    {
+		base[i][j] *= PATTERN_RADIUS / r;
+		base[i][j + 1] *= PATTERN_RADIUS / r;
+	    }
+	}
+    }
+
+    pattern.resize(ANGLE_BINS * PATTERN_SIZE * 4);
+    for(int b = 0; b < ANGLE_BINS; b++)
+    {
+	float c = std::cos(b * 2.0 * M_PI / ANGLE_BINS);
+	float s = std::sin(b * 2.0 * M_PI / ANGLE_BINS);
+	signed char *p = &pattern[b * PATTERN_SIZE * 4];
+
+	for(int i = 0; i < PATTERN_SIZE; i++, p += 4)
+	{
+	    p[0] = (signed char) floorf(c * base[i][0] - s * base[i][1] + 0.5f);
+	    p[1] = (signed char) floorf(s * base[i][0] + c * base[i][1] + 0.5f);
+	    p[2] = (signed char) floorf(c * base[i][2] - s * base[i][3] + 0.5f);
+	    p[3] = (signed char) floorf(s * base[i][2] + c * base[i][3] + 0.5f);
+	}
+    }
+
+    for(int dy = 0; dy <= PATCH_RADIUS; dy++)
+	circleExtent[dy] = (int) std::floor(std::sqrt((PATCH_RADIUS + 0.5) * (PATCH_RADIUS + 0.5) - dy * dy));
+}
+
+void FeatureDetector::detect(const unsigned char *data, unsigned int width, unsigned int height, unsigned int stepBytes)
+{
+    buildPyramid(data, width, height, stepBytes);
+
+    candidates.clear();
+    for(unsigned int l = 0; l < pyramid.size(); l++)
+	detectCorners(l);
+
+    // grid bucketing: candidates are sorted by cell and descending score
+    std::sort(candidates.begin(), candidates.end());
+
+    selected.clear();
+    for(unsigned int i = 0, inCell = 0; i < candidates.size(); i++)
+    {
+	inCell = (i > 0 && candidates[i].cell == candidates[i - 1].cell) ? inCell + 1 : 0;
+	if((int) inCell < params.perCell)
+	    selected.push_back(candidates[i]);
+    }
+
+    if((int) selected.size() > params.maxFeatures)
+    {
+	std::vector<std::pair<unsigned short, unsigned int> > order(selected.size());
+	for(unsigned int i = 0; i < selected.size(); i++)
+	    order[i] = std::make_pair(selected[i].score, i);
+	std::nth_element(order.begin(), order.begin() + params.maxFeatures, order.end(),
+		std::greater<std::pair<unsigned short, unsigned int> >());
+
+	std::vector<Candidate> strongest(params.maxFeatures);
+	for(int i = 0; i < params.maxFeatures; i++)
+	    strongest[i] = selected[order[i].second];
+	selected.swap(strongest);
+    }
+
+    for(unsigned int l = 0; l < pyramid.size(); l++)
+	blur(pyramid[l]);
+
+    keypoints.resize(selected.size());
+    descriptors.resize(selected.size() * DESCRIPTOR_SIZE);
+
+    for(unsigned int i = 0; i < selected.size(); i++)
+    {
+	const Candidate &c = selected[i];
+	const Level &level = pyramid[c.level];
+	float scale = (float) (1 << c.level);
+
+	Keypoint &kp = keypoints[i];
+	kp.x = (c.x + 0.5f) * scale - 0.5f;
+	kp.y = (c.y + 0.5f) * scale - 0.5f;
+	kp.angle = orientation(level, c.x, c.y);
+	kp.response = c.score;
+	kp.level = c.level;
+
+	describe(level, c.x, c.y, kp.angle, &descriptors[i * DESCRIPTOR_SIZE]);
+    }
+}
+
+void FeatureDetector::buildPyramid(const unsigned char *data, unsigned int width, unsigned int height, unsigned int stepBytes)
+{
+    pyramid.resize(std::max(1, params.levels));
+
+    for(unsigned int l = 0; l < pyramid.size(); l++)
+    {
+	Level &level = pyramid[l];
+	level.width = l == 0 ? width : pyramid[l - 1].width / 2;
+	level.height = l == 0 ? height : pyramid[l - 1].height / 2;
+
+	// levels too small to hold a single cell are dropped
+	if(level.width < (unsigned int) (2 * BORDER + 16) || level.height < (unsigned int) (2 * BORDER + 1))
+	{
+	    pyramid.resize(l);
+	    break;
+	}
+
+	level.image.resize(level.width * level.height);
+	level.blurred.resize(level.width * level.height);
+	level.score.resize(level.width * level.height);
+	level.rowSum.resize(level.width * level.height);
+
+	if(l == 0)
+	{
+	    // 10 bit values in 16 bit words -> 8 bit
+	    for(unsigned int y = 0; y < height; y++)
+	    {
+		const unsigned char *src = data + y * stepBytes;
+		unsigned char *dst = &level.image[y * width];
+		unsigned int x = 0;
+
+		for(; x + 16 <= width; x += 16)
+		{
+		    __m128i a = _mm_srli_epi16(_mm_loadu_si128((const __m128i *) (src + x * 2)), 2);
+		    __m128i b = _mm_srli_epi16(_mm_loadu_si128((const __m128i *) (src + x * 2 + 16)), 2);
+		    _mm_storeu_si128((__m128i *) (dst + x), _mm_packus_epi16(a, b));
+		}
+		for(; x < width; x++)
+		{
+		    unsigned int v = (src[x * 2] | (src[x * 2 + 1] << 8)) >> 2;
+		    dst[x] = v > 255 ? 255 : v;
+		}
+	    }
+	}
+	else
+	{
+	    const Level &prev = pyramid[l - 1];
+	    for(unsigned int y = 0; y < level.height; y++)
+	    {
+		const unsigned char *r0 = &prev.image[2 * y * prev.width];
+		const unsigned char *r1 = r0 + prev.width;
+		unsigned char *dst = &level.image[y * level.width];
+
+		for(unsigned int x = 0; x < level.width; x++)
+		    dst[x] = (r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1] + 2) >> 2;
+	    }
+	}
+    }
+}
+
+static inline __m128i greaterMask(__m128i a, __m128i b, __m128i zero, __m128i ones)
+{
+    // unsigned a > b for every byte
+    return _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8(a, b), zero), ones);
+}
+
+void FeatureDetector::detectCorners(unsigned int l)
+{
+    Level &level = pyramid[l];
+    const int w = level.width, h = level.height;
+    const unsigned char *img = &level.image[0];
+    unsigned short *score = &level.score[0];
+
+    std::fill(level.score.begin(), level.score.end(), 0);
+
+    int offsets[16];
+    for(int k = 0; k < 16; k++)
+	offsets[k] = circleY[k] * w + circleX[k];
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(-1);
+    const __m128i t = _mm_set1_epi8((char) std::min(255, std::max(1, params.threshold)));
+    const int threshold = params.threshold;
+
+    std::vector<unsigned int> &corners = level.corners;
+    corners.clear();
+
+    const int xEnd = w - BORDER;
+    for(int y = BORDER; y < h - BORDER; y++)
+    {
+	int xDone = BORDER;
+	for(int x = BORDER; xDone < xEnd; x += 16)
+	{
+	    // the last block of a row is shifted back to stay inside the border
+	    if(x + 16 > xEnd) x = xEnd - 16;
+
+	    const unsigned char *p = img + y * w + x;
+	    __m128i c = _mm_loadu_si128((const __m128i *) p);
+	    __m128i hi = _mm_adds_epu8(c, t);
+	    __m128i lo = _mm_subs_epu8(c, t);
+
+	    __m128i b[16], d[16];
+	    for(int k = 0; k < 16; k += 4)
+	    {
+		__m128i ck = _mm_loadu_si128((const __m128i *) (p + offsets[k]));
+		b[k] = greaterMask(ck, hi, zero, ones);
+		d[k] = greaterMask(lo, ck, zero, ones);
+	    }
+
+	    // a contiguous arc of 9 always contains two neighbouring compass points
+	    __m128i quick = _mm_or_si128(
+		    _mm_or_si128(_mm_and_si128(b[0], b[4]), _mm_and_si128(b[4], b[8])),
+		    _mm_or_si128(_mm_and_si128(b[8], b[12]), _mm_and_si128(b[12], b[0])));
+	    quick = _mm_or_si128(quick, _mm_or_si128(
+		    _mm_or_si128(_mm_and_si128(d[0], d[4]), _mm_and_si128(d[4], d[8])),
+		    _mm_or_si128(_mm_and_si128(d[8], d[12]), _mm_and_si128(d[12], d[0]))));
+
+	    if(_mm_movemask_epi8(quick) != 0)
+	    {
+		for(int k = 0; k < 16; k++)
+		{
+		    if((k & 3) == 0) continue;
+		    __m128i ck = _mm_loadu_si128((const __m128i *) (p + offsets[k]));
+		    b[k] = greaterMask(ck, hi, zero, ones);
+		    d[k] = greaterMask(lo, ck, zero, ones);
+		}
+
+		// runs of 2, 4, 8 and 9 consecutive circle pixels
+		__m128i b2[16], d2[16], b4[16], d4[16];
+		for(int k = 0; k < 16; k++)
+		{
+		    b2[k] = _mm_and_si128(b[k], b[(k + 1) & 15]);
+		    d2[k] = _mm_and_si128(d[k], d[(k + 1) & 15]);
+		}
+		for(int k = 0; k < 16; k++)
+		{
+		    b4[k] = _mm_and_si128(b2[k], b2[(k + 2) & 15]);
+		    d4[k] = _mm_and_si128(d2[k], d2[(k + 2) & 15]);
+		}
+		__m128i any = zero;
+		for(int k = 0; k < 16; k++)
+		{
+		    __m128i b9 = _mm_and_si128(_mm_and_si128(b4[k], b4[(k + 4) & 15]), b[(k + 8) & 15]);
+		    __m128i d9 = _mm_and_si128(_mm_and_si128(d4[k], d4[(k + 4) & 15]), d[(k + 8) & 15]);
+		    any = _mm_or_si128(any, _mm_or_si128(b9, d9));
+		}
+
+		int mask = _mm_movemask_epi8(any);
+		while(mask)
+		{
+		    int i = __builtin_ctz(mask);
+		    mask &= mask - 1;
+		    if(x + i < xDone) continue;
+
+		    // score: sum of the differences exceeding the threshold, for the stronger polarity
+		    const unsigned char *q = p + i;
+		    int brighter = 0, darker = 0;
+		    for(int k = 0; k < 16; k++)
+		    {
+			int diff = q[offsets[k]] - q[0];
+			if(diff > threshold) brighter += diff - threshold;
+			else if(-diff > threshold) darker += -diff - threshold;
+		    }
+		    int s = std::max(brighter, darker);
+		    score[(q - img)] = (unsigned short) std::max(1, s);
+		    corners.push_back(q - img);
+		}
+	    }
+
+	    xDone = x + 16;
+	}
+    }
+
+    // 3x3 non maximum suppression, ties are resolved in raster order
+    const int cellSize = std::max(8, params.cellSize);
+    const unsigned int cellsX = (w + cellSize - 1) / cellSize;
+    const unsigned int cellBase = l << 20;
+
+    for(unsigned int i = 0; i < corners.size(); i++)
+    {
+	const unsigned int idx = corners[i];
+	const unsigned short s = score[idx];
+	const unsigned short *n = score + idx;
+
+	if(s <= n[-w - 1] || s <= n[-w] || s <= n[-w + 1] || s <= n[-1] ||
+		s < n[1] || s < n[w - 1] || s < n[w] || s < n[w + 1])
+	    continue;
+
+	Candidate c;
+	c.x = idx % w;
+	c.y = idx / w;
+	c.score = s;
+	c.level = l;
+	c.cell = cellBase + (c.y / cellSize) * cellsX + c.x / cellSize;
+	candidates.push_back(c);
+    }
+}
+
+void FeatureDetector::blur(Level &level)
+{
+    // 5x5 box filter, separable; the border rows/columns keep the unfiltered values
+    const int w = level.width, h = level.height;
+    const unsigned char *src = &level.image[0];
+    unsigned short *tmp = &level.rowSum[0];
+    unsigned char *dst = &level.blurred[0];
+
+    memcpy(dst, src, w * h);
+
+    for(int y = 0; y < h; y++)
+    {
+	const unsigned char *s = src + y * w;
+	unsigned short *t = tmp + y * w;
+	unsigned int sum = s[0] + s[1] + s[2] + s[3] + s[4];
+	t[2] = sum;
+	for(int x = 3; x < w - 2; x++)
+	{
+	    sum += s[x + 2] - s[x - 3];
+	    t[x] = sum;
+	}
+    }
+
+    for(int y = 2; y < h - 2; y++)
+    {
+	const unsigned short *t0 = tmp + (y - 2) * w;
+	unsigned char *d = dst + y * w;
+	for(int x = 2; x < w - 2; x++)
+	{
+	    unsigned int sum = t0[x] + t0[x + w] + t0[x + 2 * w] + t0[x + 3 * w] + t0[x + 4 * w];
+	    d[x] = (sum * 2621 + 32768) >> 16;   // sum / 25
+	}
+    }
+}
+
+float FeatureDetector::orientation(const Level &level, int x, int y) const
+{
+    // intensity centroid of the circular patch
+    const int w = level.width;
+    const unsigned char *center = &level.image[y * w + x];
+    int m01 = 0, m10 = 0;
+
+    for(int u = -PATCH_RADIUS; u <= PATCH_RADIUS; u++)
+	m10 += u * center[u];
+
+    for(int v = 1; v <= PATCH_RADIUS; v++)
+    {
+	int sumDiff = 0;
+	int extent = circleExtent[v];
+	for(int u = -extent; u <= extent; u++)
+	{
+	    int above = center[u - v * w], below = center[u + v * w];
+	    sumDiff += below - above;
+	    m10 += u * (below + above);
+	}
+	m01 += v * sumDiff;
+    }
+
+    return std::atan2((float) m01, (float) m10);
+}
+
+void FeatureDetector::describe(const Level &level, int x, int y, float angle, unsigned char *descriptor) const
+{
+    const int w = level.width;
+    const unsigned char *center = &level.blurred[y * w + x];
+
+    int bin = (int) floorf(angle * (ANGLE_BINS / (2.0f * (float) M_PI)) + 0.5f);
+    bin = ((bin % ANGLE_BINS) + ANGLE_BINS) % ANGLE_BINS;
+    const signed char *p = &pattern[bin * PATTERN_SIZE * 4];
+
+    for(int i = 0; i < DESCRIPTOR_SIZE; i++)
+    {
+	unsigned char byte = 0;
+	for(int bit = 0; bit < 8; bit++, p += 4)
+	{
+	    if(center[p[1] * w + p[0]] < center[p[3] * w + p[2]])
+		byte |= 1 << bit;
+	}
+	descriptor[i] = byte;
+    }
+}
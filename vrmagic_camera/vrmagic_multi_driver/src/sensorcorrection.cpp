@@ -0,0 +1,344 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2012, TU Darmstadt.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of TU Darmstadt nor the names of the
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include "sensorcorrection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <emmintrin.h>
+
+static const char CORRECTION_MAGIC[8] = { 'V', 'R', 'M', 'C', 'O', 'R', 'R', '1' };
+
+SensorCorrection::SensorCorrection() : width(0), height(0), frames(0), valid(false)
+{
+}
+
+void SensorCorrection::clear()
+{
+    dark.clear();
+    gain.clear();
+    defectMask.clear();
+    defects.clear();
+    valid = false;
+}
+
+void SensorCorrection::unpackRaw(const unsigned char *src, unsigned char *dst, unsigned int pixels)
+{
+    unpackRaw(src, dst, pixels, NULL, NULL);
+}
+
+void SensorCorrection::unpackRaw(const unsigned char *src, unsigned char *dst, unsigned int pixels,
+	const TemporalFilter *filter, unsigned short *history)
+{
+    const __m128i lowByte = _mm_set1_epi16(0x00ff);
+    const __m128i lowBits = _mm_set1_epi16(0x0003);
+    unsigned int i = 0;
+
+    for(; i + 8 <= pixels; i += 8)
+    {
+	__m128i w = _mm_loadu_si128((const __m128i *) (src + i * 2));
+	__m128i v = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(w, lowByte), 2),
+		_mm_and_si128(_mm_srli_epi16(w, 8), lowBits));
+	if(history)
+	    v = filter->apply(v, history + i);
+	_mm_storeu_si128((__m128i *) (dst + i * 2), v);
+    }
+
+    for(; i < pixels; i++)
+    {
+	unsigned int v = (src[i * 2] << 2) | (src[i * 2 + 1] & 0x3);
+	if(history)
+	    v = filter->apply(v, history + i);
+	dst[i * 2] = v & 0xff;
+	dst[i * 2 + 1] = v >> 8;
+    }
+}
+
+void SensorCorrection::unpackRaw(const unsigned char *src, unsigned int srcPitch, unsigned char *dst,
+	unsigned int width, unsigned int height, TemporalFilter *filter)
+{
+    unsigned short *history = filter && filter->isEnabled() ? filter->prepare(width, height) : NULL;
+
+    if(srcPitch == width * 2)
+    {
+	unpackRaw(src, dst, width * height, filter, history);
+	return;
+    }
+
+    for(unsigned int y = 0; y < height; y++)
+	unpackRaw(src + y * srcPitch, dst + y * width * 2, width, filter, history ? history + y * width : NULL);
+}
+
+void SensorCorrection::unpackCorrected(const unsigned char *src, unsigned char *dst,
+	const unsigned short *d, const unsigned short *g, unsigned int pixels,
+	const TemporalFilter *filter, unsigned short *history)
+{
+    const __m128i lowByte = _mm_set1_epi16(0x00ff);
+    const __m128i lowBits = _mm_set1_epi16(0x0003);
+    const __m128i maxValue = _mm_set1_epi16(1023);
+    unsigned int i = 0;
+
+    for(; i + 8 <= pixels; i += 8)
+    {
+	__m128i w = _mm_loadu_si128((const __m128i *) (src + i * 2));
+	__m128i v = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(w, lowByte), 2),
+		_mm_and_si128(_mm_srli_epi16(w, 8), lowBits));
+
+	// (v - dark) << 6 fits 16 bits, the high half of the product with gain is v * gain / 1024
+	v = _mm_subs_epu16(v, _mm_loadu_si128((const __m128i *) (d + i)));
+	v = _mm_mulhi_epu16(_mm_slli_epi16(v, 6), _mm_loadu_si128((const __m128i *) (g + i)));
+	v = _mm_min_epi16(v, maxValue);
+	if(history)
+	    v = filter->apply(v, history + i);
+	_mm_storeu_si128((__m128i *) (dst + i * 2), v);
+    }
+
+    for(; i < pixels; i++)
+    {
+	unsigned int v = (src[i * 2] << 2) | (src[i * 2 + 1] & 0x3);
+	v = v > d[i] ? v - d[i] : 0;
+	v = std::min(1023u, ((v << 6) * g[i]) >> 16);
+	if(history)
+	    v = filter->apply(v, history + i);
+	dst[i * 2] = v & 0xff;
+	dst[i * 2 + 1] = v >> 8;
+    }
+}
+
+void SensorCorrection::unpack(const unsigned char *src, unsigned int srcPitch, unsigned char *dst,
+	unsigned int width, unsigned int height, unsigned int left, unsigned int top,
+	TemporalFilter *filter) const
+{
+    if(!valid || left + width > this->width || top + height > this->height)
+    {
+	unpackRaw(src, srcPitch, dst, width, height, filter);
+	return;
+    }
+
+    unsigned short *history = filter && filter->isEnabled() ? filter->prepare(width, height) : NULL;
+
+    // the maps cover the full sensor, a window reads them row by row
+    const unsigned int offset = top * this->width + left;
+    if(srcPitch == width * 2 && width == this->width)
+	unpackCorrected(src, dst, &dark[offset], &gain[offset], width * height, filter, history);
+    else
+	for(unsigned int y = 0; y < height; y++)
+	    unpackCorrected(src + y * srcPitch, dst + y * width * 2,
+		    &dark[offset + y * this->width], &gain[offset + y * this->width], width,
+		    filter, history ? history + y * width : NULL);
+
+    unsigned short *out = (unsigned short *) dst;
+    for(unsigned int k = 0; k < defects.size(); k++)
+    {
+	unsigned int idx = defects[k];
+	unsigned int x = idx % this->width;
+	unsigned int y = idx / this->width;
+	if(x < left || x >= left + width || y < top || y >= top + height)
+	    continue;
+
+	unsigned int o = (y - top) * width + (x - left);
+	unsigned int sum = 0, count = 0;
+
+	if(x > left && !defectMask[idx - 1]) { sum += out[o - 1]; count++; }
+	if(x + 1 < left + width && !defectMask[idx + 1]) { sum += out[o + 1]; count++; }
+	if(count)
+	    out[o] = sum / count;
+    }
+}
+
+void SensorCorrection::beginCapture(unsigned int width, unsigned int height)
+{
+    if(width != this->width || height != this->height)
+	clear();
+
+    this->width = width;
+    this->height = height;
+    sum.assign(width * height, 0);
+    frames = 0;
+}
+
+void SensorCorrection::accumulate(const unsigned char *mono16)
+{
+    const unsigned short *in = (const unsigned short *) mono16;
+    for(unsigned int i = 0; i < sum.size(); i++)
+	sum[i] += in[i];
+    frames++;
+}
+
+void SensorCorrection::finishDark(unsigned int hotThreshold)
+{
+    if(frames == 0)
+	return;
+
+    const unsigned int pixels = width * height;
+    dark.resize(pixels);
+    if(gain.size() != pixels)
+	gain.assign(pixels, 1024);
+    if(defectMask.size() != pixels)
+	defectMask.assign(pixels, 0);
+
+    unsigned long long total = 0;
+    for(unsigned int i = 0; i < pixels; i++)
+    {
+	dark[i] = (sum[i] + frames / 2) / frames;
+	total += dark[i];
+    }
+
+    unsigned int mean = total / pixels;
+    for(unsigned int i = 0; i < pixels; i++)
+    {
+	if(dark[i] > mean + hotThreshold)
+	    defectMask[i] |= DEFECT_HOT;
+	else
+	    defectMask[i] &= ~DEFECT_HOT;
+    }
+
+    sum.clear();
+    frames = 0;
+    updateDefects();
+}
+
+void SensorCorrection::finishFlat(float maxDeviation)
+{
+    if(frames == 0)
+	return;
+
+    const unsigned int pixels = width * height;
+    if(dark.size() != pixels)
+	dark.assign(pixels, 0);
+    if(defectMask.size() != pixels)
+	defectMask.assign(pixels, 0);
+    gain.resize(pixels);
+
+    // dark corrected response of every pixel, in 1/frames counts
+    std::vector<float> response(pixels);
+    double total = 0.0;
+    for(unsigned int i = 0; i < pixels; i++)
+    {
+	float r = (float) sum[i] / frames - dark[i];
+	response[i] = r;
+	total += r;
+    }
+
+    float mean = total / pixels;
+    for(unsigned int i = 0; i < pixels; i++)
+    {
+	float r = response[i];
+	if(r <= 0.0f || std::abs(r - mean) > maxDeviation * mean)
+	{
+	    defectMask[i] |= DEFECT_FLAT;
+	    gain[i] = 1024;
+	    continue;
+	}
+
+	defectMask[i] &= ~DEFECT_FLAT;
+	gain[i] = (unsigned short) std::min(32767.0f, 1024.0f * mean / r + 0.5f);
+    }
+
+    sum.clear();
+    frames = 0;
+    updateDefects();
+}
+
+void SensorCorrection::updateDefects()
+{
+    defects.clear();
+    for(unsigned int i = 0; i < defectMask.size(); i++)
+	if(defectMask[i])
+	    defects.push_back(i);
+
+    valid = width * height > 0 && dark.size() == width * height && gain.size() == width * height;
+}
+
+bool SensorCorrection::load(const std::string &fileName)
+{
+    std::ifstream in(fileName.c_str(), std::ios::binary);
+    if(!in)
+	return false;
+
+    char magic[8];
+    unsigned int size[2];
+    in.read(magic, sizeof(magic));
+    in.read((char *) size, sizeof(size));
+    if(!in || memcmp(magic, CORRECTION_MAGIC, sizeof(magic)) != 0)
+    {
+	std::cerr << fileName << " is not a sensor correction file." << std::endl;
+	return false;
+    }
+
+    const unsigned int pixels = size[0] * size[1];
+    std::vector<unsigned short> newDark(pixels), newGain(pixels);
+    std::vector<unsigned char> newMask(pixels);
+    in.read((char *) &newDark[0], pixels * sizeof(unsigned short));
+    in.read((char *) &newGain[0], pixels * sizeof(unsigned short));
+    in.read((char *) &newMask[0], pixels);
+    if(!in)
+    {
+	std::cerr << fileName << " is truncated." << std::endl;
+	return false;
+    }
+
+    width = size[0];
+    height = size[1];
+    dark.swap(newDark);
+    gain.swap(newGain);
+    defectMask.swap(newMask);
+    updateDefects();
+    return true;
+}
+
+bool SensorCorrection::save(const std::string &fileName) const
+{
+    if(!valid)
+	return false;
+
+    std::ofstream out(fileName.c_str(), std::ios::binary | std::ios::trunc);
+    unsigned int size[2] = { width, height };
+    out.write(CORRECTION_MAGIC, sizeof(CORRECTION_MAGIC));
+    out.write((const char *) size, sizeof(size));
+    out.write((const char *) &dark[0], dark.size() * sizeof(unsigned short));
+    out.write((const char *) &gain[0], gain.size() * sizeof(unsigned short));
+    out.write((const char *) &defectMask[0], defectMask.size());
+
+    if(!out)
+    {
+	std::cerr << "could not write " << fileName << "." << std::endl;
+	return false;
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2012, TU Darmstadt.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of TU Darmstadt nor the names of the
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include "temporalfilter.h"
+
+#include <algorithm>
+
+TemporalFilter::TemporalFilter() : enabled(false), primed(false), width(0), height(0),
+    frameWeight(16384), frameSlope(0)
+{
+    setParams(0.25f, 24);
+}
+
+void TemporalFilter::setEnabled(bool enabled)
+{
+    if(enabled && !this->enabled)
+	primed = false;
+    this->enabled = enabled;
+}
+
+void TemporalFilter::setParams(float staticWeight, unsigned int motionThreshold)
+{
+    staticWeight = std::min(1.0f, std::max(1.0f / 256.0f, staticWeight));
+    this->staticWeight = (short) (staticWeight * 16384.0f + 0.5f);
+    threshold = (short) std::min(1023u, std::max(1u, motionThreshold)) * 16;
+    slope = (short) std::max(1, (16384 - this->staticWeight + threshold / 2) / threshold);
+}
+
+unsigned short *TemporalFilter::prepare(unsigned int width, unsigned int height)
+{
+    if(width != this->width || height != this->height)
+    {
+	this->width = width;
+	this->height = height;
+	history.resize(width * height);
+	primed = false;
+    }
+
+    if(history.empty())
+	return NULL;
+
+    // the first frame is copied into the history
+    frameWeight = primed ? staticWeight : 16384;
+    frameSlope = primed ? slope : 0;
+    primed = true;
+    return &history[0];
+}
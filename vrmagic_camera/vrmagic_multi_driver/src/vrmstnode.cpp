@@ -36,10 +36,17 @@
 #include "sourceformatlist.h"
 #include "formatindicator.h"
 
+#include <hector_trace/ros_trace.h>
+#include <hector_realtime/ros_realtime.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
 
 #include <signal.h>
+#include <sys/stat.h>
 
 VRMagicStereoNode *vrsnode = NULL;
 
@@ -62,8 +69,33 @@ public:
     int gainLeft, gainRight;
     float fps;
     VRmBOOL useLEDs;
+    bool roiEnabled;
+    int roiLeft, roiTop, roiWidth, roiHeight;
+    bool denoise;
+    double denoiseStaticWeight;
+    int denoiseMotionThreshold;
 };
 
+static void shiftPrincipalPoint(sensor_msgs::CameraInfo &info, double dx, double dy)
+{
+    // uncalibrated cameras keep their zero matrices
+    if(info.K[0] == 0.0)
+	return;
+
+    info.K[2] += dx;
+    info.K[5] += dy;
+    info.P[2] += dx;
+    info.P[6] += dy;
+}
+
+// node handle whose callbacks are served from the given queue
+static ros::NodeHandle queuedHandle(const std::string &ns, ros::CallbackQueue *queue)
+{
+    ros::NodeHandle nh(ns);
+    nh.setCallbackQueue(queue);
+    return nh;
+}
+
 void VRMagicStereoNode::propertyUpdate(vrmagic_multi_driver::CamParamsConfig &config, uint32_t level)
 {
     if(props->exposureTime != config.exposureTime)
@@ -122,6 +154,53 @@ void VRMagicStereoNode::propertyUpdate(vrmagic_multi_driver::CamParamsConfig &co
 	    props->useLEDs = newValue;
     }
 
+    // everything below changes the acquisition itself and is left to the acquisition loop
+    boost::lock_guard<boost::mutex> lock(configAccess);
+    pendingConfig = config;
+    configPending = true;
+}
+
+void VRMagicStereoNode::applyPendingConfig()
+{
+    vrmagic_multi_driver::CamParamsConfig config;
+    {
+	boost::lock_guard<boost::mutex> lock(configAccess);
+	if(!configPending)
+	    return;
+	config = pendingConfig;
+	configPending = false;
+    }
+
+    if(props->roiEnabled != config.roiEnabled || (config.roiEnabled &&
+	    (props->roiLeft != config.roiLeft || props->roiTop != config.roiTop ||
+	     props->roiWidth != config.roiWidth || props->roiHeight != config.roiHeight)))
+    {
+	props->roiEnabled = config.roiEnabled;
+	props->roiLeft = config.roiLeft;
+	props->roiTop = config.roiTop;
+	props->roiWidth = config.roiWidth;
+	props->roiHeight = config.roiHeight;
+
+	// the first window waits for a full frame, which is the reference of the acquisition report
+	windowPending = config.roiEnabled && fullFrameAcquisitionTime <= 0.0;
+	if(windowPending)
+	    std::cout << "sensor window is applied after the first full frame." << std::endl;
+	else
+	    setSensorWindow(config.roiEnabled, config.roiLeft, config.roiTop, config.roiWidth, config.roiHeight);
+    }
+
+    if(props->denoise != config.denoise || props->denoiseStaticWeight != config.denoiseStaticWeight ||
+	    props->denoiseMotionThreshold != config.denoiseMotionThreshold)
+    {
+	filterLeft.setParams(config.denoiseStaticWeight, config.denoiseMotionThreshold);
+	filterRight.setParams(config.denoiseStaticWeight, config.denoiseMotionThreshold);
+	filterLeft.setEnabled(config.denoise);
+	filterRight.setEnabled(config.denoise);
+	props->denoise = config.denoise;
+	props->denoiseStaticWeight = config.denoiseStaticWeight;
+	props->denoiseMotionThreshold = config.denoiseMotionThreshold;
+    }
+
     if(props->fps != config.fps)
     {
 	boost::lock_guard<boost::mutex> lock(timerAccess);
@@ -134,8 +213,13 @@ void VRMagicStereoNode::propertyUpdate(vrmagic_multi_driver::CamParamsConfig &co
 bool VRMagicStereoNode::runUpdateLeft(sensor_msgs::SetCameraInfo::Request &req,
     sensor_msgs::SetCameraInfo::Response &res)
 {
+    boost::lock_guard<boost::mutex> acquisitionLock(acquisitionAccess);
     boost::lock_guard<boost::mutex> lock(calibAccess);
+    // calibrated on the current window, stored for the full sensor
     leftCalib = req.camera_info;
+    leftCalib.width = sensorWidth;
+    leftCalib.height = sensorHeight;
+    shiftPrincipalPoint(leftCalib, roiLeft, roiTop);
     storeCalibration();
     res.success = true;
     res.status_message = "Calibration updated";
@@ -145,14 +229,133 @@ bool VRMagicStereoNode::runUpdateLeft(sensor_msgs::SetCameraInfo::Request &req,
 bool VRMagicStereoNode::runUpdateRight(sensor_msgs::SetCameraInfo::Request &req,
     sensor_msgs::SetCameraInfo::Response &res)
 {
+    boost::lock_guard<boost::mutex> acquisitionLock(acquisitionAccess);
     boost::lock_guard<boost::mutex> lock(calibAccess);
     rightCalib = req.camera_info;
+    rightCalib.width = sensorWidth;
+    rightCalib.height = sensorHeight;
+    shiftPrincipalPoint(rightCalib, roiLeft, roiTop);
     storeCalibration();
     res.success = true;
     res.status_message = "Calibration updated";
     return true;
 }
 
+bool VRMagicStereoNode::captureCorrectionFrames()
+{
+    ros::NodeHandle pn("~");
+    int frames;
+    pn.param("correction_frames", frames, 16);
+
+    if(width != sensorWidth || height != sensorHeight)
+    {
+	std::cerr << "correction frames need the full sensor, disable the sensor window first." << std::endl;
+	return false;
+    }
+
+    sensor_msgs::Image left, right;
+    correctionLeft.beginCapture(width, height);
+    correctionRight.beginCapture(width, height);
+
+    for(int i = 0; i < frames; i++)
+    {
+	try
+	{
+	    ros::Time triggerTime = triggerFrame();
+	    grabFrame(1, left, triggerTime, NULL, NULL);
+	    grabFrame(3, right, triggerTime, NULL, NULL);
+	}
+	catch(VRGrabException &ex)
+	{
+	    std::cerr << ex << std::endl;
+	    return false;
+	}
+
+	correctionLeft.accumulate(&left.data[0]);
+	correctionRight.accumulate(&right.data[0]);
+    }
+
+    return frames > 0;
+}
+
+bool VRMagicStereoNode::runCaptureDark(std_srvs::Empty::Request &req, std_srvs::Empty::Response &res)
+{
+    ros::NodeHandle pn("~");
+    int hotThreshold;
+    pn.param("hot_pixel_threshold", hotThreshold, 64);
+
+    boost::lock_guard<boost::mutex> lock(acquisitionAccess);
+    if(!captureCorrectionFrames())
+	return false;
+
+    correctionLeft.finishDark(hotThreshold);
+    correctionRight.finishDark(hotThreshold);
+    std::cout << "dark frame captured, " << correctionLeft.defectCount() << "/"
+	    << correctionRight.defectCount() << " defective pixels." << std::endl;
+
+    storeCorrection();
+    return true;
+}
+
+bool VRMagicStereoNode::runCaptureFlat(std_srvs::Empty::Request &req, std_srvs::Empty::Response &res)
+{
+    ros::NodeHandle pn("~");
+    double maxDeviation;
+    pn.param("flat_max_deviation", maxDeviation, 0.5);
+
+    boost::lock_guard<boost::mutex> lock(acquisitionAccess);
+    if(!captureCorrectionFrames())
+	return false;
+
+    correctionLeft.finishFlat(maxDeviation);
+    correctionRight.finishFlat(maxDeviation);
+    std::cout << "flat field captured, " << correctionLeft.defectCount() << "/"
+	    << correctionRight.defectCount() << " defective pixels." << std::endl;
+
+    storeCorrection();
+    return true;
+}
+
+bool VRMagicStereoNode::runClearCorrection(std_srvs::Empty::Request &req, std_srvs::Empty::Response &res)
+{
+    boost::lock_guard<boost::mutex> lock(acquisitionAccess);
+    correctionLeft.clear();
+    correctionRight.clear();
+    remove((correctionDir + "/left.correction").c_str());
+    remove((correctionDir + "/right.correction").c_str());
+    std::cout << "sensor correction cleared." << std::endl;
+    return true;
+}
+
+void VRMagicStereoNode::loadCorrection()
+{
+    // the maps are too large for the camera's user data, they are kept in files on the host
+    std::string defaultDir;
+    if(getenv("ROS_HOME"))
+	defaultDir = std::string(getenv("ROS_HOME")) + "/vrmagic_correction";
+    else if(getenv("HOME"))
+	defaultDir = std::string(getenv("HOME")) + "/.ros/vrmagic_correction";
+
+    ros::NodeHandle("~").param("correction_dir", correctionDir, defaultDir);
+
+    if(correctionLeft.load(correctionDir + "/left.correction") &&
+	    correctionRight.load(correctionDir + "/right.correction"))
+	std::cout << "sensor correction loaded from " << correctionDir << std::endl;
+    else
+    {
+	correctionLeft.clear();
+	correctionRight.clear();
+    }
+}
+
+void VRMagicStereoNode::storeCorrection()
+{
+    mkdir(correctionDir.c_str(), 0755);
+    if(correctionLeft.save(correctionDir + "/left.correction") &&
+	    correctionRight.save(correctionDir + "/right.correction"))
+	std::cout << "sensor correction written to " << correctionDir << std::endl;
+}
+
 void VRMagicStereoNode::loadCalibration()
 {
         VRmUserData *uData;
@@ -207,21 +410,36 @@ void VRMagicStereoNode::storeCalibration()
 
 void VRMagicStereoNode::AnnounceTopics()
 {
-	camPubLeft = image_transport::ImageTransport(leftNs).advertiseCamera("image_raw", 2);
-	camPubRight = image_transport::ImageTransport(rightNs).advertiseCamera("image_raw", 2);
+	camPubLeft = image_transport::ImageTransport(leftNs).advertiseCamera("image_raw", publishQueueSize);
+	camPubRight = image_transport::ImageTransport(rightNs).advertiseCamera("image_raw", publishQueueSize);
+        if(featuresEnabled)
+        {
+            featPubLeft = leftNs.advertise<vrmagic_multi_driver::Features>("features", publishQueueSize);
+            featPubRight = rightNs.advertise<vrmagic_multi_driver::Features>("features", publishQueueSize);
+        }
         leftCalibUpdate = leftNs.advertiseService("set_camera_info", &VRMagicStereoNode::runUpdateLeft, this);
         rightCalibUpdate = rightNs.advertiseService("set_camera_info", &VRMagicStereoNode::runUpdateRight, this);
+
+        ros::NodeHandle pn = queuedHandle("~", &serviceQueue);
+        captureDarkService = pn.advertiseService("capture_dark_frame", &VRMagicStereoNode::runCaptureDark, this);
+        captureFlatService = pn.advertiseService("capture_flat_field", &VRMagicStereoNode::runCaptureFlat, this);
+        clearCorrectionService = pn.advertiseService("clear_sensor_correction", &VRMagicStereoNode::runClearCorrection, this);
 }
 
 void VRMagicStereoNode::AbandonTopics()
 {
         camPubLeft.shutdown();
         camPubRight.shutdown();
+        featPubLeft.shutdown();
+        featPubRight.shutdown();
 	leftCalibUpdate.shutdown();
 	rightCalibUpdate.shutdown();
+	captureDarkService.shutdown();
+	captureFlatService.shutdown();
+	clearCorrectionService.shutdown();
 }
 
-void VRMagicStereoNode::broadcastFrame()
+ros::Time VRMagicStereoNode::triggerFrame()
 {
     camAccess.lock();
     VRmRetVal success = VRmUsbCamSoftTrigger(device);
@@ -230,37 +448,246 @@ void VRMagicStereoNode::broadcastFrame()
         throw VRGrabException("VRmUsbCamSoftTrigger failed.");
 
     ros::Time triggerTime = ros::Time::now();
+    HECTOR_TRACE_INSTANT("vrmstnode/trigger", triggerTime.toNSec());
+    return triggerTime;
+}
+
+bool VRMagicStereoNode::broadcastFrame()
+{
+    bool left = camPubLeft.getNumSubscribers() > 0 || featPubLeft.getNumSubscribers() > 0;
+    bool right = camPubRight.getNumSubscribers() > 0 || featPubRight.getNumSubscribers() > 0;
+
+    // the denoising history of a sensor that was paused no longer matches the scene
+    if(left && !grabbingLeft)
+	filterLeft.reset();
+    if(right && !grabbingRight)
+	filterRight.reset();
+    grabbingLeft = left;
+    grabbingRight = right;
+
+    // without subscribers the camera is not triggered at all, so nothing is transferred over USB
+    if(!left && !right)
+    {
+	if(acquiring)
+	    std::cout << "no subscribers, acquisition paused." << std::endl;
+	acquiring = false;
+	return false;
+    }
 
-    grabFrame(1, imgLeft, triggerTime);
-    grabFrame(3, imgRight, triggerTime);
+    if(!acquiring)
+	std::cout << "acquisition resumed." << std::endl;
+    acquiring = true;
+
+    HECTOR_TRACE_SCOPE("vrmstnode/broadcast_frame");
+
+    int64_t acquisitionStart = hector_realtime::getMonotonicTime();
+    ros::Time triggerTime = triggerFrame();
+
+    // both sensors are exposed on a trigger, the image of an unused sensor is released unconverted
+    if(left)
+	grabFrame(1, imgLeft, triggerTime, &correctionLeft, &filterLeft);
+    else
+	discardFrame(1);
+    if(right)
+	grabFrame(3, imgRight, triggerTime, &correctionRight, &filterRight);
+    else
+	discardFrame(3);
+    recordAcquisitionTime((hector_realtime::getMonotonicTime() - acquisitionStart) * 1e-9);
+    if(windowPending)
+    {
+	windowPending = false;
+	setSensorWindow(props->roiEnabled, props->roiLeft, props->roiTop, props->roiWidth, props->roiHeight);
+    }
+    publishFeatures(triggerTime, left, right);
     leftCalib.header.stamp = triggerTime;
     leftCalib.header.frame_id = frame_id;
     rightCalib.header.stamp = triggerTime;
     rightCalib.header.frame_id = frame_id;
 
-    try
+    HECTOR_TRACE_SCOPE_ID("vrmstnode/publish", triggerTime.toNSec());
+
+    if(left && camPubLeft.getNumSubscribers() > 0)
+    {
+	try
+	{
+	    boost::lock_guard<boost::mutex> lock(calibAccess);
+	    windowCalibration(leftCalib, leftInfo);
+	    camPubLeft.publish(imgLeft, leftInfo);
+	}
+	catch(ros::serialization::StreamOverrunException &crap)
+	{
+	    std::cerr << "stream overrun in left channel" << std::endl;
+	}
+    }
+
+    if(right && camPubRight.getNumSubscribers() > 0)
+    {
+	try
+	{
+	    boost::lock_guard<boost::mutex> lock(calibAccess);
+	    windowCalibration(rightCalib, rightInfo);
+	    camPubRight.publish(imgRight, rightInfo);
+	}
+	catch(ros::serialization::StreamOverrunException &crap)
+	{
+	    std::cerr << "stream overrun in right channel" << std::endl;
+	}
+    }
+
+    return true;
+}
+
+void VRMagicStereoNode::adaptFrameRate(double cycleTime, double period)
+{
+    // roscpp does not expose the fill level of the subscriber queues; when publishing to the
+    // current subscribers does not fit into the frame period, frames would only pile up and be
+    // dropped there, so the trigger rate is halved until the cycle fits again.
+    // A triggered cycle has frameDivider periods until the next trigger.
+    double budget = period * frameDivider;
+    if(cycleTime > 0.9 * budget)
     {
-	boost::lock_guard<boost::mutex> lock(calibAccess);
-	camPubLeft.publish(imgLeft, leftCalib);
-     }
-     catch(ros::serialization::StreamOverrunException &crap)
-     {
-	 std::cerr << "stream overrun in left channel" << std::endl;
-     }
-
-     try
-     {
-	 boost::lock_guard<boost::mutex> lock(calibAccess);
-	 camPubRight.publish(imgRight, rightCalib);
-      }
-      catch(ros::serialization::StreamOverrunException &crap)
-      {
-	  std::cerr << "stream overrun in right channel" << std::endl;
-      }
-}
-
-void VRMagicStereoNode::grabFrame(VRmDWORD port, sensor_msgs::Image &img, const ros::Time &triggerTime)
+	headroomCycles = 0;
+	if(++overrunCycles >= 3 && frameDivider < maxFrameDivider)
+	{
+	    frameDivider *= 2;
+	    overrunCycles = 0;
+	    std::cout << "publishing falls behind, triggering every " << frameDivider << ". frame." << std::endl;
+	}
+    }
+    else
+    {
+	overrunCycles = 0;
+	// halving the divider halves the budget, so only step down while the cycle would
+	// still use less than 80% of the smaller budget
+	if(frameDivider > 1 && cycleTime < 0.4 * budget)
+	{
+	    if(++headroomCycles >= 30)
+	    {
+		frameDivider /= 2;
+		headroomCycles = 0;
+		std::cout << "triggering every " << frameDivider << ". frame." << std::endl;
+	    }
+	}
+	else
+	    headroomCycles = 0;
+    }
+}
+
+void VRMagicStereoNode::windowCalibration(const sensor_msgs::CameraInfo &full, sensor_msgs::CameraInfo &window) const
+{
+    // the principal point moves with the window origin
+    window = full;
+    window.width = width;
+    window.height = height;
+    shiftPrincipalPoint(window, -(double) roiLeft, -(double) roiTop);
+}
+
+void VRMagicStereoNode::recordAcquisitionTime(double seconds)
 {
+    acquisitionTime = acquisitionTime > 0.0 ? 0.9 * acquisitionTime + 0.1 * seconds : seconds;
+
+    if(width == sensorWidth && height == sensorHeight)
+	fullFrameAcquisitionTime = acquisitionTime;
+
+    if(roiReportFrames > 0 && --roiReportFrames == 0 && fullFrameAcquisitionTime > 0.0)
+    {
+	// the achievable frame rate is bounded by the acquisition and by ~fps
+	double fps;
+	{
+	    boost::lock_guard<boost::mutex> lock(timerAccess);
+	    fps = 1.0 / fpsLimit.expectedCycleTime().toSec();
+	}
+
+	std::cout << "sensor window " << width << "x" << height << " ("
+		<< 100 * width * height / (sensorWidth * sensorHeight) << "% of the pixels): acquisition "
+		<< fullFrameAcquisitionTime * 1e3 << " ms -> " << acquisitionTime * 1e3
+		<< " ms, frame rate limit " << std::min(1.0 / fullFrameAcquisitionTime, fps) << " -> "
+		<< std::min(1.0 / acquisitionTime, fps) << " fps." << std::endl;
+    }
+}
+
+void VRMagicStereoNode::setSensorWindow(bool enabled, int left, int top, int roiWidth, int roiHeight)
+{
+    VRmRectI rect;
+    rect.m_left = 0;
+    rect.m_top = 0;
+    rect.m_width = sensorWidth;
+    rect.m_height = sensorHeight;
+    if(enabled)
+    {
+	rect.m_left = std::min(std::max(left, 0), (int) sensorWidth - 16);
+	rect.m_top = std::min(std::max(top, 0), (int) sensorHeight - 16);
+	rect.m_width = std::min(std::max(roiWidth, 16), (int) sensorWidth - rect.m_left);
+	rect.m_height = std::min(std::max(roiHeight, 16), (int) sensorHeight - rect.m_top);
+    }
+
+    boost::lock_guard<boost::mutex> lock(camAccess);
+
+    if(!VRmUsbCamStop(device))
+	throw VRControlException("VRmUsbCamStop failed.");
+
+    if(hardwareRoi)
+    {
+	VRmPropId sensors[2] = { VRM_PROPID_GRAB_SENSOR_PROPS_SELECT_1, VRM_PROPID_GRAB_SENSOR_PROPS_SELECT_3 };
+	VRmRectI actual = rect;
+	for(int i = 0; i < 2; i++)
+	{
+	    VRmUsbCamSetPropertyValueE(device, VRM_PROPID_GRAB_SENSOR_PROPS_SELECT_E, &sensors[i]);
+	    if(!VRmUsbCamSetPropertyValueRectI(device, VRM_PROPID_GRAB_SENSOR_ROI_SOURCE_R, &rect) ||
+		    !VRmUsbCamGetPropertyValueRectI(device, VRM_PROPID_GRAB_SENSOR_ROI_SOURCE_R, &actual))
+	    {
+		std::cerr << "VRmUsbCamSetPropertyValueRectI(GRAB_SENSOR_ROI_SOURCE_R) failed, cropping in software." << std::endl;
+		hardwareRoi = false;
+		break;
+	    }
+	}
+
+	if(hardwareRoi)
+	    rect = actual;   // the sensor may align the window
+	else
+	{
+	    VRmRectI full;
+	    full.m_left = 0;
+	    full.m_top = 0;
+	    full.m_width = sensorWidth;
+	    full.m_height = sensorHeight;
+	    for(int i = 0; i < 2; i++)
+	    {
+		VRmUsbCamSetPropertyValueE(device, VRM_PROPID_GRAB_SENSOR_PROPS_SELECT_E, &sensors[i]);
+		VRmUsbCamSetPropertyValueRectI(device, VRM_PROPID_GRAB_SENSOR_ROI_SOURCE_R, &full);
+	    }
+	}
+    }
+
+    softwareCrop = enabled && !hardwareRoi;
+    width = rect.m_width;
+    height = rect.m_height;
+    roiLeft = rect.m_left;
+    roiTop = rect.m_top;
+
+    // a moved window of the same size would otherwise be blended with the old view
+    filterLeft.reset();
+    filterRight.reset();
+
+    if(!VRmUsbCamStart(device))
+	throw VRControlException("VRmUsbCamStart failed.");
+
+    acquisitionTime = 0.0;
+    if(!enabled)
+	std::cout << "sensor window disabled, reading out " << width << "x" << height << "." << std::endl;
+    else
+    {
+	std::cout << "sensor window " << width << "x" << height << " at (" << roiLeft << ", " << roiTop << "), "
+		<< (hardwareRoi ? "read out by the sensors." : "cropped in software.") << std::endl;
+	roiReportFrames = 30;
+    }
+}
+
+void VRMagicStereoNode::grabFrame(VRmDWORD port, sensor_msgs::Image &img, const ros::Time &triggerTime,
+	const SensorCorrection *correction, TemporalFilter *filter)
+{
+    HECTOR_TRACE_SCOPE_ID("vrmstnode/grab_frame", triggerTime.toNSec());
+
     img.width = width;
     img.height = height;
     img.step = width * 2;
@@ -280,12 +707,14 @@ void VRMagicStereoNode::grabFrame(VRmDWORD port, sensor_msgs::Image &img, const
         throw VRGrabException(err.str().c_str());
     }
 
-    for(unsigned int i = 0; i < height * width; i++)
-    {
-	img.data[i * 2 + 1] = VRimg->mp_buffer[i * 2] >> 6;
-	img.data[i * 2] = (VRimg->mp_buffer[i * 2] << 2)
-		| (VRimg->mp_buffer[i * 2 + 1] & 0x3);
-    }
+    const unsigned char *src = VRimg->mp_buffer;
+    if(softwareCrop)
+	src += roiTop * VRimg->m_pitch + roiLeft * 2;
+
+    if(correction)
+	correction->unpack(src, VRimg->m_pitch, &img.data[0], width, height, roiLeft, roiTop, filter);
+    else
+	SensorCorrection::unpackRaw(src, VRimg->m_pitch, &img.data[0], width, height, filter);
 
     if(!VRmUsbCamUnlockNextImage(device, &VRimg))
         throw VRGrabException("VRmUsbCamUnlockNextImage failed.");
@@ -294,6 +723,132 @@ void VRMagicStereoNode::grabFrame(VRmDWORD port, sensor_msgs::Image &img, const
         throw VRGrabException("VRmUsbCamFreeImage failed.");
 }
 
+static void fillFeatures(const FeatureDetector &detector, vrmagic_multi_driver::Features &msg)
+{
+    const std::vector<FeatureDetector::Keypoint> &keypoints = detector.getKeypoints();
+
+    msg.x.resize(keypoints.size());
+    msg.y.resize(keypoints.size());
+    msg.angle.resize(keypoints.size());
+    msg.response.resize(keypoints.size());
+    msg.octave.resize(keypoints.size());
+    for(unsigned int i = 0; i < keypoints.size(); i++)
+    {
+	msg.x[i] = keypoints[i].x;
+	msg.y[i] = keypoints[i].y;
+	msg.angle[i] = keypoints[i].angle;
+	msg.response[i] = keypoints[i].response;
+	msg.octave[i] = keypoints[i].level;
+    }
+
+    msg.descriptor_size = FeatureDetector::DESCRIPTOR_SIZE;
+    msg.descriptors = detector.getDescriptors();
+}
+
+void VRMagicStereoNode::initFeatures()
+{
+    ros::NodeHandle pn("~features");
+    pn.param("enable", featuresEnabled, false);
+
+    FeatureDetector::Params params;
+    pn.param("levels", params.levels, params.levels);
+    pn.param("threshold", params.threshold, params.threshold);
+    pn.param("cell_size", params.cellSize, params.cellSize);
+    pn.param("per_cell", params.perCell, params.perCell);
+    pn.param("max_features", params.maxFeatures, params.maxFeatures);
+    detectorLeft.setParams(params);
+    detectorRight.setParams(params);
+
+    if(featuresEnabled)
+	featureWorker = boost::thread(boost::bind(&VRMagicStereoNode::featureWorkerLoop, this));
+}
+
+void VRMagicStereoNode::featureWorkerLoop()
+{
+    boost::unique_lock<boost::mutex> lock(featureAccess);
+    while(true)
+    {
+	while(featureJobs.empty() && !featureWorkerStop)
+	    featureQueued.wait(lock);
+	if(featureJobs.empty())
+	    return;
+
+	boost::function<void ()> job = featureJobs.front();
+	featureJobs.pop_front();
+
+	lock.unlock();
+	job();
+	lock.lock();
+
+	if(--featureJobsPending == 0)
+	    featureDone.notify_all();
+    }
+}
+
+void VRMagicStereoNode::publishFeatures(const ros::Time &triggerTime, bool grabbedLeft, bool grabbedRight)
+{
+    if(!featuresEnabled)
+	return;
+
+    // only images grabbed in this cycle, a subscriber that connected since then waits for the next one
+    bool left = grabbedLeft && featPubLeft.getNumSubscribers() > 0;
+    bool right = grabbedRight && featPubRight.getNumSubscribers() > 0;
+    if(!left && !right)
+	return;
+
+    HECTOR_TRACE_SCOPE_ID("vrmstnode/features", triggerTime.toNSec());
+
+    // the right sensor is processed by the worker thread, the left one in this thread
+    if(right)
+    {
+	boost::lock_guard<boost::mutex> lock(featureAccess);
+	featureJobs.push_back(boost::bind(&FeatureDetector::detect, &detectorRight,
+		    &imgRight.data[0], imgRight.width, imgRight.height, imgRight.step));
+	featureJobsPending++;
+	featureQueued.notify_one();
+    }
+    if(left)
+	detectorLeft.detect(&imgLeft.data[0], imgLeft.width, imgLeft.height, imgLeft.step);
+    if(right)
+    {
+	boost::unique_lock<boost::mutex> lock(featureAccess);
+	while(featureJobsPending > 0)
+	    featureDone.wait(lock);
+    }
+
+    if(left)
+    {
+	featuresLeft.header.stamp = triggerTime;
+	featuresLeft.header.frame_id = frame_id;
+	featuresLeft.width = imgLeft.width;
+	featuresLeft.height = imgLeft.height;
+	fillFeatures(detectorLeft, featuresLeft);
+	featPubLeft.publish(featuresLeft);
+    }
+
+    if(right)
+    {
+	featuresRight.header.stamp = triggerTime;
+	featuresRight.header.frame_id = frame_id;
+	featuresRight.width = imgRight.width;
+	featuresRight.height = imgRight.height;
+	fillFeatures(detectorRight, featuresRight);
+	featPubRight.publish(featuresRight);
+    }
+}
+
+void VRMagicStereoNode::discardFrame(VRmDWORD port)
+{
+    VRmImage *VRimg = NULL;
+    boost::lock_guard<boost::mutex> lock(camAccess);
+    if(!VRmUsbCamLockNextImageEx(device, port, &VRimg, NULL))
+	throw VRGrabException("VRmUsbCamLockNextImageEx failed.");
+    if(!VRmUsbCamUnlockNextImage(device, &VRimg))
+	throw VRGrabException("VRmUsbCamUnlockNextImage failed.");
+    if(!VRmUsbCamFreeImage(&VRimg))
+	throw VRGrabException("VRmUsbCamFreeImage failed.");
+}
+
 void VRMagicStereoNode::initProperties()
 {
     props = new PropertyCache();
@@ -315,6 +870,13 @@ void VRMagicStereoNode::initProperties()
 	std::cerr << "VRmUsbCamGetPropertyValueI(VRM_PROPID_CAM_GAIN_MONOCHROME_I) failed." << std::endl;
 
     props->fps = 0.5;
+    props->roiEnabled = false;
+    props->roiLeft = props->roiTop = 0;
+    props->roiWidth = sensorWidth;
+    props->roiHeight = sensorHeight;
+    props->denoise = false;
+    props->denoiseStaticWeight = 0.25;
+    props->denoiseMotionThreshold = 24;
 }
 
 void VRMagicStereoNode::initCam(VRmDWORD camDesired)
@@ -353,8 +915,8 @@ void VRMagicStereoNode::initCam(VRmDWORD camDesired)
     if(fmt == sFmtList.end())
         throw VRControlException("no acceptable format found.");
 
-    leftCalib.width = rightCalib.width =  width = fmt->m_width;
-    leftCalib.height = rightCalib.height = height = fmt->m_height;
+    leftCalib.width = rightCalib.width = sensorWidth = width = fmt->m_width;
+    leftCalib.height = rightCalib.height = sensorHeight = height = fmt->m_height;
 
     if(!VRmUsbCamSetSourceFormatIndex(device, fmt - sFmtList.begin()))
         throw VRControlException("failed to select desired format.");
@@ -363,6 +925,15 @@ void VRMagicStereoNode::initCam(VRmDWORD camDesired)
     if (!VRmUsbCamSetPropertyValueE(device, VRM_PROPID_GRAB_MODE_E, &mode))
         throw VRControlException("failed to set software trigger (VRM_PROPID_GRAB_MODE_TRIGGERED_SOFT).");
 
+    VRmBOOL roiSupported = false;
+    if(!VRmUsbCamGetPropertySupported(device, VRM_PROPID_GRAB_SENSOR_ROI_SOURCE_R, &roiSupported))
+        roiSupported = false;
+    hardwareRoi = roiSupported;
+
+    // allocate the image buffers once, grabFrame only overwrites them
+    imgLeft.data.resize(height * width * 2);
+    imgRight.data.resize(height * width * 2);
+
     if(!VRmUsbCamStart(device))
         throw VRControlException("VRmUsbCamStart failed.");
 }
@@ -379,41 +950,121 @@ void VRMagicStereoNode::retireCam()
 }
 
 VRMagicStereoNode::VRMagicStereoNode(VRmDWORD camDesired) : calibrated(false), framesDelivered(0),
-    leftNs("left"), rightNs("right"), fpsLimit(0.5), frame_id("camer_optical_frame")
+    leftNs(queuedHandle("left", &serviceQueue)), rightNs(queuedHandle("right", &serviceQueue)),
+    dConfServer(queuedHandle("~", &serviceQueue)), fpsLimit(0.5), frame_id("camer_optical_frame"),
+    featuresEnabled(false), featureJobsPending(0), featureWorkerStop(false),
+    acquiring(false), grabbingLeft(false), grabbingRight(false),
+    frameDivider(1), overrunCycles(0), headroomCycles(0),
+    sensorWidth(0), sensorHeight(0), roiLeft(0), roiTop(0), hardwareRoi(false), softwareCrop(false),
+    acquisitionTime(0.0), fullFrameAcquisitionTime(0.0), roiReportFrames(0), windowPending(false),
+    configPending(false)
 {
     leftCalib.K[0] = rightCalib.K[0] = 0.0;
     initCam(camDesired);
     loadCalibration();
+    loadCorrection();
     initProperties();
+    initFeatures();
+
+    ros::NodeHandle pn("~");
+    pn.param("queue_size", publishQueueSize, 2);
+    int divider;
+    pn.param("max_frame_divider", divider, 8);
+    maxFrameDivider = std::max(1, divider);
+
     dConfServer.setCallback(boost::bind(&VRMagicStereoNode::propertyUpdate, this, _1, _2));
     AnnounceTopics();
 }
 
 VRMagicStereoNode::~VRMagicStereoNode()
 {
+    {
+	boost::lock_guard<boost::mutex> lock(featureAccess);
+	featureWorkerStop = true;
+	featureQueued.notify_all();
+    }
+    if(featureWorker.joinable())
+	featureWorker.join();
+
     retireCam();
     AbandonTopics();
     delete props;
 }
 
+void VRMagicStereoNode::serviceLoop()
+{
+    while(ros::ok())
+	serviceQueue.callAvailable(ros::WallDuration(0.1));
+}
+
 void VRMagicStereoNode::spin()
 {
+        ros::NodeHandle pn("~");
+        hector_realtime::RealtimeConfig rtConfig;
+        hector_realtime::loadConfig(pn, rtConfig);
+
+        // started before the real-time settings are applied, so it keeps the default scheduling
+        serviceThread = boost::thread(&VRMagicStereoNode::serviceLoop, this);
+        hector_realtime::applyConfig(rtConfig);
+
+        // the jitter is only measured and reported in real-time mode
+        double reportInterval;
+        pn.param("jitter_report_interval", reportInterval, 10.0);
+
+        // deviation of each frame cycle from the configured period
+        hector_realtime::JitterHistogram cycleJitter;
+        int64_t lastCycle = 0;
+        int64_t lastReport = hector_realtime::getMonotonicTime();
+
+        unsigned int cycle = 0;
         while(ros::ok())
         {
-            try
+            if(cycle++ % frameDivider == 0)
             {
-                broadcastFrame();
+                boost::lock_guard<boost::mutex> acquisitionLock(acquisitionAccess);
+                applyPendingConfig();
+
+                int64_t start = hector_realtime::getMonotonicTime();
+                try
+                {
+                    if(broadcastFrame())
+                    {
+                        framesDelivered++;
+                        adaptFrameRate((hector_realtime::getMonotonicTime() - start) * 1e-9,
+                                fpsLimit.expectedCycleTime().toSec());
+                    }
+                }
+                catch(VRGrabException &ex)
+                {
+                    std::cerr << ex << std::endl;
+                }
             }
-            catch(VRGrabException &ex)
-            {
-                std::cerr << ex << std::endl;
-            }
-            ros::spinOnce();
-            framesDelivered++;
 
 	    boost::lock_guard<boost::mutex> lock(timerAccess);
             fpsLimit.sleep();
+
+            if(!rtConfig.enabled)
+                continue;
+
+            int64_t now = hector_realtime::getMonotonicTime();
+            if(lastCycle)
+            {
+                int64_t deviation = now - lastCycle - fpsLimit.expectedCycleTime().toNSec();
+                cycleJitter.record(deviation < 0 ? -deviation : deviation);
+            }
+            lastCycle = now;
+
+            if(reportInterval > 0.0 && now - lastReport > static_cast<int64_t>(reportInterval * 1e9))
+            {
+                ROS_INFO("Frame cycle jitter: %s", cycleJitter.toString().c_str());
+                lastReport = now;
+            }
         }
+
+        if(rtConfig.enabled)
+            ROS_INFO("Frame cycle jitter: %s", cycleJitter.toString().c_str());
+
+        serviceThread.join();
 }
 
 void forceShutdown(int sig)
@@ -428,6 +1079,7 @@ void forceShutdown(int sig)
 int main(int argc, char **argv)
 {
 	ros::init(argc, argv, "vrmagic_stereo_node", ros::init_options::AnonymousName);
+	hector_trace::init(ros::NodeHandle("~"));
 
 	signal(SIGSEGV, forceShutdown);
 